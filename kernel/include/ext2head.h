@@ -6,6 +6,10 @@
 #define EXT2_FT_FILE 1 
 #define EXT2_FT_DIR  2
 
+#define EXT2_FEATURE_COMPAT_DIR_INDEX 0x0020
+#define EXT2_FLAGS_UNSIGNED_HASH      0x0002
+#define EXT2_INDEX_FL                 0x00001000 /* hash-indexed directory */
+
 typedef struct ext2_super_block {
 	uint32_t	s_inodes_count;		/* Inodes count */
 	uint32_t	s_blocks_count;		/* Blocks count */
@@ -54,7 +58,29 @@ typedef struct ext2_super_block {
 	uint8_t	s_uuid[16];		/* 128-bit uuid for volume */
 	char	s_volume_name[16]; 	/* volume name */
 	char	s_last_mounted[64]; 	/* directory where last mounted */
-	uint32_t	s_reserved[206];	/* Padding to the end of the block */
+	uint32_t	s_algorithm_usage_bitmap; /* For compression */
+	uint8_t	s_prealloc_blocks;	/* Nr of blocks to try to preallocate*/
+	uint8_t	s_prealloc_dir_blocks;	/* Nr to preallocate for dirs */
+	uint16_t	s_padding1;
+	uint8_t	s_journal_uuid[16];	/* uuid of journal superblock */
+	uint32_t	s_journal_inum;		/* inode number of journal file */
+	uint32_t	s_journal_dev;		/* device number of journal file */
+	uint32_t	s_last_orphan;		/* start of list of inodes to delete */
+	uint32_t	s_hash_seed[4];		/* HTREE hash seed */
+	uint8_t	s_def_hash_version;	/* Default hash version to use */
+	uint8_t	s_reserved_char_pad;
+	uint16_t	s_reserved_word_pad;
+	uint32_t	s_default_mount_opts;
+	uint32_t	s_first_meta_bg; 	/* First metablock block group */
+	uint32_t	s_mkfs_time;		/* When the filesystem was created */
+	uint32_t	s_jnl_blocks[17];	/* Backup of the journal inode */
+	uint32_t	s_blocks_count_hi;
+	uint32_t	s_r_blocks_count_hi;
+	uint32_t	s_free_blocks_hi;
+	uint16_t	s_min_extra_isize;
+	uint16_t	s_want_extra_isize;
+	uint32_t	s_flags;		/* Miscellaneous flags */
+	uint32_t	s_reserved[167];	/* Padding to the end of the block */
 } SUPER;
 
 typedef struct ext2_group_desc {
@@ -96,15 +122,41 @@ typedef struct ext2_dir_entry_2 {
 } DIR;
 
 #define EXT2_BLOCK_SIZE 1024
+#define EXT2_INODE_CACHE_MAX 64
 
 typedef int32_t (*read_block_func_t)(int32_t block, void* buf);
 typedef int32_t (*write_block_func_t)(int32_t block, const void* buf);
 
+/*in-memory inode, written back to inode table on sync*/
+typedef struct {
+	int32_t ino; /*0 for free slot*/
+	bool dirty;
+	uint32_t stamp; /*last used, for lru replacement*/
+	INODE node;
+} ext2_inode_cache_t;
+
+/*one cached bitmap block, written back when replaced or on sync*/
+typedef struct {
+	int32_t block; /*0 for empty*/
+	bool dirty;
+	char data[EXT2_BLOCK_SIZE];
+} ext2_bitmap_cache_t;
+
 typedef struct {
 	int32_t group_num;
 	SUPER super;
 	GD* gds;
 
+	/*metadata write-back state, flushed by ext2_sync*/
+	bool* gds_dirty;
+	bool super_dirty;
+	uint32_t inode_stamp;
+	uint32_t balloc_next; /*next-fit cursor of block allocation*/
+	ext2_inode_cache_t* inodes;
+	ext2_bitmap_cache_t* block_bitmap;
+	ext2_bitmap_cache_t* inode_bitmap;
+	struct ext2_dir_cache* dirs; /*name hash of recently searched directories*/
+
 	read_block_func_t read_block;
 	write_block_func_t write_block;
 } ext2_t;
@@ -3,6 +3,9 @@
 
 #include <_types.h>
 
+#define SHM_FLAG_PUBLIC 0x1 //0 for family only
+#define SHM_FLAG_RDONLY 0x2 //read only for processes other than the owner
+
 void    shm_init(void);
 int32_t shm_alloc(uint32_t size, int32_t flag);
 int32_t shm_alloced_size(void);
@@ -11,5 +14,6 @@ void*   shm_raw(int32_t id);
 void*   shm_proc_map(int32_t pid, int32_t id);
 int32_t shm_proc_unmap(int32_t pid, int32_t id);
 int32_t shm_proc_ref(int32_t pid, int32_t id);
+int32_t shm_proc_id(int32_t pid, uint32_t addr);
 
 #endif
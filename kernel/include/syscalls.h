@@ -73,6 +73,7 @@ enum {
 	SYS_PROC_SHM_MAP,
 	SYS_PROC_SHM_UNMAP,
 	SYS_PROC_SHM_REF,
+	SYS_PROC_SHM_ID,
 
 	SYS_GET_SYSINFO,
 	SYS_GET_KERNEL_USEC,
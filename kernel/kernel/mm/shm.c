@@ -206,7 +206,7 @@ void* shm_raw(int32_t id) {
 }
 
 static int32_t check_owner(proc_t* proc, share_mem_t* it) {
-	if(it->flag != 0)  //1 for public, 0 for family only
+	if((it->flag & SHM_FLAG_PUBLIC) != 0)
 		return 0;
 
 	while(proc != NULL) {
@@ -250,19 +250,44 @@ void* shm_proc_map(int32_t pid, int32_t id) {
 	if(i >= SHM_MAX)
 		return NULL;
 
+	uint32_t ap = AP_RW_RW;
+	if((it->flag & SHM_FLAG_RDONLY) != 0) {
+		proc_t* owner = proc_get(it->owner);
+		if(owner == NULL || owner->space != proc->space) //threads of owner can write
+			ap = AP_RW_R;
+	}
+
 	uint32_t addr = it->addr;
 	for (i = 0; i < it->pages; i++) {
 		uint32_t physical_addr = resolve_phy_address(_kernel_vm, addr);
 		map_page(proc->space->vm,
 				addr,
 				physical_addr,
-				AP_RW_RW);
+				ap);
 		addr += PAGE_SIZE;
 	}
 	it->refs++;
 	return (void*)it->addr;
 }
 
+/*get id of share memory mapped by process at addr*/
+int32_t shm_proc_id(int32_t pid, uint32_t addr) {
+	proc_t* proc = proc_get(pid);
+	if(proc == NULL)
+		return -1;
+
+	uint32_t i;
+	for (i = 0; i < SHM_MAX; i++) {
+		int32_t id = proc->space->shms[i];
+		if(id == 0)
+			continue;
+		share_mem_t* it = shm_item(id);
+		if(it != NULL && addr >= it->addr && addr < (it->addr + it->pages*PAGE_SIZE))
+			return id;
+	}
+	return -1;
+}
+
 /*unmap share memory of process*/
 int32_t shm_proc_unmap(int32_t pid, int32_t id) {
 	proc_t* proc = proc_get(pid);
@@ -281,8 +306,14 @@ int32_t shm_proc_unmap(int32_t pid, int32_t id) {
 			break;
 		}
 	}
-	if(i >= SHM_MAX)
+	if(i >= SHM_MAX) {
+		//alloced but never mapped by anyone(e.g. shm_map failed), owner frees it.
+		if(it->refs <= 0 && it->owner == pid) {
+			free_item(it);
+			return 0;
+		}
 		return -1;
+	}
 
 	uint32_t addr = it->addr;
 	for (i = 0; i < it->pages; i++) {
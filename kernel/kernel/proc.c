@@ -374,46 +374,87 @@ static void proc_free_heap(proc_t* proc) {
 	proc->space->malloc_man.tail = NULL;
 }
 
-/* proc_load loads the given ELF process image into the given process. */
+/*copy one segment into proc pages, a page at a time; bytes past filesz (bss) are zeroed*/
+static void proc_load_segment(proc_t *proc, const char* src, uint32_t vaddr, uint32_t filesz, uint32_t memsz) {
+	uint32_t done = 0;
+	while(done < memsz) {
+		uint32_t n = PAGE_SIZE - (vaddr % PAGE_SIZE);
+		if(n > memsz - done)
+			n = memsz - done;
+		char* dst = (char*)resolve_kernel_address(proc->space->vm, vaddr);
+
+		uint32_t cn = 0;
+		if(done < filesz) {
+			cn = filesz - done;
+			if(cn > n)
+				cn = n;
+			memcpy(dst, src + done, cn);
+		}
+		if(cn < n)
+			memset(dst + cn, 0, n - cn);
+		done += n;
+		vaddr += n;
+	}
+}
+
+/* proc_load loads the given ELF process image into the given process. 
+image outside the proc heap (shm, kernel memory) is read in place,
+only image inside the heap needs a copy since the heap is released first*/
 int32_t proc_load_elf(proc_t *proc, const char *image, uint32_t size) {
 	uint32_t prog_header_offset = 0;
 	uint32_t prog_header_count = 0;
 	uint32_t i = 0;
 
-	char* proc_image = kmalloc(size);
-	memcpy(proc_image, image, size);
-	proc_free_heap(proc);
+	char* proc_image = (char*)image;
+	char* copied = NULL;
+	if((uint32_t)image < proc->space->heap_size) {
+		copied = kmalloc(size);
+		if(copied == NULL)
+			return -1;
+		memcpy(copied, image, size);
+		proc_image = copied;
+	}
 
 	/*read elf format from saved proc image*/
 	struct elf_header *header = (struct elf_header *) proc_image;
-	if (header->type != ELFTYPE_EXECUTABLE)
+	if (size < sizeof(struct elf_header) || header->type != ELFTYPE_EXECUTABLE) {
+		if(copied != NULL)
+			kfree(copied);
 		return -1;
+	}
+	proc_free_heap(proc);
 
 	prog_header_offset = header->phoff;
 	prog_header_count = header->phnum;
 
 	for (i = 0; i < prog_header_count; i++) {
-		uint32_t j = 0;
+		if(prog_header_offset + sizeof(struct elf_program_header) > size)
+			break;
 		struct elf_program_header *header = (void *) (proc_image + prog_header_offset);
+		prog_header_offset += sizeof(struct elf_program_header);
+		if(header->memsz == 0)
+			continue;
+
+		uint32_t filesz = header->filesz;
+		if(filesz > header->memsz)
+			filesz = header->memsz;
+		if(header->off > size || filesz > size - header->off) {
+			if(copied != NULL)
+				kfree(copied);
+			return -1;
+		}
 		/* make enough room for this section */
-		while (proc->space->heap_size < header->vaddr + header->memsz) {
-			if(proc_expand_mem(proc, 1) != 0){ 
-				kfree(proc_image);
+		uint32_t need = header->vaddr + header->memsz;
+		if (proc->space->heap_size < need) {
+			uint32_t pages = (need - proc->space->heap_size + PAGE_SIZE - 1) / PAGE_SIZE;
+			if(proc_expand_mem(proc, pages) != 0){ 
+				if(copied != NULL)
+					kfree(copied);
 				return -1;
 			}
 		}
-		/* copy the section from kernel to proc mem space*/
-		uint32_t hvaddr = header->vaddr;
-		uint32_t hoff = header->off;
-		for (j = 0; j < header->memsz; j++) {
-			uint32_t vaddr = hvaddr + j; /*vaddr in elf (proc vaddr)*/
-			uint32_t vkaddr = resolve_kernel_address(proc->space->vm, vaddr); /*trans to phyaddr by proc's page dir*/
-			/*copy from elf to vaddrKernel(=phyaddr=vaddrProc=vaddrElf)*/
-
-			uint32_t image_off = hoff + j;
-			*(char*)vkaddr = proc_image[image_off];
-		}
-		prog_header_offset += sizeof(struct elf_program_header);
+		/* copy the section from image to proc mem space*/
+		proc_load_segment(proc, proc_image + header->off, header->vaddr, filesz, header->memsz);
 	}
 
 	uint32_t user_stack_base =  proc_get_user_stack_base(proc);
@@ -421,7 +462,8 @@ int32_t proc_load_elf(proc_t *proc, const char *image, uint32_t size) {
 	proc->ctx.pc = header->entry;
 	proc->ctx.lr = header->entry;
 	proc_ready(proc);
-	kfree(proc_image);
+	if(copied != NULL)
+		kfree(copied);
 	return 0;
 }
 
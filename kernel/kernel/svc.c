@@ -356,6 +356,10 @@ static void sys_load_elf(context_t* ctx, const char* cmd, void* elf, uint32_t el
 		ctx->gpr[0] = -1;
 		return;
 	}
+	/*image was streamed or mapped into a shm, the new program doesn't need it*/
+	int32_t shm_id = shm_proc_id(_current_proc->pid, (uint32_t)elf);
+	if(shm_id > 0)
+		shm_proc_unmap(_current_proc->pid, shm_id);
 
 	ctx->gpr[0] = 0;
 	memcpy(ctx, &_current_proc->ctx, sizeof(context_t));
@@ -552,6 +556,10 @@ static int32_t sys_shm_ref(int32_t id) {
 	return shm_proc_ref(_current_proc->pid, id);
 }
 
+static int32_t sys_shm_id(uint32_t addr) {
+	return shm_proc_id(_current_proc->pid, addr);
+}
+
 static int32_t sys_lock_new(void) {
 	int32_t i;
 	for(i=0; i<LOCK_MAX; i++) {
@@ -967,6 +975,9 @@ void svc_handler(int32_t code, int32_t arg0, int32_t arg1, int32_t arg2, context
 	case SYS_PROC_SHM_REF:
 		ctx->gpr[0] = sys_shm_ref(arg0);
 		return;
+	case SYS_PROC_SHM_ID:
+		ctx->gpr[0] = sys_shm_id(arg0);
+		return;
 	case SYS_SET_GLOBAL:
 		ctx->gpr[0] = set_global((const char*)arg0, (const char*)arg1);
 		return;
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <vprintf.h>
 #include <x/xclient.h>
+#include <x/ximage.h>
 #include <sconf.h>
 #include <tga/tga.h>
 
@@ -43,7 +44,16 @@ static void draw_icon(graph_t* g, const char* item, int icon_size, int i) {
 	int at = str_to(item, ',', NULL, 1);
 	str_to(item + at + 1, ',', s, 1);
 
-	graph_t* img = tga_image_new(s->cstr);
+	graph_t* img = NULL;
+	graph_t* cached = x_image_get(s->cstr);
+	if(cached != NULL) {
+		//image shm is shared read-only, make a private copy before reversing it.
+		img = graph_new(NULL, cached->w, cached->h);
+		memcpy(img->buffer, cached->buffer, cached->w*cached->h*4);
+		x_image_release(cached);
+	}
+	else
+		img = tga_image_new(s->cstr);
 	str_free(s);
 	if(img == NULL)
 		return;
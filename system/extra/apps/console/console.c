@@ -133,6 +133,8 @@ static int run(int argc, char* argv[]) {
 			if(actived == 0) {
 				console_refresh(&console.console);
 				flush(console.fb_fd);
+				grect_t r;
+				console_get_damage(&console.console, &r);
 			}
 			actived = 1;
 		}
@@ -158,15 +160,10 @@ static int run(int argc, char* argv[]) {
 				break;
 		}
 
-		buf[size] = 0;
-		const char* p = (const char*)buf;
-		for(int32_t i=0; i<size; i++) {
-			char c = p[i];
-			console_put_char(&console.console, c);
-		}
-
-		if(actived == 1)
-			flush(console.fb_fd);
+		console_put_data(&console.console, buf, size);
+		grect_t r;
+		if(console_get_damage(&console.console, &r) && actived == 1)
+			flush_data(console.fb_fd, &r, sizeof(grect_t));
 	}
 	close(fd);
 	close_console(&console);
@@ -39,7 +39,7 @@ void step(x_t* x, void* p) {
 		clear(g, argb_int(0xff0000ff));
 		draw_text(g, 10, 10, str, font, 0xffffffff);
 		x_release_graph(x, g);
-		x_update(x);
+		x_swap(x, NULL, 0); //whole frame redrawn, no need to keep back buffer
 	}
 	usleep(10000);
 }
@@ -1,4 +1,5 @@
 #include "mario/mario_vm.h"
+#include "natives.h"
 #include <sys/vfs.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -27,8 +28,15 @@ bool load_js(vm_t* vm, const char* fname, bool verify) {
 	bool ret;
 	if(verify)
 		ret = vm_load(vm, s);
-	else
-		ret = vm_load_run(vm, s);
+	else {
+		//compiled bytecode is cached next to the script, as "<fname>c".
+		str_t* bc_fname = str_new(fname);
+		str_addc(bc_fname, 'c');
+		ret = vm_load_bc(vm, s, bc_fname->cstr);
+		str_free(bc_fname);
+		if(ret)
+			vm_run(vm);
+	}
 	free(s);
 	return ret;
 }
@@ -60,6 +68,9 @@ int main(int argc, char** argv) {
 	vm->gc_buffer_size = 1024;
 
 	init_args(vm, argc, argv);
+	reg_native_graph(vm);
+	reg_native_x(vm);
+	reg_native_file(vm);
 
 	vm_init(vm, NULL, NULL);
 
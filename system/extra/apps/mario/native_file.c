@@ -0,0 +1,216 @@
+#include "natives.h"
+#include <sys/vfs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+
+/** File, file_t in value.-----------------------------
+FILE of libc does a syscall for each write, so small writes are gathered
+in wbuf and sent to the fd at once.
+*/
+
+#define FILE_WBUF_SIZE 4096
+
+typedef struct {
+	FILE* fp;
+	uint32_t wsize;
+	char wbuf[FILE_WBUF_SIZE];
+} file_t;
+
+static uint32_t file_write_raw(FILE* fp, const char* p, uint32_t size) {
+	uint32_t done = 0;
+	while(done < size) {
+		int n = write(fp->fd, p + done, size - done);
+		if(n < 0 && errno == EAGAIN)
+			continue;
+		if(n <= 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+static uint32_t file_read_raw(FILE* fp, char* p, uint32_t size) {
+	uint32_t done = 0;
+	while(done < size) {
+		int n = read(fp->fd, p + done, size - done);
+		if(n < 0 && errno == EAGAIN)
+			continue;
+		if(n <= 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+static void file_flush(file_t* file) {
+	if(file->fp != NULL && file->wsize > 0)
+		file_write_raw(file->fp, file->wbuf, file->wsize);
+	file->wsize = 0;
+}
+
+static void file_close(file_t* file) {
+	file_flush(file);
+	if(file->fp != NULL)
+		fclose(file->fp);
+	file->fp = NULL;
+}
+
+static void file_free(void* p) {
+	file_close((file_t*)p);
+	free(p);
+}
+
+static inline file_t* this_file(var_t* env) {
+	var_t* thisv = get_obj(env, THIS);
+	if(thisv == NULL || thisv->value == NULL)
+		return NULL;
+	file_t* file = (file_t*)thisv->value;
+	return file->fp == NULL ? NULL : file;
+}
+
+static var_t* native_file_constructor(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	var_t* thisv = get_obj(env, THIS);
+	if(thisv == NULL || thisv->value != NULL)
+		return thisv;
+
+	const char* mode = get_str(env, "mode");
+	FILE* fp = fopen(get_str(env, "name"), mode[0] == 0 ? "r" : mode);
+	if(fp == NULL)
+		return thisv;
+
+	file_t* file = (file_t*)malloc(sizeof(file_t));
+	file->fp = fp;
+	file->wsize = 0;
+	thisv->value = file;
+	thisv->free_func = file_free;
+	return thisv;
+}
+
+static var_t* native_file_is_open(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	return var_new_bool(vm, this_file(env) != NULL);
+}
+
+//read(size) returns a new Bytes with the bytes read.
+static var_t* native_file_read(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	file_t* file = this_file(env);
+	int size = get_int(env, "size");
+	if(file == NULL || size <= 0)
+		return var_new_bytes(vm, NULL, 0, false);
+
+	file_flush(file);
+	char* buf = (char*)malloc(size);
+	if(buf == NULL)
+		return var_new_bytes(vm, NULL, 0, false);
+	uint32_t n = file_read_raw(file->fp, buf, size);
+	return var_new_bytes(vm, buf, n, false);
+}
+
+//readInto(bytes, offset, size) reads into the Bytes given without copying, returns the bytes read.
+static var_t* native_file_read_into(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	file_t* file = this_file(env);
+	var_t* bytes = get_obj(env, "bytes");
+	int offset = get_int(env, "offset");
+	int size = get_int(env, "size");
+	if(file == NULL || bytes == NULL || !bytes->is_bytes ||
+			offset < 0 || size <= 0 || (uint32_t)offset >= bytes->size)
+		return var_new_int(vm, 0);
+
+	if((uint32_t)size > bytes->size - offset) //offset + size may overflow int
+		size = bytes->size - offset;
+	file_flush(file);
+	return var_new_int(vm, file_read_raw(file->fp, (char*)bytes->value + offset, size));
+}
+
+//write(data) takes Bytes or string, returns the bytes written.
+static var_t* native_file_write(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	file_t* file = this_file(env);
+	var_t* v = get_obj(env, "data");
+	if(file == NULL || v == NULL)
+		return var_new_int(vm, 0);
+
+	const char* p;
+	uint32_t size;
+	if(v->is_bytes || v->type == V_STRING) {
+		p = (const char*)v->value;
+		size = v->size;
+	}
+	else {
+		p = var_get_str(v);
+		size = strlen(p);
+	}
+	if(p == NULL || size == 0)
+		return var_new_int(vm, 0);
+
+	if(file->wsize + size > FILE_WBUF_SIZE)
+		file_flush(file);
+	if(size >= FILE_WBUF_SIZE) //too big to gather, write it straight.
+		return var_new_int(vm, file_write_raw(file->fp, p, size));
+
+	memcpy(file->wbuf + file->wsize, p, size);
+	file->wsize += size;
+	return var_new_int(vm, size);
+}
+
+static var_t* native_file_flush(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	file_t* file = this_file(env);
+	if(file != NULL)
+		file_flush(file);
+	return NULL;
+}
+
+static var_t* native_file_close(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	file_t* file = this_file(env);
+	if(file != NULL)
+		file_close(file);
+	return NULL;
+}
+
+//File.readAll(name) returns the whole file as Bytes, the buffer of vfs is taken over.
+static var_t* native_file_read_all(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	int size = 0;
+	void* buf = vfs_readfile(get_str(env, "name"), &size);
+	if(buf == NULL)
+		return var_new_null(vm);
+	if(size < 0)
+		size = 0;
+	return var_new_bytes(vm, buf, size, false);
+}
+
+//File.readText(name) returns the whole file as string.
+static var_t* native_file_read_text(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	int size = 0;
+	char* buf = (char*)vfs_readfile(get_str(env, "name"), &size);
+	if(buf == NULL)
+		return var_new_null(vm);
+	if(size < 0)
+		size = 0;
+	buf = (char*)realloc_raw(buf, size, size + 1);
+	buf[size] = 0;
+	var_t* ret = var_new_str2(vm, buf, size);
+	free(buf);
+	return ret;
+}
+
+void reg_native_file(vm_t* vm) {
+	vm_reg_native(vm, "File", "constructor(name, mode)", native_file_constructor, NULL);
+	vm_reg_native(vm, "File", "isOpen()", native_file_is_open, NULL);
+	vm_reg_native(vm, "File", "read(size)", native_file_read, NULL);
+	vm_reg_native(vm, "File", "readInto(bytes, offset, size)", native_file_read_into, NULL);
+	vm_reg_native(vm, "File", "write(data)", native_file_write, NULL);
+	vm_reg_native(vm, "File", "flush()", native_file_flush, NULL);
+	vm_reg_native(vm, "File", "close()", native_file_close, NULL);
+	vm_reg_static(vm, "File", "readAll(name)", native_file_read_all, NULL);
+	vm_reg_static(vm, "File", "readText(name)", native_file_read_text, NULL);
+}
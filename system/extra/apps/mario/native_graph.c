@@ -0,0 +1,178 @@
+#include "natives.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Graph, graph_t in value.-----------------------------
+new Graph(width, height) owns its pixels, new Graph(width, height, bytes)
+draws on the pixels of a Bytes, and x.graph() borrows the window buffer.
+*/
+
+static void graph_free_raw(void* p) {
+	graph_free((graph_t*)p);
+}
+
+static void graph_borrowed(void* p) {
+	(void)p;
+}
+
+static inline graph_t* this_graph(var_t* env) {
+	var_t* thisv = get_obj(env, THIS);
+	if(thisv == NULL)
+		return NULL;
+	return (graph_t*)thisv->value;
+}
+
+//graph borrowed from owner(e.g. a window), owner is kept till the graph var freed.
+var_t* native_graph_new(vm_t* vm, graph_t* g, var_t* owner) {
+	var_t* var = var_new_obj(vm, g, graph_borrowed);
+	node_t* cls = vm_load_node(vm, "Graph", false);
+	if(cls != NULL)
+		var_instance_from(var, cls->var);
+	if(owner != NULL)
+		var_add(var, NATIVE_OWNER, owner);
+	return var;
+}
+
+static var_t* native_graph_constructor(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	var_t* thisv = get_obj(env, THIS);
+	int w = get_int(env, "width");
+	int h = get_int(env, "height");
+	var_t* pixels = get_obj(env, "pixels");
+	if(thisv == NULL || thisv->value != NULL || w <= 0 || h <= 0)
+		return thisv;
+
+	graph_t* g;
+	if(pixels != NULL && pixels->is_bytes && (uint64_t)w * h * 4 <= pixels->size) { //w*h*4 may overflow int
+		g = graph_new((uint32_t*)pixels->value, w, h); //no copy, drawn on the Bytes.
+		var_add(thisv, NATIVE_OWNER, pixels);
+	}
+	else {
+		g = graph_new(NULL, w, h);
+		clear(g, 0);
+	}
+	thisv->value = g;
+	thisv->free_func = graph_free_raw;
+	return thisv;
+}
+
+static var_t* native_graph_width(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	graph_t* g = this_graph(env);
+	return var_new_int(vm, g == NULL ? 0 : (int)g->w);
+}
+
+static var_t* native_graph_height(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	graph_t* g = this_graph(env);
+	return var_new_int(vm, g == NULL ? 0 : (int)g->h);
+}
+
+//pixels as Bytes(argb words) without copying, a window buffer changes by updating.
+static var_t* native_graph_pixels(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	graph_t* g = this_graph(env);
+	if(g == NULL)
+		return NULL;
+	var_t* bytes = var_new_bytes(vm, g->buffer, g->w*g->h*4, true);
+	var_add(bytes, NATIVE_OWNER, get_obj(env, THIS));
+	return bytes;
+}
+
+static var_t* native_graph_clear(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	graph_t* g = this_graph(env);
+	if(g != NULL)
+		clear(g, (uint32_t)get_int(env, "color"));
+	return NULL;
+}
+
+static var_t* native_graph_pixel(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	graph_t* g = this_graph(env);
+	if(g != NULL)
+		pixel_safe(g, get_int(env, "x"), get_int(env, "y"), (uint32_t)get_int(env, "color"));
+	return NULL;
+}
+
+static var_t* native_graph_fill(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	graph_t* g = this_graph(env);
+	if(g != NULL)
+		fill(g, get_int(env, "x"), get_int(env, "y"),
+				get_int(env, "w"), get_int(env, "h"),
+				(uint32_t)get_int(env, "color"));
+	return NULL;
+}
+
+static var_t* native_graph_box(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	graph_t* g = this_graph(env);
+	if(g != NULL)
+		box(g, get_int(env, "x"), get_int(env, "y"),
+				get_int(env, "w"), get_int(env, "h"),
+				(uint32_t)get_int(env, "color"));
+	return NULL;
+}
+
+static var_t* native_graph_line(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	graph_t* g = this_graph(env);
+	if(g != NULL)
+		line(g, get_int(env, "x1"), get_int(env, "y1"),
+				get_int(env, "x2"), get_int(env, "y2"),
+				(uint32_t)get_int(env, "color"));
+	return NULL;
+}
+
+static var_t* native_graph_draw_text(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	graph_t* g = this_graph(env);
+	font_t* font = font_by_name(get_str(env, "font"));
+	if(g != NULL && font != NULL)
+		draw_text(g, get_int(env, "x"), get_int(env, "y"),
+				get_str(env, "text"), font,
+				(uint32_t)get_int(env, "color"));
+	return NULL;
+}
+
+//blt(src, sx, sy, sw, sh, dx, dy, dw, dh), this is the dst.
+static var_t* native_graph_blt(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	graph_t* g = this_graph(env);
+	var_t* src = get_obj(env, "src");
+	if(g == NULL || src == NULL || src->value == NULL)
+		return NULL;
+	blt((graph_t*)src->value,
+			get_int(env, "sx"), get_int(env, "sy"), get_int(env, "sw"), get_int(env, "sh"),
+			g, get_int(env, "dx"), get_int(env, "dy"), get_int(env, "dw"), get_int(env, "dh"));
+	return NULL;
+}
+
+static var_t* native_graph_blt_alpha(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	graph_t* g = this_graph(env);
+	var_t* src = get_obj(env, "src");
+	if(g == NULL || src == NULL || src->value == NULL)
+		return NULL;
+	blt_alpha((graph_t*)src->value,
+			get_int(env, "sx"), get_int(env, "sy"), get_int(env, "sw"), get_int(env, "sh"),
+			g, get_int(env, "dx"), get_int(env, "dy"), get_int(env, "dw"), get_int(env, "dh"),
+			(uint8_t)get_int(env, "alpha"));
+	return NULL;
+}
+
+void reg_native_graph(vm_t* vm) {
+	vm_reg_native(vm, "Graph", "constructor(width, height, pixels)", native_graph_constructor, NULL);
+	vm_reg_native(vm, "Graph", "width()", native_graph_width, NULL);
+	vm_reg_native(vm, "Graph", "height()", native_graph_height, NULL);
+	vm_reg_native(vm, "Graph", "pixels()", native_graph_pixels, NULL);
+	vm_reg_native(vm, "Graph", "clear(color)", native_graph_clear, NULL);
+	vm_reg_native(vm, "Graph", "pixel(x, y, color)", native_graph_pixel, NULL);
+	vm_reg_native(vm, "Graph", "fill(x, y, w, h, color)", native_graph_fill, NULL);
+	vm_reg_native(vm, "Graph", "box(x, y, w, h, color)", native_graph_box, NULL);
+	vm_reg_native(vm, "Graph", "line(x1, y1, x2, y2, color)", native_graph_line, NULL);
+	vm_reg_native(vm, "Graph", "drawText(x, y, text, font, color)", native_graph_draw_text, NULL);
+	vm_reg_native(vm, "Graph", "blt(src, sx, sy, sw, sh, dx, dy, dw, dh)", native_graph_blt, NULL);
+	vm_reg_native(vm, "Graph", "bltAlpha(src, sx, sy, sw, sh, dx, dy, dw, dh, alpha)", native_graph_blt_alpha, NULL);
+}
@@ -0,0 +1,123 @@
+#include "natives.h"
+#include <x/xclient.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** X, x_t of a window in value.-----------------------------
+x.graph() gives the back buffer to draw, x.update() shows it and the next
+frame is drawn in full, the back buffer is not kept.
+*/
+
+static void x_close_raw(void* p) {
+	x_close((x_t*)p);
+}
+
+static inline x_t* this_x(var_t* env) {
+	var_t* thisv = get_obj(env, THIS);
+	if(thisv == NULL)
+		return NULL;
+	return (x_t*)thisv->value;
+}
+
+static var_t* native_x_constructor(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	var_t* thisv = get_obj(env, THIS);
+	if(thisv == NULL || thisv->value != NULL)
+		return thisv;
+
+	x_t* x = x_open(get_int(env, "x"), get_int(env, "y"),
+			get_int(env, "width"), get_int(env, "height"),
+			get_str(env, "title"), get_int(env, "style"));
+	if(x != NULL) {
+		thisv->value = x;
+		thisv->free_func = x_close_raw;
+	}
+	return thisv;
+}
+
+//graph of the window, call it again after resized.
+static var_t* native_x_graph(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	x_t* x = this_x(env);
+	graph_t* g = x_get_graph(x);
+	if(g == NULL)
+		return NULL;
+	return native_graph_new(vm, g, get_obj(env, THIS));
+}
+
+static var_t* native_x_update(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	x_t* x = this_x(env);
+	return var_new_int(vm, x == NULL ? -1 : x_update(x));
+}
+
+static var_t* native_x_set_visible(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	x_t* x = this_x(env);
+	if(x != NULL)
+		x_set_visible(x, get_bool(env, "visible"));
+	return NULL;
+}
+
+static var_t* native_x_closed(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	x_t* x = this_x(env);
+	return var_new_bool(vm, x == NULL || x->closed);
+}
+
+//graphs borrowed may still be held, so the window is released when the X var is freed.
+static var_t* native_x_close(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	x_t* x = this_x(env);
+	if(x != NULL && !x->closed) {
+		x_set_visible(x, false);
+		x->closed = true;
+	}
+	return NULL;
+}
+
+//ints are cloned when added, the temporary one is dropped after.
+static void event_add(vm_t* vm, var_t* ev, const char* name, int i) {
+	var_t* v = var_ref(var_new_int(vm, i));
+	var_add(ev, name, v);
+	var_unref(v);
+}
+
+//next event as {type, state, x, y, rx, ry, button, key, event, v0, v1}, or null.
+static var_t* native_x_get_event(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	x_t* x = this_x(env);
+	xevent_t xev;
+	if(x == NULL || x_get_event(x, &xev, NULL) != 0)
+		return var_new_null(vm);
+
+	var_t* ev = var_new_obj(vm, NULL, NULL);
+	event_add(vm, ev, "type", xev.type);
+	event_add(vm, ev, "state", xev.state);
+	if(xev.type == XEVT_MOUSE) {
+		event_add(vm, ev, "x", xev.value.mouse.x);
+		event_add(vm, ev, "y", xev.value.mouse.y);
+		event_add(vm, ev, "rx", xev.value.mouse.rx);
+		event_add(vm, ev, "ry", xev.value.mouse.ry);
+		event_add(vm, ev, "button", xev.value.mouse.button);
+	}
+	else if(xev.type == XEVT_KEYB) {
+		event_add(vm, ev, "key", xev.value.keyboard.value);
+	}
+	else if(xev.type == XEVT_WIN) {
+		event_add(vm, ev, "event", xev.value.window.event);
+		event_add(vm, ev, "v0", xev.value.window.v0);
+		event_add(vm, ev, "v1", xev.value.window.v1);
+	}
+	return ev;
+}
+
+void reg_native_x(vm_t* vm) {
+	vm_reg_native(vm, "X", "constructor(x, y, width, height, title, style)", native_x_constructor, NULL);
+	vm_reg_native(vm, "X", "graph()", native_x_graph, NULL);
+	vm_reg_native(vm, "X", "update()", native_x_update, NULL);
+	vm_reg_native(vm, "X", "setVisible(visible)", native_x_set_visible, NULL);
+	vm_reg_native(vm, "X", "closed()", native_x_closed, NULL);
+	vm_reg_native(vm, "X", "close()", native_x_close, NULL);
+	vm_reg_native(vm, "X", "getEvent()", native_x_get_event, NULL);
+}
@@ -0,0 +1,21 @@
+#ifndef MARIO_NATIVES_H
+#define MARIO_NATIVES_H
+
+#include "mario/mario_vm.h"
+#include <graph/graph.h>
+
+/*
+native classes of the mario app. pixels and file data are shared with scripts
+by Bytes borrowing the buffers, the var owning a buffer is kept alive by the
+member "_owner" of the borrower.
+*/
+
+#define NATIVE_OWNER "_owner"
+
+void reg_native_graph(vm_t* vm);
+void reg_native_x(vm_t* vm);
+void reg_native_file(vm_t* vm);
+
+var_t* native_graph_new(vm_t* vm, graph_t* g, var_t* owner);
+
+#endif
@@ -12,7 +12,7 @@ void line_number(int l) {
 }
 
 void show_code(m_array_t* lines) {
-	int i;
+	uint32_t i;
 	for(i=0; i<lines->size; ++i) {
 		str_t* l = (str_t*)array_get(lines, i);
 		line_number(i);
@@ -26,7 +26,7 @@ void run(vm_t* vm, m_array_t* lines) {
 		return;
 	}
 
-	int i;
+	uint32_t i;
 	str_t* src = str_new("");
 	for(i=0; i<lines->size; ++i) {
 		str_t* l = (str_t*)array_get(lines, i);
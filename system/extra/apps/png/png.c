@@ -4,6 +4,7 @@
 #include <string.h>
 #include <vprintf.h>
 #include <x/xclient.h>
+#include <x/ximage.h>
 #include <upng/upng.h>
 
 static void draw(x_t* xp, graph_t* img) {
@@ -16,8 +17,15 @@ static void draw(x_t* xp, graph_t* img) {
 		}
 	}
 
-	blt_alpha(img, 0, 0, img->w, img->h,
-			g, 0, 0, img->w, img->h, 0xff);
+	//fit the window, keep the aspect ratio
+	int w = g->w;
+	int h = img->h * g->w / img->w;
+	if(h > (int32_t)g->h) {
+		h = g->h;
+		w = img->w * g->h / img->h;
+	}
+	blt_scaled_alpha(img, 0, 0, img->w, img->h,
+			g, (g->w - w)/2, (g->h - h)/2, w, h, true, 0xff);
 	x_release_graph(xp, g);
 	x_update(xp);
 
@@ -35,16 +43,18 @@ int main(int argc, char* argv[]) {
 	}
 
 	printf("loading...");
-	graph_t* img = png_image_new(argv[1]);
+	graph_t* img = x_image_get(argv[1]);
+	if(img == NULL)
+		img = png_image_new(argv[1]);
 	if(img == NULL)  {
 		printf("open '%s' error!\n", argv[1]);
 		return -1;
 	}
 	printf("ok\n");
 
-	x_t* x = x_open(10, 10, img->w, img->h+20, "png", X_STYLE_NORMAL | X_STYLE_NO_RESIZE);
+	x_t* x = x_open(10, 10, img->w, img->h+20, "png", X_STYLE_NORMAL);
 	if(x == NULL) {
-		graph_free(img);
+		x_image_release(img);
 		return -1;
 	}
 
@@ -55,7 +65,7 @@ int main(int argc, char* argv[]) {
 
 	x_run(x, NULL, NULL, img);
 
-	graph_free(img);
+	x_image_release(img);
 	x_close(x);
 	return 0;
 }
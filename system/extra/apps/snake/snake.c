@@ -225,7 +225,7 @@ int main(int argc, char* argv[]) {
 			draw_text(g, 0, 0, info, font, TEXT_COLOR);
 			snake_draw(g, &s, &f);
 			x_release_graph(x, g);
-			x_update(x);
+			x_swap(x, NULL, 0); //whole frame redrawn, no need to keep back buffer
 		}
 		usleep(30000);
 	}
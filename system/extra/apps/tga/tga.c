@@ -4,8 +4,25 @@
 #include <string.h>
 #include <vprintf.h>
 #include <x/xclient.h>
+#include <x/ximage.h>
 #include <tga/tga.h>
 
+static void draw(x_t* x, graph_t* img) {
+	graph_t* g = x_get_graph(x);
+	clear(g, 0xff888888);
+
+	//stretch to the window, leave the bottom line for the hint
+	blt_scaled_alpha(img, 0, 0, img->w, img->h,
+			g, 0, 0, g->w, g->h-20, true, 0xff);
+	draw_text(g, 30, g->h-20, "press anykey to quit......", font_by_name("8x16"), 0xffffffff);
+	x_release_graph(x, g);
+	x_update(x);
+}
+
+static void on_resize(x_t* x, void* p) {
+	draw(x, (graph_t*)p);
+}
+
 int main(int argc, char* argv[]) {
 	if(argc < 2) {
 		printf("Usage: tga <tga filename>\n");
@@ -13,7 +30,9 @@ int main(int argc, char* argv[]) {
 	}
 
 	printf("loading...");
-	graph_t* img = tga_image_new(argv[1]);
+	graph_t* img = x_image_get(argv[1]);
+	if(img == NULL)
+		img = tga_image_new(argv[1]);
 	if(img == NULL)  {
 		printf("open '%s' error!\n", argv[1]);
 		return -1;
@@ -22,22 +41,16 @@ int main(int argc, char* argv[]) {
 
 	x_t* x = x_open(100, 100, img->w, img->h+20, "tga", X_STYLE_NORMAL);
 	if(x == NULL) {
-		graph_free(img);
+		x_image_release(img);
 		return -1;
 	}
-	graph_t* g = x_get_graph(x);
-	clear(g, 0xff888888);
-
-	blt_alpha(img, 0, 0, img->w, img->h,
-			g, 0, 0, img->w, img->h, 0xff);
-	draw_text(g, 30, g->h-20, "press anykey to quit......", font_by_name("8x16"), 0xffffffff);
-	x_release_graph(x, g);
-	x_update(x);
+	x->on_resize = on_resize;
+	draw(x, img);
 
 	x_set_visible(x, true);
-	x_run(x, NULL, NULL, NULL);
+	x_run(x, NULL, NULL, img);
 
-	graph_free(img);
+	x_image_release(img);
 	x_close(x);
 	return 0;
 }
@@ -75,6 +75,8 @@ static void console_focus(x_t* x, void* p) {
 	console->bg_color = _conf.bg_color;
 	console_refresh(console);
 	x_update(x);
+	grect_t r;
+	console_get_damage(console, &r); //whole view updated already
 }
 
 static void console_unfocus(x_t* x, void* p) {
@@ -84,6 +86,8 @@ static void console_unfocus(x_t* x, void* p) {
 	console->bg_color = _conf.unfocus_bg_color;
 	console_refresh(console);
 	x_update(x);
+	grect_t r;
+	console_get_damage(console, &r); //whole view updated already
 }
 
 static int run(int argc, char* argv[]) {
@@ -142,13 +146,10 @@ static int run(int argc, char* argv[]) {
 				break;
 		}
 
-		buf[size] = 0;
-		const char* p = (const char*)buf;
-		for(int32_t i=0; i<size; i++) {
-			char c = p[i];
-			console_put_char(&console, c);
-		}
-		x_update(xp);
+		console_put_data(&console, buf, size);
+		grect_t r;
+		if(console_get_damage(&console, &r))
+			x_update_rects(xp, &r, 1);
 	}
 
 	console_close(&console);
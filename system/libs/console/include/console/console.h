@@ -2,6 +2,7 @@
 #define CONSOLE_H
 
 #include <graph/graph.h>
+#include <stdbool.h>
 
 typedef struct {
 	uint32_t start_line;
@@ -11,6 +12,11 @@ typedef struct {
 	uint32_t total;
 	char* data;
 	uint32_t size;
+
+	uint8_t* dirty;     //per cell, indexed by screen position
+	uint32_t dirty_from;
+	uint32_t dirty_to;
+	uint32_t scroll;    //pending scroll lines not yet blitted
 } content_t;
 
 typedef struct {
@@ -19,6 +25,7 @@ typedef struct {
 	uint32_t fg_color;
 	font_t* font;
 	content_t content;
+	grect_t damage;     //pixels changed since last console_get_damage
 } console_t;
 
 int32_t console_init(console_t* console);
@@ -28,5 +35,7 @@ void console_refresh(console_t* console);
 int32_t console_reset(console_t* console);
 void console_put_char(console_t* console, char c);
 void console_put_string(console_t* console, const char* s);
+void console_put_data(console_t* console, const char* s, int32_t size);
+bool console_get_damage(console_t* console, grect_t* r);
 
 #endif
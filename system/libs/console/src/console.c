@@ -7,12 +7,203 @@
 
 #define T_W 2 /*tab width*/
 
+static void cons_damage(console_t* console, int32_t x, int32_t y, int32_t w, int32_t h) {
+	grect_t* d = &console->damage;
+	if(d->w <= 0 || d->h <= 0) {
+		d->x = x;
+		d->y = y;
+		d->w = w;
+		d->h = h;
+		return;
+	}
+	int32_t ex = d->x + d->w;
+	int32_t ey = d->y + d->h;
+	if(x + w > ex)
+		ex = x + w;
+	if(y + h > ey)
+		ey = y + h;
+	if(x < d->x)
+		d->x = x;
+	if(y < d->y)
+		d->y = y;
+	d->w = ex - d->x;
+	d->h = ey - d->y;
+}
+
+/*fill with bg_color raw like clear() does, so a cell can be redrawn in place*/
+static void cons_fill(console_t* console, int32_t x, int32_t y, int32_t w, int32_t h) {
+	graph_t* g = console->g;
+	if(x + w > (int32_t)g->w)
+		w = g->w - x;
+	if(y + h > (int32_t)g->h)
+		h = g->h - y;
+	if(w <= 0 || h <= 0)
+		return;
+
+	uint32_t* p = &g->buffer[y * g->w + x];
+	for(int32_t i=0; i<w; i++)
+		p[i] = console->bg_color;
+	for(int32_t i=1; i<h; i++)
+		memcpy(p + i*g->w, p, w*4);
+}
+
 static void cons_draw_char(console_t* console, int32_t x, int32_t y, char c) {
 	draw_char(console->g, x, y, c, console->font, console->fg_color);
 }
 
 static void cons_clear(console_t* console) {
 	clear(console->g, console->bg_color);
+	cons_damage(console, 0, 0, console->g->w, console->g->h);
+}
+
+static uint32_t get_at(console_t* console, uint32_t i) {
+	uint32_t at = i + (console->content.line_w * console->content.start_line);
+	if(at >= console->content.total)
+		at -=  console->content.total;
+	return at;
+}
+
+static void cons_mark(console_t* console, uint32_t i) {
+	content_t* ct = &console->content;
+	if(i >= ct->total)
+		return;
+	ct->dirty[i] = 1;
+	if(ct->dirty_from == ct->dirty_to) {
+		ct->dirty_from = i;
+		ct->dirty_to = i + 1;
+		return;
+	}
+	if(i < ct->dirty_from)
+		ct->dirty_from = i;
+	if(i >= ct->dirty_to)
+		ct->dirty_to = i + 1;
+}
+
+static void cons_unmark_all(content_t* ct) {
+	if(ct->dirty_from < ct->dirty_to)
+		memset(ct->dirty + ct->dirty_from, 0, ct->dirty_to - ct->dirty_from);
+	ct->dirty_from = ct->dirty_to = 0;
+}
+
+/*drop the top line; pixels are moved later by cons_draw in one blt*/
+static void move_line(console_t* console) {
+	content_t* ct = &console->content;
+	ct->line--;
+	ct->start_line++;
+	if(ct->start_line >= ct->line_num)
+		ct->start_line = 0;
+	ct->size -= ct->line_w;
+	ct->scroll++;
+
+	uint32_t keep = ct->total - ct->line_w;
+	memmove(ct->dirty, ct->dirty + ct->line_w, keep);
+	memset(ct->dirty + keep, 0, ct->line_w);
+	if(ct->dirty_to <= ct->line_w) {
+		ct->dirty_from = ct->dirty_to = 0;
+	}
+	else {
+		ct->dirty_from = ct->dirty_from > ct->line_w ? ct->dirty_from - ct->line_w : 0;
+		ct->dirty_to -= ct->line_w;
+	}
+}
+
+/*apply pending scroll and redraw dirty cells only*/
+static void cons_draw(console_t* console) {
+	content_t* ct = &console->content;
+	if(console->g == NULL || ct->data == NULL)
+		return;
+	int32_t fw = console->font->w;
+	int32_t fh = console->font->h;
+	int32_t tw = ct->line_w * fw;
+	int32_t th = ct->line_num * fh;
+
+	if(ct->scroll > 0) {
+		if(ct->scroll < ct->line_num) {
+			int32_t sy = ct->scroll * fh;
+			blt(console->g, 0, sy, tw, th - sy, console->g, 0, 0, tw, th - sy);
+			cons_fill(console, 0, th - sy, tw, sy);
+		}
+		else {
+			cons_fill(console, 0, 0, tw, th);
+		}
+		cons_damage(console, 0, 0, tw, th);
+		ct->scroll = 0;
+	}
+
+	if(ct->dirty_from == ct->dirty_to)
+		return;
+
+	for(uint32_t i=ct->dirty_from; i<ct->dirty_to; i++) {
+		if(ct->dirty[i] == 0)
+			continue;
+		ct->dirty[i] = 0;
+		int32_t x = mod_u32(i, ct->line_w) * fw;
+		int32_t y = div_u32(i, ct->line_w) * fh;
+		cons_fill(console, x, y, fw, fh);
+		if(i < ct->size) {
+			char c = ct->data[get_at(console, i)];
+			if(c != ' ')
+				cons_draw_char(console, x, y, c);
+		}
+	}
+
+	uint32_t row0 = div_u32(ct->dirty_from, ct->line_w);
+	uint32_t row1 = div_u32(ct->dirty_to - 1, ct->line_w);
+	if(row0 == row1)
+		cons_damage(console, mod_u32(ct->dirty_from, ct->line_w) * fw, row0 * fh,
+				(ct->dirty_to - ct->dirty_from) * fw, fh);
+	else
+		cons_damage(console, 0, row0 * fh, tw, (row1 - row0 + 1) * fh);
+	ct->dirty_from = ct->dirty_to = 0;
+}
+
+/*update the cell grid only, drawing is deferred to cons_draw*/
+static void cons_put(console_t* console, char c) {
+	content_t* ct = &console->content;
+	if(ct->data == NULL)
+		return;
+
+	if(c == '\r')
+		c = '\n';
+
+	if(c == 8) { //backspace
+		if(ct->size > 0) {
+			ct->size--;
+			if(ct->line > 0 && ct->size < ct->line*ct->line_w)
+				ct->line--;
+			cons_mark(console, ct->size);
+		}
+		return;
+	}
+	else if(c == '\t') {
+		uint32_t x = 0;
+		while(x < T_W) {
+			cons_put(console, ' ');
+			x++;
+		}
+		return;
+	}
+
+	if(c == '\n') { //new line, cells after size are blank already.
+		uint32_t end = (ct->line+1) * ct->line_w;
+		while(ct->size < end) {
+			ct->data[get_at(console, ct->size)] = ' ';
+			ct->size++;
+		}
+		ct->line++;
+		if(ct->line >= ct->line_num)
+			move_line(console);
+		return;
+	}
+
+	if(ct->size >= (ct->line+1) * ct->line_w) { //wrap
+		ct->line++;
+		if(ct->line >= ct->line_num)
+			move_line(console);
+	}
+	ct->data[get_at(console, ct->size)] = c;
+	cons_mark(console, ct->size);
+	ct->size++;
 }
 
 int32_t console_reset(console_t* console) {
@@ -24,42 +215,42 @@ int32_t console_reset(console_t* console) {
 	int old_total = console->content.total;
 	int old_line_w = console->content.line_w;
 	int old_start_line = console->content.start_line;
-	char* old_data = (char*)malloc(old_total);
-	memcpy(old_data, console->content.data, old_total);
+	char* old_data = console->content.data;
 
 	console->content.size = 0;
 	console->content.start_line = 0;
 	console->content.line = 0;
-	console->content.line_w = div_u32(console->g->w, console->font->w)-1;
+	console->content.scroll = 0;
+	console->content.line_w = div_u32(console->g->w, console->font->w);
+	if(console->content.line_w == 0)
+		console->content.line_w = 1;
 	console->content.line_num = div_u32(console->g->h, console->font->h);
-	if(mod_u32(console->g->h, console->font->h) != 0)
-		console->content.line_num--;
+	if(console->content.line_num == 0)
+		console->content.line_num = 1;
 	uint32_t data_size = console->content.line_num*console->content.line_w;
 	console->content.total = data_size;
-	if(console->content.data != NULL)
-		free(console->content.data);
 	console->content.data = (char*)malloc(data_size);
 	memset(console->content.data, 0, data_size);
-	cons_clear(console);
+	if(console->content.dirty != NULL)
+		free(console->content.dirty);
+	console->content.dirty = (uint8_t*)malloc(data_size);
+	memset(console->content.dirty, 0, data_size);
+	console->content.dirty_from = console->content.dirty_to = 0;
 
 	//restore old data
-	if(old_start_line > 0 && old_size > old_line_w) {
-		old_start_line++;
-		old_size -= old_line_w;
-	}
-
 	int i = 0;
 	while(i < old_size) {
 		int at = (old_line_w * old_start_line) + (i++);
 		if(at >= old_total)
 			at -= old_total;
-		char c = old_data[at];
-		console_put_char(console, c);
+		cons_put(console, old_data[at]);
 		if(mod_u32(i, old_line_w) == 0) {
-			console_put_char(console, '\n');
+			cons_put(console, '\n');
 		}
 	}
-	free(old_data);
+	if(old_data != NULL)
+		free(old_data);
+	console_refresh(console);
 	return 0;
 }
 
@@ -69,36 +260,37 @@ int32_t console_init(console_t* console) {
 	console->fg_color = argb(0xff, 0xaa, 0xaa, 0xaa);
 	console->font = font_by_name("8x16");
 	memset(&console->content, 0, sizeof(content_t));
+	memset(&console->damage, 0, sizeof(grect_t));
 	return 0;
 }
 
 void console_close(console_t* console) {
 	free(console->content.data);
+	free(console->content.dirty);
 	console->content.size = 0;
 	console->content.data = NULL;
+	console->content.dirty = NULL;
 	console->g = NULL;
 }
 
-static uint32_t get_at(console_t* console, uint32_t i) {
-	uint32_t at = i + (console->content.line_w * console->content.start_line);
-	if(at >= console->content.total)
-		at -=  console->content.total;
-	return at;
-}
-
 void console_refresh(console_t* console) {
+	if(console->g == NULL)
+		return;
 	cons_clear(console);
+	content_t* ct = &console->content;
+	ct->scroll = 0;
+	cons_unmark_all(ct);
+
 	uint32_t i=0;
 	uint32_t x = 0;
 	uint32_t y = 0;
-	while(i < console->content.size) {
-		uint32_t at = get_at(console, i);
-		char c = console->content.data[at];
+	while(i < ct->size) {
+		char c = ct->data[get_at(console, i)];
 		if(c != ' ') {
-			cons_draw_char(console, x*console->font->w, y*console->font->h, console->content.data[at]);
+			cons_draw_char(console, x*console->font->w, y*console->font->h, c);
 		}
 		x++;
-		if(x >= console->content.line_w) {
+		if(x >= ct->line_w) {
 			y++;
 			x = 0;
 		}
@@ -113,68 +305,29 @@ void console_clear(console_t* console) {
 	console_refresh(console);
 }
 
-static void move_line(console_t* console) {
-	console->content.line--;
-	console->content.start_line++;
-	if(console->content.start_line >= console->content.line_num)
-		console->content.start_line = 0;
-	console->content.size -= console->content.line_w;
-	console_refresh(console);
-}
-
 void console_put_char(console_t* console, char c) {
-	if(c == '\r')
-		c = '\n';
-
-	if(c == 8) { //backspace
-		if(console->content.size > 0) {
-			console->content.size--;
-			console_refresh(console);
-		}
-		return;
-	}
-	else if(c == '\t') {
-		uint32_t x = 0;
-		while(x < T_W) {
-			console_put_char(console, ' ');
-			x++;
-		}
-		return;
-	}
-	if(c == '\n') { //new line.
-		uint32_t x =  console->content.size - (console->content.line*console->content.line_w);
-		while(x < console->content.line_w) {
-			uint32_t at = get_at(console, console->content.size);
-			console->content.data[at] = ' ';
-			console->content.size++;
-			x++;
-		}
-		console->content.line++;
-	}
-	else {
-		uint32_t x =  console->content.size - (console->content.line*console->content.line_w) + 1;
-		if(x == console->content.line_w) {
-			console->content.line++;
-		}
-	}
+	cons_put(console, c);
+	cons_draw(console);
+}
 
-	if((console->content.line) > console->content.line_num) {
-		move_line(console);
-	}
-	
-	if(c != '\n') {
-		uint32_t at = get_at(console, console->content.size);
-		console->content.data[at] = c;
-		int32_t x = (console->content.size - (console->content.line*console->content.line_w)) * console->font->w;
-		int32_t y = console->content.line * console->font->h;
-		cons_draw_char(console, x, y, c);
-		console->content.size++;
-	}
+void console_put_data(console_t* console, const char* s, int32_t size) {
+	for(int32_t i=0; i<size; i++)
+		cons_put(console, s[i]);
+	cons_draw(console);
 }
 
 void console_put_string(console_t* console, const char* s) {
 	while(*s != 0) {
-		console_put_char(console, *s);
+		cons_put(console, *s);
 		s++;
 	}
+	cons_draw(console);
+}
+
+bool console_get_damage(console_t* console, grect_t* r) {
+	if(console->damage.w <= 0 || console->damage.h <= 0)
+		return false;
+	*r = console->damage;
+	memset(&console->damage, 0, sizeof(grect_t));
+	return true;
 }
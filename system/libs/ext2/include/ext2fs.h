@@ -7,6 +7,8 @@ int32_t ext2_init(ext2_t* ext2, read_block_func_t read_block, write_block_func_t
 
 void ext2_quit(ext2_t* ext2);
 
+int32_t ext2_sync(ext2_t* ext2);
+
 int32_t ext2_rmdir(ext2_t* ext2, const char* fname);
 
 int32_t ext2_unlink(ext2_t* ext2, const char* fname);
@@ -21,7 +23,7 @@ int32_t ext2_node_by_fname(ext2_t* ext2, const char* fname, INODE* node);
 
 int32_t ext2_node_by_ino(ext2_t* ext2, int32_t ino, INODE* node);
 
-void    put_node(ext2_t* ext2, int32_t ino, INODE *node);
+int32_t put_node(ext2_t* ext2, int32_t ino, INODE *node);
 
 int32_t ext2_create_dir(ext2_t* ext2, INODE* father_inp, const char *base, int32_t owner);
 
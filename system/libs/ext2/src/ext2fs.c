@@ -54,16 +54,21 @@ static inline int32_t get_block_in_group(ext2_t* ext2, int32_t block, int32_t in
 	return block - (index * ext2->super.s_blocks_per_group);
 }
 
-/*write back group descriptor by index*/
+/*write back group descriptor block holding index*/
 static int32_t set_gd(ext2_t* ext2, int32_t index) {
 	int32_t gd_size = sizeof(GD);
   int32_t gd_num = div_u32(EXT2_BLOCK_SIZE, gd_size);
 
 	int32_t blk_index = div_u32(index, gd_num);
 	index = blk_index * gd_num;
+	if(index + gd_num > ext2->group_num)
+		gd_num = ext2->group_num - index;
   
-	const char* p = (const char*)&ext2->gds[index];
-	return ext2->write_block(blk_index+2, p);
+	char buf[EXT2_BLOCK_SIZE];
+	if(ext2->read_block(blk_index+2, buf) != 0)
+		return -1;
+	memcpy(buf, &ext2->gds[index], gd_num * gd_size);
+	return ext2->write_block(blk_index+2, buf);
 }
 
 /*write back super block*/
@@ -75,91 +80,121 @@ static int32_t set_super(ext2_t* ext2) {
 	return ext2->write_block(1, buf);
 }
 
+/*gd and super counters are only marked dirty here, ext2_sync writes them back*/
 static void inc_free_blocks(ext2_t* ext2, int32_t block) {
 	int32_t index = get_gd_index_by_block(ext2, block);
 	ext2->gds[index].bg_free_blocks_count++;
-	set_gd(ext2, index);
+	ext2->gds_dirty[index] = true;
 
 	ext2->super.s_free_blocks_count++;
-	set_super(ext2);
+	ext2->super_dirty = true;
 }
 
 static void inc_free_inodes(ext2_t* ext2, int32_t ino) {
 	int32_t index = get_gd_index_by_ino(ext2, ino);
 	ext2->gds[index].bg_free_inodes_count++;
-	set_gd(ext2, index);
+	ext2->gds_dirty[index] = true;
 
 	ext2->super.s_free_inodes_count++;
-	set_super(ext2);
+	ext2->super_dirty = true;
 }
 
 static void dec_free_blocks(ext2_t* ext2, int32_t block) {
 	int32_t index = get_gd_index_by_block(ext2, block);
 	ext2->gds[index].bg_free_blocks_count--;
-	set_gd(ext2, index);
+	ext2->gds_dirty[index] = true;
 
 	ext2->super.s_free_blocks_count--;
-	set_super(ext2);
+	ext2->super_dirty = true;
 }
 
 static void dec_free_inodes(ext2_t* ext2, int32_t ino) {
 	int32_t index = get_gd_index_by_ino(ext2, ino);
 	ext2->gds[index].bg_free_inodes_count--;
-	set_gd(ext2, index);
+	ext2->gds_dirty[index] = true;
 
 	ext2->super.s_free_inodes_count--;
-	set_super(ext2);
+	ext2->super_dirty = true;
+}
+
+static int32_t bitmap_flush(ext2_t* ext2, ext2_bitmap_cache_t* bm) {
+	if(!bm->dirty)
+		return 0;
+	if(ext2->write_block(bm->block, bm->data) != 0)
+		return -1;
+	bm->dirty = false;
+	return 0;
+}
+
+/*load bitmap block into cache, write back the old one if dirty*/
+static char* bitmap_get(ext2_t* ext2, ext2_bitmap_cache_t* bm, int32_t block) {
+	if(bm->block == block)
+		return bm->data;
+
+	if(bitmap_flush(ext2, bm) != 0)
+		return NULL;
+	bm->block = 0;
+	if(ext2->read_block(block, bm->data) != 0)
+		return NULL;
+	bm->block = block;
+	return bm->data;
 }
 
 static int32_t ext2_idealloc(ext2_t* ext2, int32_t ino) {
-	char buf[EXT2_BLOCK_SIZE];
-	if (ino > (int32_t)ext2->super.s_inodes_count)
+	if (ino <= 0 || ino > (int32_t)ext2->super.s_inodes_count)
 		return -1;
 
 	// get inode bitmap block
-	int32_t index = get_gd_index_by_ino(ext2, ino);
-	if(ext2->read_block(ext2->gds[index].bg_inode_bitmap, buf) != 0)
+	int32_t i = ino - 1;
+	int32_t index = get_gd_index_by_ino(ext2, i);
+	char* buf = bitmap_get(ext2, ext2->inode_bitmap, ext2->gds[index].bg_inode_bitmap);
+	if(buf == NULL)
 		return -1;
 
-	clr_bit(buf, ino-1);
-	// write buf back
-	if(ext2->write_block(ext2->gds[index].bg_inode_bitmap, buf) != 0) // update free inode count in SUPER and GD
-		return -1;
-	inc_free_inodes(ext2, ino);
+	clr_bit(buf, get_ino_in_group(ext2, i, index));
+	ext2->inode_bitmap->dirty = true;
+	// update free inode count in SUPER and GD
+	inc_free_inodes(ext2, i);
 	return 0;
 }
 
 static int32_t ext2_bdealloc(ext2_t* ext2, int32_t block) {
-	char buf[EXT2_BLOCK_SIZE];
 	if (block <= 0)
 		return -1;
 
-	int32_t index = get_gd_index_by_block(ext2, block);
-	if(ext2->read_block(ext2->gds[index].bg_block_bitmap, buf) != 0)
+	int32_t i = block - 1;
+	int32_t index = get_gd_index_by_block(ext2, i);
+	char* buf = bitmap_get(ext2, ext2->block_bitmap, ext2->gds[index].bg_block_bitmap);
+	if(buf == NULL)
 		return -1;
-	clr_bit(buf, block-1);
-	// write buf back
-	if(ext2->write_block(ext2->gds[index].bg_block_bitmap, buf) != 0)
-		return -1;
-	// update free inode count in SUPER and GD
-	inc_free_blocks(ext2, block);
+
+	clr_bit(buf, get_block_in_group(ext2, i, index));
+	ext2->block_bitmap->dirty = true;
+	// update free block count in SUPER and GD
+	inc_free_blocks(ext2, i);
 	return 0;
 }
 
 static uint32_t ext2_ialloc(ext2_t* ext2) {
-	char buf[EXT2_BLOCK_SIZE];
+	char* buf = NULL;
 	int32_t index = 0;
 	uint32_t i;
 	for (i=0; i < ext2->super.s_inodes_count; i++){
 		if(mod_u32(i, ext2->super.s_inodes_per_group) == 0) {
 			index = get_gd_index_by_ino(ext2, i);
-			ext2->read_block(ext2->gds[index].bg_inode_bitmap, buf);
+			if(ext2->gds[index].bg_free_inodes_count == 0) { //skip full group
+				i += ext2->super.s_inodes_per_group - 1;
+				continue;
+			}
+			buf = bitmap_get(ext2, ext2->inode_bitmap, ext2->gds[index].bg_inode_bitmap);
+			if(buf == NULL)
+				return 0;
 		}
 	
 		uint32_t ino = get_ino_in_group(ext2, i, index);
 		if (tst_bit(buf, ino) == 0){
 			set_bit(buf, ino);
-			ext2->write_block(ext2->gds[index].bg_inode_bitmap, buf);
+			ext2->inode_bitmap->dirty = true;
 			// update free inode count in SUPER and GD
 			dec_free_inodes(ext2, i);
 			return (i+1);
@@ -168,34 +203,60 @@ static uint32_t ext2_ialloc(ext2_t* ext2) {
 	return 0;
 } 
 
-static int32_t ext2_balloc(ext2_t* ext2) {
- 	char buf[EXT2_BLOCK_SIZE];
-	int32_t index = 0;
-	uint32_t i;
+/*next-fit block allocation: scan from goal (or the cursor left by the last
+allocation) and wrap around, so consecutive allocations end up contiguous*/
+static int32_t ext2_balloc(ext2_t* ext2, uint32_t goal) {
+	char* buf = NULL;
+	uint32_t count = ext2->super.s_blocks_count;
+	uint32_t i = goal > 0 ? goal - 1 : ext2->balloc_next;
+	uint32_t n = 0;
+
+	while (n < count) {
+		if(i >= count)
+			i = 0;
+		int32_t index = get_gd_index_by_block(ext2, i);
+		uint32_t block = get_block_in_group(ext2, i, index);
+		uint32_t left = ext2->super.s_blocks_per_group - block;
+		if(left > count - i)
+			left = count - i;
+
+		if(ext2->gds[index].bg_free_blocks_count == 0) { //skip full group
+			i += left;
+			n += left;
+			continue;
+		}
+		buf = bitmap_get(ext2, ext2->block_bitmap, ext2->gds[index].bg_block_bitmap);
+		if(buf == NULL)
+			return 0;
 
-	ext2->read_block(ext2->gds[0].bg_block_bitmap, buf);
-	for (i = 0; i < ext2->super.s_blocks_count; i++) {
-		if(mod_u32(i, ext2->super.s_blocks_per_group) == 0) {
-			index = get_gd_index_by_block(ext2, i);
-			ext2->read_block(ext2->gds[index].bg_block_bitmap, buf);
+		if((block & 7) == 0 && left >= 8 && (uint8_t)buf[block >> 3] == 0xff) { //skip full byte
+			i += 8;
+			n += 8;
+			continue;
 		}
 
-		uint32_t block = get_block_in_group(ext2, i, index);
 		if (tst_bit(buf, block) == 0) {
 			set_bit(buf, block);
-			ext2->write_block(ext2->gds[index].bg_block_bitmap, buf);
+			ext2->block_bitmap->dirty = true;
 			dec_free_blocks(ext2, i);
+			ext2->balloc_next = i + 1;
 			return i+1;
 		}
+		i++;
+		n++;
 	}
 	return 0;
 }
 
+static int32_t get_block(ext2_t* ext2, INODE* node, int32_t lbk);
+static void dir_cache_enter(ext2_t* ext2, INODE* ip, const char* name, int32_t ino);
+static void dir_cache_remove(ext2_t* ext2, INODE* ip, const char* name);
+
 static int32_t need_len(int32_t len) {
 	return 4 * ((8 + len + 3) / 4);
 }
 
-static int32_t enter_child(ext2_t* ext2, INODE* pip, int32_t ino, const char *base, int32_t ftype) {
+static int32_t do_enter_child(ext2_t* ext2, INODE* pip, int32_t ino, const char *base, int32_t ftype) {
 	int32_t nlen, ideal_len, remain, i, blk;
 	char buf[EXT2_BLOCK_SIZE];
 	char *cp;
@@ -205,7 +266,7 @@ static int32_t enter_child(ext2_t* ext2, INODE* pip, int32_t ino, const char *ba
 	for(i=0;i<12;i++){
 		//(5) first one creat 
 		if(dp != NULL && pip->i_block[i]==0){
-			blk = ext2_balloc(ext2);
+			blk = ext2_balloc(ext2, 0);
 			if(blk<=0){
 				return -1;
 			}
@@ -258,60 +319,76 @@ static int32_t enter_child(ext2_t* ext2, INODE* pip, int32_t ino, const char *ba
 	return -1;
 }
 
+/*entries are appended without maintaining htree, so drop the index flag
+like old ext2 drivers do, e2fsck -D can rebuild it*/
+static int32_t enter_child(ext2_t* ext2, INODE* pip, int32_t ino, const char *base, int32_t ftype) {
+	if(do_enter_child(ext2, pip, ino, base, ftype) != 0)
+		return -1;
+	pip->i_flags &= ~EXT2_INDEX_FL;
+	dir_cache_enter(ext2, pip, base, ino);
+	return 0;
+}
+
+/*remove entry by merging it into the previous one, the first entry of a
+block is only marked unused*/
 static int32_t ext2_rm_child(ext2_t* ext2, INODE *ip, const char *name) {
-	int32_t i, rec_len, found, first_len;
-	char *cp = NULL, *precp = NULL;
-	DIR *dp = NULL;
 	char buf[EXT2_BLOCK_SIZE];
+	int32_t len = strlen(name);
+	int32_t num = (ip->i_size + EXT2_BLOCK_SIZE - 1) / EXT2_BLOCK_SIZE;
 
-	found = 0;
-	rec_len = 0;
-	first_len = 0;
-	for(i = 0; i<12; i++) {
-		if(ip->i_block[i] == 0) { //cannot find .
-			return -1;
-		}
-		ext2->read_block(ip->i_block[i], buf);
-		cp = buf;
+	dir_cache_remove(ext2, ip, name);
+	for(int32_t i = 0; i<num; i++) {
+		int32_t blk = get_block(ext2, ip, i);
+		if(blk <= 0 || ext2->read_block(blk, buf) != 0)
+			continue;
+
+		char *cp = buf;
+		DIR *prev = NULL;
 		while(cp < buf + EXT2_BLOCK_SIZE) {
-			dp = (DIR *)cp;
-			if(found == 0 && dp->inode!=0 && strcmp(dp->name, name)==0){
-				//(2).1. if (first and only entry in a data block){
-				if(dp->rec_len == EXT2_BLOCK_SIZE){
+			DIR *dp = (DIR *)cp;
+			if(dp->rec_len == 0)
+				break;
+			if(dp->inode != 0 && dp->name_len == len && memcmp(dp->name, name, len) == 0) {
+				if(prev != NULL)
+					prev->rec_len += dp->rec_len;
+				else
 					dp->inode = 0;
-					ext2->write_block(ip->i_block[i], buf);
-					return 0;
-				}
-				//(2).2. else if LAST entry in block
-				else if(precp != NULL && dp->rec_len + (cp - buf) == EXT2_BLOCK_SIZE){
-					dp = (DIR *)precp;
-					dp->rec_len = EXT2_BLOCK_SIZE - (precp - buf);
-					ext2->write_block(ip->i_block[i], buf);
-					return 0;
-				}
-				//(2).3. else: entry is first but not the only entry or in the middle of a block:
-				else{
-					found = 1;
-					rec_len = dp->rec_len;
-					first_len = cp-buf;
-				}
+				return ext2->write_block(blk, buf);
 			}
-			if(found == 0)
-				precp = cp;
+			prev = dp;
 			cp += dp->rec_len;
 		}
-		if(found == 1) {
-			dp->rec_len += rec_len;			
-			char cpbuf[EXT2_BLOCK_SIZE];
-			memcpy(cpbuf, buf, first_len);
-			memcpy(cpbuf + first_len, buf + first_len + dp->rec_len, EXT2_BLOCK_SIZE-(first_len+rec_len));
-			ext2->write_block(ip->i_block[i], cpbuf);
-			return 0;
-		}
 	}
 	return -1;
 }
 
+/*map logical block lbk to disk block, 0 for hole*/
+static int32_t get_block(ext2_t* ext2, INODE* node, int32_t lbk) {
+	//direct blocks
+	if(lbk < 12)
+		return node->i_block[lbk];
+
+	//Indirect blocks contains 256 block number 
+	uint32_t indirect_buf[256];
+	lbk -= 12;
+	if(lbk < 256) {
+		if(node->i_block[12] == 0 || ext2->read_block(node->i_block[12], (char*)indirect_buf) != 0)
+			return 0;
+		return indirect_buf[lbk];
+	}
+
+	//Double indiirect blocks
+	lbk -= 256;
+	if(lbk >= 256*256 || node->i_block[13] == 0)
+		return 0;
+	if(ext2->read_block(node->i_block[13], (char*)indirect_buf) != 0)
+		return 0;
+	int32_t blk = indirect_buf[lbk >> 8];
+	if(blk == 0 || ext2->read_block(blk, (char*)indirect_buf) != 0)
+		return 0;
+	return indirect_buf[lbk & 0xff];
+}
+
 int32_t ext2_read_block(ext2_t* ext2, INODE* node, char *buf, int32_t nbytes, int32_t offset) {
 	//(2) count = 0
 	// avil = fileSize - OFT's offset // number of bytes still available in file.
@@ -328,31 +405,9 @@ int32_t ext2_read_block(ext2_t* ext2, INODE* node, char *buf, int32_t nbytes, in
 	if(nbytes > (EXT2_BLOCK_SIZE - start_byte))
 		nbytes = (EXT2_BLOCK_SIZE - start_byte);
 	//(5) READ
-	//(5).1 direct blocks
-	if(lbk < 12) {
-		blk = node->i_block[lbk];
-	}
-	//(5).2 Indirect blocks contains 256 block number 
-	else if(lbk>=12 && lbk < 256 +12){
-		int32_t indirect_buf[256];
-		ext2->read_block(node->i_block[12], (char*)indirect_buf);
-		blk = indirect_buf[lbk-12];
-	}
-	//(5).3 Double indiirect blocks
-	else{
-		int32_t count = lbk -12 -256;
-		//total blocks = count / 256
-		//offset of certain block = count %256
-		int32_t num = count / 256;
-		int32_t pos_offset = count % 256;
-		int32_t double_buf1[256];
-		if(ext2->read_block(node->i_block[13], (char*)double_buf1) != 0)
-			return -1;
-		int32_t double_buf2[256];
-		if(ext2->read_block(double_buf1[num], (char*)double_buf2) != 0)
-			return -1;
-		blk = double_buf2[pos_offset];
-	}
+	blk = get_block(ext2, node, lbk);
+	if(blk <= 0)
+		return -1;
 
 	char readbuf[EXT2_BLOCK_SIZE];
 	if(ext2->read_block(blk, readbuf) != 0)
@@ -395,28 +450,158 @@ int32_t ext2_read(ext2_t* ext2, INODE* node, char *buf, int32_t nbytes, int32_t
 	return ret;
 }
 
-static INODE* get_node_by_ino(ext2_t* ext2, int32_t ino, char* buf) {
+/*inode table block and slot of ino*/
+static int32_t get_node_block(ext2_t* ext2, int32_t ino, int32_t* offset) {
 	int32_t bgid = get_gd_index_by_ino(ext2, ino);
 	ino = get_ino_in_group(ext2, ino, bgid);
-	int32_t offset = (ino-1)%8;
+	*offset = (ino-1)%8;
+	return ext2->gds[bgid].bg_inode_table + 	((ino-1)/8);
+}
+
+/*write back all dirty cached inodes living in the same inode table block as c*/
+static int32_t node_cache_flush(ext2_t* ext2, ext2_inode_cache_t* c) {
+	if(!c->dirty)
+		return 0;
+
+	int32_t offset;
+	int32_t blk = get_node_block(ext2, c->ino, &offset);
+	char buf[EXT2_BLOCK_SIZE];
+	if(ext2->read_block(blk, buf) != 0)
+		return -1;
 
-	int32_t blk = ext2->gds[bgid].bg_inode_table + 	((ino-1)/8);
-	ext2->read_block(blk, buf);
-	return ((INODE *)buf) + offset;
+	for(int32_t i=0; i<EXT2_INODE_CACHE_MAX; i++) {
+		ext2_inode_cache_t* n = &ext2->inodes[i];
+		if(n->ino == 0 || !n->dirty)
+			continue;
+		int32_t noffset;
+		if(get_node_block(ext2, n->ino, &noffset) != blk)
+			continue;
+		((INODE *)buf)[noffset] = n->node;
+		n->dirty = false;
+	}
+	return ext2->write_block(blk, buf);
 }
 
-void put_node(ext2_t* ext2, int32_t ino, INODE *node) {
-	int32_t bgid = get_gd_index_by_ino(ext2, ino);
-	ino = get_ino_in_group(ext2, ino, bgid);
-	int32_t offset = (ino-1)%8;
+static ext2_inode_cache_t* node_cache_find(ext2_t* ext2, int32_t ino) {
+	for(int32_t i=0; i<EXT2_INODE_CACHE_MAX; i++) {
+		ext2_inode_cache_t* c = &ext2->inodes[i];
+		if(c->ino == ino) {
+			c->stamp = ++ext2->inode_stamp;
+			return c;
+		}
+	}
+	return NULL;
+}
+
+/*take a free slot, or evict the least recently used one*/
+static ext2_inode_cache_t* node_cache_slot(ext2_t* ext2) {
+	ext2_inode_cache_t* ret = &ext2->inodes[0];
+	for(int32_t i=0; i<EXT2_INODE_CACHE_MAX; i++) {
+		ext2_inode_cache_t* c = &ext2->inodes[i];
+		if(c->ino == 0) {
+			ret = c;
+			break;
+		}
+		if(c->stamp < ret->stamp)
+			ret = c;
+	}
+
+	if(ret->ino != 0 && node_cache_flush(ext2, ret) != 0)
+		return NULL;
+	ret->ino = 0;
+	ret->dirty = false;
+	return ret;
+}
+
+static ext2_inode_cache_t* node_cache_get(ext2_t* ext2, int32_t ino) {
+	if(ino <= 0 || ino > (int32_t)ext2->super.s_inodes_count)
+		return NULL;
+
+	ext2_inode_cache_t* c = node_cache_find(ext2, ino);
+	if(c != NULL)
+		return c;
+
+	c = node_cache_slot(ext2);
+	if(c == NULL)
+		return NULL;
+
+	int32_t offset;
+	int32_t blk = get_node_block(ext2, ino, &offset);
+	char buf[EXT2_BLOCK_SIZE];
+	if(ext2->read_block(blk, buf) != 0)
+		return NULL;
+	c->node = ((INODE *)buf)[offset];
+	c->ino = ino;
+	c->stamp = ++ext2->inode_stamp;
+	return c;
+}
+
+static INODE* get_node_by_ino(ext2_t* ext2, int32_t ino, char* buf) {
+	ext2_inode_cache_t* c = node_cache_get(ext2, ino);
+	if(c == NULL)
+		return NULL;
+	memcpy(buf, &c->node, sizeof(INODE));
+	return (INODE *)buf;
+}
 
-	//int32_t blk = bgid*ext2->super.s_blocks_per_group + ext2->gds[bgid].bg_inode_table + 	((ino-1)/8);
-	int32_t blk = ext2->gds[bgid].bg_inode_table + 	((ino-1)/8);
+/*write an inode straight into its table block, when it can't be cached*/
+static int32_t node_write(ext2_t* ext2, int32_t ino, INODE* node) {
+	int32_t offset;
+	int32_t blk = get_node_block(ext2, ino, &offset);
 	char buf[EXT2_BLOCK_SIZE];
-	ext2->read_block(blk, buf);
-	INODE *ip = ((INODE *)buf) + offset;
-	*ip = *node;
-	ext2->write_block(blk, buf);	
+	if(ext2->read_block(blk, buf) != 0)
+		return -1;
+	((INODE *)buf)[offset] = *node;
+	return ext2->write_block(blk, buf);
+}
+
+int32_t put_node(ext2_t* ext2, int32_t ino, INODE *node) {
+	ext2_inode_cache_t* c = node_cache_find(ext2, ino);
+	if(c == NULL) {
+		c = node_cache_slot(ext2);
+		if(c == NULL) //no victim could be flushed, don't lose the update
+			return node_write(ext2, ino, node);
+		c->ino = ino;
+		c->stamp = ++ext2->inode_stamp;
+	}
+	c->node = *node;
+	c->dirty = true;
+	return 0;
+}
+
+int32_t ext2_sync(ext2_t* ext2) {
+	int32_t res = 0;
+	if(ext2->write_block == NULL)
+		return 0;
+
+	for(int32_t i=0; i<EXT2_INODE_CACHE_MAX; i++) {
+		if(ext2->inodes[i].ino != 0 && node_cache_flush(ext2, &ext2->inodes[i]) != 0)
+			res = -1;
+	}
+
+	if(bitmap_flush(ext2, ext2->block_bitmap) != 0)
+		res = -1;
+	if(bitmap_flush(ext2, ext2->inode_bitmap) != 0)
+		res = -1;
+
+	//gds share blocks, write each dirty gd block once
+	int32_t gd_num = div_u32(EXT2_BLOCK_SIZE, sizeof(GD));
+	for(int32_t i=0; i<ext2->group_num; i++) {
+		if(!ext2->gds_dirty[i])
+			continue;
+		if(set_gd(ext2, i) != 0)
+			res = -1;
+		int32_t first = i - mod_u32(i, gd_num);
+		for(int32_t j=first; j<first+gd_num && j<ext2->group_num; j++)
+			ext2->gds_dirty[j] = false;
+	}
+
+	if(ext2->super_dirty) {
+		if(set_super(ext2) != 0)
+			res = -1;
+		ext2->super_dirty = false;
+	}
+	return res;
 }
 
 int32_t ext2_create_dir(ext2_t* ext2, INODE* father_inp, const char *base, int32_t owner) { //mode file or dir
@@ -424,9 +609,11 @@ int32_t ext2_create_dir(ext2_t* ext2, INODE* father_inp, const char *base, int32
 	char buf[EXT2_BLOCK_SIZE];
 
 	ino = ext2_ialloc(ext2);
-	blk = ext2_balloc(ext2);
+	blk = ext2_balloc(ext2, 0);
 
 	INODE* inp = get_node_by_ino(ext2, ino, buf);
+	if(inp == NULL)
+		return -1;
 	inp->i_mode = 0;//TODO EXT2_DIR_MODE;
 	inp->i_uid  = owner & 0xffff;
 	inp->i_gid  = (owner >> 16) & 0xffff;
@@ -441,7 +628,8 @@ int32_t ext2_create_dir(ext2_t* ext2, INODE* father_inp, const char *base, int32
 		inp->i_block[i] = 0;
 	}
 	//mip->dirty = 1;
-	put_node(ext2, ino, inp);
+	if(put_node(ext2, ino, inp) != 0)
+		return -1;
 	if(enter_child(ext2, father_inp, ino, base, EXT2_FT_DIR) < 0)
 		return -1;
 	return ino;
@@ -454,6 +642,8 @@ int32_t ext2_create_file(ext2_t* ext2, INODE* father_inp, const char *base, int3
 	ino = ext2_ialloc(ext2);
 
 	INODE* inp = get_node_by_ino(ext2, ino, buf);
+	if(inp == NULL)
+		return -1;
 	inp->i_mode = 0; //TODO EXT2_FILE_MODE;
 	inp->i_uid  = owner & 0xffff;
 	inp->i_gid  = (owner >> 16) & 0xffff;
@@ -467,106 +657,596 @@ int32_t ext2_create_file(ext2_t* ext2, INODE* father_inp, const char *base, int3
 		inp->i_block[i] = 0;
 	}
 	//mip->dirty = 1;
-	put_node(ext2, ino, inp);
+	if(put_node(ext2, ino, inp) != 0)
+		return -1;
 
 	if(enter_child(ext2, father_inp, ino, base, EXT2_FT_FILE) < 0)
 		return -1;
 	return ino;
 }
 
+/*indirect block kept in memory while mapping a run of logical blocks*/
+typedef struct {
+	int32_t blk;
+	bool dirty;
+	uint32_t data[EXT2_BLOCK_SIZE/4];
+} ind_block_t;
+
+static int32_t ind_flush(ext2_t* ext2, ind_block_t* ind) {
+	if(ind->blk == 0 || !ind->dirty)
+		return 0;
+	if(ext2->write_block(ind->blk, (char*)ind->data) != 0)
+		return -1;
+	ind->dirty = false;
+	return 0;
+}
+
+static int32_t ind_load(ext2_t* ext2, ind_block_t* ind, int32_t blk, bool fresh) {
+	if(ind->blk == blk)
+		return 0;
+	if(ind_flush(ext2, ind) != 0)
+		return -1;
+
+	ind->blk = 0;
+	if(fresh)
+		memset(ind->data, 0, EXT2_BLOCK_SIZE);
+	else if(ext2->read_block(blk, (char*)ind->data) != 0)
+		return -1;
+	ind->blk = blk;
+	ind->dirty = fresh;
+	return 0;
+}
+
+/*get block slot *slot, allocate it near *goal if empty*/
+static int32_t fill_slot(ext2_t* ext2, INODE* node, uint32_t* slot, uint32_t* goal, bool* fresh) {
+	*fresh = false;
+	if(*slot == 0) {
+		int32_t blk = ext2_balloc(ext2, *goal);
+		if(blk <= 0)
+			return 0;
+		*slot = blk;
+		node->i_blocks += EXT2_BLOCK_SIZE / 512;
+		*fresh = true;
+	}
+	*goal = *slot + 1;
+	return *slot;
+}
+
+/*map logical block lbk to a disk block, allocating data and indirect blocks on demand*/
+static int32_t map_block(ext2_t* ext2, INODE* node, int32_t lbk, ind_block_t* ind, ind_block_t* dind, uint32_t* goal, bool* fresh) {
+	bool ifresh;
+	int32_t blk;
+
+	if(lbk < 12)
+		return fill_slot(ext2, node, &node->i_block[lbk], goal, fresh);
+
+	lbk -= 12;
+	if(lbk < 256) {
+		if(fill_slot(ext2, node, &node->i_block[12], goal, &ifresh) == 0 ||
+				ind_load(ext2, ind, node->i_block[12], ifresh) != 0)
+			return 0;
+	}
+	else {
+		lbk -= 256;
+		if(lbk >= 256*256)
+			return 0;
+		if(fill_slot(ext2, node, &node->i_block[13], goal, &ifresh) == 0 ||
+				ind_load(ext2, dind, node->i_block[13], ifresh) != 0)
+			return 0;
+		uint32_t* slot = &dind->data[lbk >> 8];
+		uint32_t old = *slot;
+		if(fill_slot(ext2, node, slot, goal, &ifresh) == 0)
+			return 0;
+		if(*slot != old)
+			dind->dirty = true;
+		if(ind_load(ext2, ind, *slot, ifresh) != 0)
+			return 0;
+		lbk &= 0xff;
+	}
+
+	blk = fill_slot(ext2, node, &ind->data[lbk], goal, fresh);
+	if(*fresh)
+		ind->dirty = true;
+	return blk;
+}
+
+/*write nbytes at offset, full blocks go straight to disk without read-modify-write,
+indirect blocks are written once per call and the size is only updated in node*/
 int32_t ext2_write(ext2_t* ext2, INODE* node, const char *data, int32_t nbytes, int32_t offset) {
 	static char buf[EXT2_BLOCK_SIZE];
-	const char *cq = data;
-	char *cp;
-	//(2)
-	int32_t blk =0, lbk = 0, start_byte = 0, remain = 0;
+	static ind_block_t ind, dind;
 	int32_t nbytes_copy = 0;
-	//(3)
-	/*(4) Compute LOGICAL BLOCK number lbk and start_byte in that block from offset;
-		lbk       = oftp->offset / EXT2_BLOCK_SIZE;
-		start_byte = oftp->offset % EXT2_BLOCK_SIZE;*/	
-	lbk = offset / EXT2_BLOCK_SIZE;
-	start_byte = offset % EXT2_BLOCK_SIZE;
-	//5.1 direct
-	if(lbk < 12){
-		//if its the first one of the new block, allocatea new one
-		if(node->i_block[lbk] == 0){
-			node->i_block[lbk] = ext2_balloc(ext2);
+	uint32_t goal = 0;
+
+	ind.blk = 0;
+	dind.blk = 0;
+	int32_t lbk = offset / EXT2_BLOCK_SIZE;
+	if(lbk > 0 && lbk <= 12 && node->i_block[lbk-1] != 0)
+		goal = node->i_block[lbk-1] + 1; //keep file contiguous
+
+	while(nbytes > 0) {
+		bool fresh;
+		int32_t start_byte = offset % EXT2_BLOCK_SIZE;
+		int32_t min = EXT2_BLOCK_SIZE - start_byte;
+		if(min > nbytes)
+			min = nbytes;
+
+		lbk = offset / EXT2_BLOCK_SIZE;
+		int32_t blk = map_block(ext2, node, lbk, &ind, &dind, &goal, &fresh);
+		if(blk == 0)
+			break;
+
+		if(min == EXT2_BLOCK_SIZE) {
+			if(ext2->write_block(blk, data) != 0)
+				break;
 		}
-		blk = node->i_block[lbk];
-	}
-	//5.2 indirect 
-	else if(lbk >=12 && lbk < 256+12){
-		int32_t* indirect_buf = (int32_t*)buf;
-		//if its the first one of the new block, allocatea new one
-		if(node->i_block[12] == 0){
-			node->i_block[12] = ext2_balloc(ext2);
-			memset(indirect_buf, 0, EXT2_BLOCK_SIZE);
-			ext2->write_block(node->i_block[12], (char*)indirect_buf);
+		else {
+			if(fresh)
+				memset(buf, 0, EXT2_BLOCK_SIZE);
+			else if(ext2->read_block(blk, buf) != 0)
+				break;
+			memcpy(buf + start_byte, data, min);
+			if(ext2->write_block(blk, buf) != 0)
+				break;
 		}
-		ext2->read_block(node->i_block[12], (char*)indirect_buf);
-		if(indirect_buf[lbk-12] == 0){
-			indirect_buf[lbk-12] = ext2_balloc(ext2);
-			ext2->write_block(node->i_block[12], (char*)indirect_buf);
+
+		data += min;
+		nbytes -= min;
+		offset += min;
+		nbytes_copy += min;
+	}
+
+	ind_flush(ext2, &ind);
+	ind_flush(ext2, &dind);
+	if(offset > (int32_t)node->i_size)
+		node->i_size = offset;
+	return nbytes_copy;
+}
+
+/*find name in one directory block, -1 if not there*/
+static int32_t dir_block_find(const char* buf, const char* name, int32_t len) {
+	const char* cp = buf;
+	while(cp < buf + EXT2_BLOCK_SIZE) {
+		const DIR* dp = (const DIR*)cp;
+		if(dp->rec_len == 0)
+			break;
+		if(dp->inode != 0 && dp->name_len == len && memcmp(dp->name, name, len) == 0)
+			return dp->inode;
+		cp += dp->rec_len;
+	}
+	return -1;
+}
+
+static inline int32_t dir_blocks(INODE* ip) {
+	return (ip->i_size + EXT2_BLOCK_SIZE - 1) / EXT2_BLOCK_SIZE;
+}
+
+static int32_t linear_search(ext2_t* ext2, INODE *ip, const char *name, int32_t len) {
+	char buf[EXT2_BLOCK_SIZE];
+	int32_t num = dir_blocks(ip);
+	for (int32_t i=0; i<num; i++){
+		int32_t blk = get_block(ext2, ip, i);
+		if(blk <= 0 || ext2->read_block(blk, buf) != 0)
+			continue;
+		int32_t ino = dir_block_find(buf, name, len);
+		if(ino > 0)
+			return ino;
+	}
+	return -1;
+}
+
+/*ext2 dir_index (htree) hashes, see linux fs/ext4/hash.c*/
+#define DX_HASH_LEGACY            0
+#define DX_HASH_HALF_MD4          1
+#define DX_HASH_TEA               2
+#define DX_HASH_LEGACY_UNSIGNED   3
+#define DX_HASH_HALF_MD4_UNSIGNED 4
+#define DX_HASH_TEA_UNSIGNED      5
+
+static inline uint32_t rol32(uint32_t w, uint32_t s) {
+	return (w << s) | (w >> (32 - s));
+}
+
+static void tea_transform(uint32_t buf[4], const uint32_t in[4]) {
+	uint32_t sum = 0;
+	uint32_t b0 = buf[0], b1 = buf[1];
+	uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+	int32_t n = 16;
+	do {
+		sum += 0x9E3779B9;
+		b0 += ((b1 << 4)+a) ^ (b1+sum) ^ ((b1 >> 5)+b);
+		b1 += ((b0 << 4)+c) ^ (b0+sum) ^ ((b0 >> 5)+d);
+	} while(--n);
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+#define ROUND(f, a, b, c, d, x, s) (a += f(b, c, d) + x, a = rol32(a, s))
+#define K1 0
+#define K2 013240474631UL
+#define K3 015666365641UL
+
+static void half_md4_transform(uint32_t buf[4], const uint32_t in[8]) {
+	uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	ROUND(F, a, b, c, d, in[0] + K1,  3);
+	ROUND(F, d, a, b, c, in[1] + K1,  7);
+	ROUND(F, c, d, a, b, in[2] + K1, 11);
+	ROUND(F, b, c, d, a, in[3] + K1, 19);
+	ROUND(F, a, b, c, d, in[4] + K1,  3);
+	ROUND(F, d, a, b, c, in[5] + K1,  7);
+	ROUND(F, c, d, a, b, in[6] + K1, 11);
+	ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	ROUND(G, a, b, c, d, in[1] + K2,  3);
+	ROUND(G, d, a, b, c, in[3] + K2,  5);
+	ROUND(G, c, d, a, b, in[5] + K2,  9);
+	ROUND(G, b, c, d, a, in[7] + K2, 13);
+	ROUND(G, a, b, c, d, in[0] + K2,  3);
+	ROUND(G, d, a, b, c, in[2] + K2,  5);
+	ROUND(G, c, d, a, b, in[4] + K2,  9);
+	ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	ROUND(H, a, b, c, d, in[3] + K3,  3);
+	ROUND(H, d, a, b, c, in[7] + K3,  9);
+	ROUND(H, c, d, a, b, in[2] + K3, 11);
+	ROUND(H, b, c, d, a, in[6] + K3, 15);
+	ROUND(H, a, b, c, d, in[1] + K3,  3);
+	ROUND(H, d, a, b, c, in[5] + K3,  9);
+	ROUND(H, c, d, a, b, in[0] + K3, 11);
+	ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+static uint32_t dx_hack_hash(const char *name, int32_t len, bool unsign) {
+	uint32_t hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	while (len--) {
+		int32_t c = unsign ? (int32_t)(uint8_t)*name : (int32_t)(int8_t)*name;
+		name++;
+		hash = hash1 + (hash0 ^ (uint32_t)(c * 7152373));
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	return hash0 << 1;
+}
+
+static void str2hashbuf(const char *msg, int32_t len, uint32_t *buf, int32_t num, bool unsign) {
+	uint32_t pad, val;
+	int32_t i;
+
+	pad = (uint32_t)len | ((uint32_t)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num*4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		int32_t c = unsign ? (int32_t)(uint8_t)msg[i] : (int32_t)(int8_t)msg[i];
+		val = (uint32_t)c + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
 		}
-		blk = indirect_buf[lbk-12]; 
 	}
-	else{
-		return nbytes_copy;
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+static uint32_t dx_hash(ext2_t* ext2, const char* name, int32_t len, uint8_t version) {
+	uint32_t buf[4], in[8], hash = 0;
+	bool unsign = false;
+
+	buf[0] = 0x67452301;
+	buf[1] = 0xefcdab89;
+	buf[2] = 0x98badcfe;
+	buf[3] = 0x10325476;
+	for(int32_t i=0; i<4; i++) {
+		if(ext2->super.s_hash_seed[i] != 0) {
+			memcpy(buf, ext2->super.s_hash_seed, sizeof(buf));
+			break;
+		}
 	}
 
-	ext2->read_block(blk, buf);
-	cp = buf + start_byte;
-	remain = EXT2_BLOCK_SIZE - start_byte;
-	while(remain > 0){
-		int32_t min = 0;
-		if(nbytes<=remain){
-			min = nbytes;
+	switch(version) {
+	case DX_HASH_LEGACY_UNSIGNED:
+		unsign = true;
+		/* fall through */
+	case DX_HASH_LEGACY:
+		hash = dx_hack_hash(name, len, unsign);
+		break;
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		unsign = true;
+		/* fall through */
+	case DX_HASH_HALF_MD4:
+		while(len > 0) {
+			str2hashbuf(name, len, in, 8, unsign);
+			half_md4_transform(buf, in);
+			len -= 32;
+			name += 32;
 		}
-		else{
-			min = remain;
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA_UNSIGNED:
+		unsign = true;
+		/* fall through */
+	case DX_HASH_TEA:
+		while(len > 0) {
+			str2hashbuf(name, len, in, 4, unsign);
+			tea_transform(buf, in);
+			len -= 16;
+			name += 16;
 		}
-		memcpy(cp, cq, nbytes);
-		nbytes_copy += min;
-		nbytes -= min;
-		remain -= min;
-		offset += min;
-		if(offset > (int32_t)node->i_size){
-			node->i_size += min;
-		}			
-		if(nbytes<=0){
+		hash = buf[0];
+		break;
+	}
+
+	hash = hash & ~1;
+	if (hash == (0x7fffffffu << 1))
+		hash = (0x7fffffffu - 1) << 1;
+	return hash;
+}
+
+typedef struct {
+	uint32_t reserved_zero;
+	uint8_t hash_version;
+	uint8_t info_length;
+	uint8_t indirect_levels;
+	uint8_t unused_flags;
+} dx_root_info_t;
+
+typedef struct {
+	uint32_t hash; /*limit and count in the first entry*/
+	uint32_t block;
+} dx_entry_t;
+
+static inline uint16_t dx_count(const dx_entry_t* entries) {
+	return ((const uint16_t*)entries)[1];
+}
+
+static inline bool dir_indexed(ext2_t* ext2, INODE* ip) {
+	return (ip->i_flags & EXT2_INDEX_FL) != 0 &&
+		(ext2->super.s_feature_compat & EXT2_FEATURE_COMPAT_DIR_INDEX) != 0;
+}
+
+/*htree lookup, reads only the index path and the leaf block(s).
+return -2 if the index looks broken so the caller scans linearly*/
+static int32_t htree_search(ext2_t* ext2, INODE* ip, const char* name, int32_t len) {
+	char buf[EXT2_BLOCK_SIZE];
+	int32_t blk = get_block(ext2, ip, 0);
+	if(blk <= 0 || ext2->read_block(blk, buf) != 0)
+		return -2;
+
+	//root block: "." (12 bytes), ".." (12 bytes), then dx_root_info
+	const dx_root_info_t* info = (const dx_root_info_t*)(buf + 24);
+	uint8_t version = info->hash_version;
+	if(info->reserved_zero != 0 || info->info_length != 8 ||
+			info->indirect_levels > 1 || version > DX_HASH_TEA)
+		return -2;
+	if((ext2->super.s_flags & EXT2_FLAGS_UNSIGNED_HASH) != 0)
+		version += 3;
+
+	uint32_t hash = dx_hash(ext2, name, len, version);
+	int32_t levels = info->indirect_levels;
+	const dx_entry_t* entries = (const dx_entry_t*)(buf + 24 + info->info_length);
+	int32_t max = (EXT2_BLOCK_SIZE - 32) / sizeof(dx_entry_t);
+	uint32_t lbk;
+	uint32_t next_hash;
+
+	while(true) {
+		int32_t count = dx_count(entries);
+		if(count == 0 || count > max)
+			return -2;
+
+		//last entry with hash <= target, entries[0] covers everything below entries[1]
+		int32_t lo = 1, hi = count - 1;
+		while(lo <= hi) {
+			int32_t mid = (lo + hi) / 2;
+			if(entries[mid].hash > hash)
+				hi = mid - 1;
+			else
+				lo = mid + 1;
+		}
+		lbk = entries[lo - 1].block;
+		next_hash = lo < count ? entries[lo].hash : 0;
+
+		if(levels == 0)
+			break;
+		levels--;
+		blk = get_block(ext2, ip, lbk);
+		if(blk <= 0 || ext2->read_block(blk, buf) != 0)
+			return -2;
+		entries = (const dx_entry_t*)(buf + 8); //skip fake dirent
+		max = (EXT2_BLOCK_SIZE - 8) / sizeof(dx_entry_t);
+	}
+
+	while(true) {
+		blk = get_block(ext2, ip, lbk);
+		if(blk <= 0 || ext2->read_block(blk, buf) != 0)
+			return -2;
+		int32_t ino = dir_block_find(buf, name, len);
+		if(ino > 0)
+			return ino;
+		//hash collision continued in the next leaf (only followed inside one index block)
+		if((next_hash & 1) == 0 || (next_hash & ~1) != hash)
 			break;
+		lbk++;
+		next_hash = 0;
+	}
+	return -1;
+}
+
+/*in-memory name hash of recently searched non-indexed directories,
+keyed by the first data block of the directory*/
+#define DIR_CACHE_MAX    8
+#define DIR_HASH_BUCKETS 128
+
+typedef struct dir_name {
+	struct dir_name* next;
+	int32_t ino;
+	uint8_t len;
+	char name[];
+} dir_name_t;
+
+struct ext2_dir_cache {
+	uint32_t key; /*0 for free slot*/
+	uint32_t stamp;
+	dir_name_t* buckets[DIR_HASH_BUCKETS];
+};
+
+static uint32_t _dir_stamp = 0;
+
+static inline uint32_t name_hash(const char* name, int32_t len) {
+	uint32_t h = 2166136261u;
+	while(len-- > 0)
+		h = (h ^ (uint8_t)*name++) * 16777619u;
+	return h & (DIR_HASH_BUCKETS - 1);
+}
+
+static void dir_cache_free(struct ext2_dir_cache* dc) {
+	for(int32_t i=0; i<DIR_HASH_BUCKETS; i++) {
+		dir_name_t* n = dc->buckets[i];
+		while(n != NULL) {
+			dir_name_t* next = n->next;
+			free(n);
+			n = next;
 		}
+		dc->buckets[i] = NULL;
 	}
-	ext2->write_block(blk, buf);
-	return nbytes_copy;
+	dc->key = 0;
 }
 
-static int32_t search(ext2_t* ext2, INODE *ip, const char *name) {
-	int32_t i; 
-	char c, *cp;
-	DIR  *dp;
-	char buf[EXT2_BLOCK_SIZE];
+static struct ext2_dir_cache* dir_cache_find(ext2_t* ext2, INODE* ip) {
+	if(ext2->dirs == NULL || ip->i_block[0] == 0)
+		return NULL;
+	for(int32_t i=0; i<DIR_CACHE_MAX; i++) {
+		if(ext2->dirs[i].key == ip->i_block[0])
+			return &ext2->dirs[i];
+	}
+	return NULL;
+}
+
+static int32_t dir_cache_add(struct ext2_dir_cache* dc, const char* name, int32_t len, int32_t ino) {
+	dir_name_t* n = (dir_name_t*)malloc(sizeof(dir_name_t) + len);
+	if(n == NULL)
+		return -1;
+	n->ino = ino;
+	n->len = len;
+	memcpy(n->name, name, len);
+	uint32_t h = name_hash(name, len);
+	n->next = dc->buckets[h];
+	dc->buckets[h] = n;
+	return 0;
+}
+
+static void dir_cache_del(struct ext2_dir_cache* dc, const char* name, int32_t len) {
+	dir_name_t** pn = &dc->buckets[name_hash(name, len)];
+	while(*pn != NULL) {
+		dir_name_t* n = *pn;
+		if(n->len == len && memcmp(n->name, name, len) == 0) {
+			*pn = n->next;
+			free(n);
+			return;
+		}
+		pn = &n->next;
+	}
+}
+
+static void dir_cache_drop(ext2_t* ext2, INODE* ip) {
+	struct ext2_dir_cache* dc = dir_cache_find(ext2, ip);
+	if(dc != NULL)
+		dir_cache_free(dc);
+}
+
+/*get name hash of directory, build it with one scan of all dir blocks on miss*/
+static struct ext2_dir_cache* dir_cache_get(ext2_t* ext2, INODE* ip) {
+	struct ext2_dir_cache* dc = dir_cache_find(ext2, ip);
+	if(dc != NULL) {
+		dc->stamp = ++_dir_stamp;
+		return dc;
+	}
+	if(ext2->dirs == NULL || ip->i_block[0] == 0)
+		return NULL;
+
+	dc = &ext2->dirs[0];
+	for(int32_t i=0; i<DIR_CACHE_MAX; i++) {
+		if(ext2->dirs[i].key == 0) {
+			dc = &ext2->dirs[i];
+			break;
+		}
+		if(ext2->dirs[i].stamp < dc->stamp)
+			dc = &ext2->dirs[i];
+	}
+	dir_cache_free(dc);
 
-	for (i=0; i<12; i++){
-		if ( ip->i_block[i] ){
-			ext2->read_block(ip->i_block[i], buf);
-			dp = (DIR *)buf;
-			cp = buf;
-			while (cp < &buf[EXT2_BLOCK_SIZE]){
-				if(dp->name_len == 0)
-					break;
-				c = dp->name[dp->name_len];  // save last byte
-				dp->name[dp->name_len] = 0;   
-				if (strcmp(dp->name, name) == 0 ){
-					return dp->inode;
-				}
-				dp->name[dp->name_len] = c; // restore that last byte
-				cp += dp->rec_len;
-				dp = (DIR *)cp;
+	char buf[EXT2_BLOCK_SIZE];
+	int32_t num = dir_blocks(ip);
+	for(int32_t i=0; i<num; i++) {
+		int32_t blk = get_block(ext2, ip, i);
+		if(blk <= 0 || ext2->read_block(blk, buf) != 0)
+			continue;
+		const char* cp = buf;
+		while(cp < buf + EXT2_BLOCK_SIZE) {
+			const DIR* dp = (const DIR*)cp;
+			if(dp->rec_len == 0)
+				break;
+			if(dp->inode != 0 && dp->name_len > 0 &&
+					dir_cache_add(dc, dp->name, dp->name_len, dp->inode) != 0) {
+				dir_cache_free(dc);
+				return NULL;
 			}
+			cp += dp->rec_len;
 		}
 	}
+	dc->key = ip->i_block[0];
+	dc->stamp = ++_dir_stamp;
+	return dc;
+}
+
+static void dir_cache_enter(ext2_t* ext2, INODE* ip, const char* name, int32_t ino) {
+	struct ext2_dir_cache* dc = dir_cache_find(ext2, ip);
+	if(dc != NULL && dir_cache_add(dc, name, strlen(name), ino) != 0)
+		dir_cache_free(dc);
+}
+
+static void dir_cache_remove(ext2_t* ext2, INODE* ip, const char* name) {
+	struct ext2_dir_cache* dc = dir_cache_find(ext2, ip);
+	if(dc != NULL)
+		dir_cache_del(dc, name, strlen(name));
+}
+
+static int32_t search(ext2_t* ext2, INODE *ip, const char *name) {
+	int32_t len = strlen(name);
+	if(len == 0 || len > 255)
+		return -1;
+
+	if(dir_indexed(ext2, ip)) {
+		int32_t ino = htree_search(ext2, ip, name, len);
+		if(ino != -2)
+			return ino;
+	}
+
+	struct ext2_dir_cache* dc = dir_cache_get(ext2, ip);
+	if(dc == NULL)
+		return linear_search(ext2, ip, name, len);
+
+	dir_name_t* n = dc->buckets[name_hash(name, len)];
+	while(n != NULL) {
+		if(n->len == len && memcmp(n->name, name, len) == 0)
+			return n->ino;
+		n = n->next;
+	}
 	return -1;
 }
 
@@ -611,25 +1291,21 @@ int32_t ext2_ino_by_fname(ext2_t* ext2, const char* filename) {
 	depth = split_fname(filename, name);
 
 	ino = -1;
-	for (int32_t j=0; j<ext2->group_num; j++) {
-		if(ext2->read_block(ext2->gds[j].bg_inode_table, buf) == 0) {// read first inode block
-			ip = ((INODE *)buf) + 1;   // ip->root inode #2
-			/* serach for system name */
-			for (i=0; i<depth; i++) {
-				ino = search(ext2, ip, CS(name[i]));
-				if (ino < 0) {
-					ino = -1;
-					break;
-				}
-				ip = get_node_by_ino(ext2, ino, buf);
-				if(ip == NULL) {
-					ino = -1;
-					break;
-				}
+	ip = get_node_by_ino(ext2, 2, buf); // root inode #2, may be dirty in cache
+	if(ip != NULL) {
+		/* serach for system name */
+		for (i=0; i<depth; i++) {
+			ino = search(ext2, ip, CS(name[i]));
+			if (ino < 0) {
+				ino = -1;
+				break;
+			}
+			ip = get_node_by_ino(ext2, ino, buf);
+			if(ip == NULL) {
+				ino = -1;
+				break;
 			}
 		}
-		if(ino >= 0)
-			break;
 	}
 	for (i=0; i<depth; i++) {
 		str_free(name[i]);
@@ -666,14 +1342,13 @@ int32_t ext2_unlink(ext2_t* ext2, const char* fname) {
 	int32_t ino = search(ext2, fnode, CS(name));
 	ext2_rm_child(ext2, fnode, CS(name));
 	str_free(name);
-	put_node(ext2, fino, fnode);
-
-	if(ino < 0)
+	if(put_node(ext2, fino, fnode) != 0 || ino < 0)
 		return -1;
 	INODE* node = get_node_by_ino(ext2, ino, buf);
 	if(node == NULL) 
 		return -1;
 
+	dir_cache_drop(ext2, node);
 	//(3) -(5)
 	if(node->i_links_count > 0){
 		//node->dirty = 1;
@@ -688,16 +1363,14 @@ int32_t ext2_unlink(ext2_t* ext2, const char* fname) {
 	//}
 	ext2_idealloc(ext2, ino);
 	//node->dirty = 1;
-	put_node(ext2, ino, node);	
-	return 0;
+	return put_node(ext2, ino, node);
 }
 
 int32_t ext2_node_by_ino(ext2_t* ext2, int32_t ino, INODE* node) {
-	char buf[EXT2_BLOCK_SIZE];
-	INODE* p = get_node_by_ino(ext2, ino, buf);
-	if(p == NULL)
+	ext2_inode_cache_t* c = node_cache_get(ext2, ino);
+	if(c == NULL)
 		return -1;
-	memcpy(node, p, sizeof(INODE));
+	memcpy(node, &c->node, sizeof(INODE));
 	return 0;
 }
 
@@ -716,6 +1389,8 @@ static int32_t get_gds(ext2_t* ext2) {
   int32_t gd_size = sizeof(GD);
   ext2->group_num = get_gd_num(ext2);
   ext2->gds = (GD*)malloc(gd_size * ext2->group_num);
+  ext2->gds_dirty = (bool*)malloc(sizeof(bool) * ext2->group_num);
+  memset(ext2->gds_dirty, 0, sizeof(bool) * ext2->group_num);
 
   int32_t gd_num = div_u32(EXT2_BLOCK_SIZE, gd_size);
   int32_t i = 2;
@@ -742,12 +1417,35 @@ int32_t ext2_init(ext2_t* ext2, read_block_func_t read_block, write_block_func_t
 	//read super block
 	ext2->read_block(1, buf);
 	memcpy(&ext2->super, buf, sizeof(SUPER));
+	ext2->super_dirty = false;
 
 	get_gds(ext2);
+
+	ext2->inode_stamp = 0;
+	ext2->balloc_next = 0;
+	ext2->inodes = (ext2_inode_cache_t*)malloc(sizeof(ext2_inode_cache_t) * EXT2_INODE_CACHE_MAX);
+	memset(ext2->inodes, 0, sizeof(ext2_inode_cache_t) * EXT2_INODE_CACHE_MAX);
+	ext2->block_bitmap = (ext2_bitmap_cache_t*)malloc(sizeof(ext2_bitmap_cache_t));
+	memset(ext2->block_bitmap, 0, sizeof(ext2_bitmap_cache_t));
+	ext2->inode_bitmap = (ext2_bitmap_cache_t*)malloc(sizeof(ext2_bitmap_cache_t));
+	memset(ext2->inode_bitmap, 0, sizeof(ext2_bitmap_cache_t));
+	ext2->dirs = (struct ext2_dir_cache*)malloc(sizeof(struct ext2_dir_cache) * DIR_CACHE_MAX);
+	if(ext2->dirs != NULL)
+		memset(ext2->dirs, 0, sizeof(struct ext2_dir_cache) * DIR_CACHE_MAX);
 	return 0;
 }
 
 void ext2_quit(ext2_t* ext2) {
+	ext2_sync(ext2);
+	if(ext2->dirs != NULL) {
+		for(int32_t i=0; i<DIR_CACHE_MAX; i++)
+			dir_cache_free(&ext2->dirs[i]);
+		free(ext2->dirs);
+	}
+	free(ext2->inode_bitmap);
+	free(ext2->block_bitmap);
+	free(ext2->inodes);
+	free(ext2->gds_dirty);
 	free(ext2->gds);
 }
 
@@ -2,6 +2,7 @@
 #define GRAPH_H
 
 #include <graph/font.h>
+#include <stdbool.h>
 
 typedef struct {
 	uint32_t *buffer;
@@ -62,6 +63,17 @@ void blt(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
 
 void blt_alpha(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
 		graph_t* dst, int32_t dx, int32_t dy, int32_t dw, int32_t dh, uint8_t alpha);
+
+void blt_alpha_pre(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+		graph_t* dst, int32_t dx, int32_t dy, int32_t dw, int32_t dh, uint8_t alpha);
+
+void blt_scaled(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+		graph_t* dst, int32_t dx, int32_t dy, int32_t dw, int32_t dh, bool smooth);
+
+void blt_scaled_alpha(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+		graph_t* dst, int32_t dx, int32_t dy, int32_t dw, int32_t dh, bool smooth, uint8_t alpha);
+
+void graph_premultiply(graph_t* g);
 	
 int32_t check_in_rect(int32_t x, int32_t y, grect_t* rect);
 
@@ -1,6 +1,7 @@
 #include <graph/graph.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <sys/critical.h>
 
@@ -53,20 +54,71 @@ inline void pixel_safe(graph_t* g, int32_t x, int32_t y, uint32_t color) {
 	pixel(g, x, y, color);
 }
 
-static inline void pixel_argb(graph_t* graph, int32_t x, int32_t y,
-		uint8_t a, uint8_t r, uint8_t g, uint8_t b) {
-	uint32_t oc = graph->buffer[y * graph->w + x];
-	uint8_t oa = (oc >> 24) & 0xff;
-	uint8_t ob = (oc >> 16) & 0xff;
-	uint8_t og = (oc >> 8)  & 0xff;
-	uint8_t or = oc & 0xff;
+/*x/255 for two 16 bits lanes (0x00ff00ff layout) at once, no divide*/
+static inline uint32_t div255x2(uint32_t x) {
+	x += 0x00800080;
+	return ((x + ((x >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+}
+
+static inline uint32_t div255(uint32_t x) {
+	return ((x + 128) * 257) >> 16;
+}
+
+/*blend s over d with alpha a, channels in buffer byte order.
+r/b and g/a are done as two lanes of one word each*/
+static inline uint32_t blend(uint32_t d, uint32_t s, uint32_t a) {
+	if(a == 0)
+		return d;
+	s |= 0xff000000; //dst alpha: da + (255-da)*a/255
+	if(a == 0xff)
+		return s;
+
+	uint32_t na = 255 - a;
+	uint32_t rb = (s & 0x00ff00ff) * a + (d & 0x00ff00ff) * na;
+	uint32_t ag = ((s >> 8) & 0x00ff00ff) * a + ((d >> 8) & 0x00ff00ff) * na;
+	return div255x2(rb) | (div255x2(ag) << 8);
+}
+
+/*s is premultiplied and already scaled: d*(255-sa)/255 + s*/
+static inline uint32_t blend_pre(uint32_t d, uint32_t s) {
+	uint32_t sa = s >> 24;
+	if(sa == 0xff)
+		return s;
+	uint32_t na = 255 - sa;
+	uint32_t rb = div255x2((d & 0x00ff00ff) * na);
+	uint32_t ag = div255x2(((d >> 8) & 0x00ff00ff) * na);
+	return s + (rb | (ag << 8));
+}
+
+/*scale all 4 channels by a/255*/
+static inline uint32_t scale_pre(uint32_t s, uint32_t a) {
+	if(a == 0xff)
+		return s;
+	uint32_t rb = div255x2((s & 0x00ff00ff) * a);
+	uint32_t ag = div255x2(((s >> 8) & 0x00ff00ff) * a);
+	return rb | (ag << 8);
+}
+
+static inline void fill32(uint32_t* p, uint32_t c, int32_t n) {
+	while(n >= 8) {
+		p[0] = c; p[1] = c; p[2] = c; p[3] = c;
+		p[4] = c; p[5] = c; p[6] = c; p[7] = c;
+		p += 8;
+		n -= 8;
+	}
+	while(n-- > 0)
+		*p++ = c;
+}
 
-	oa = oa + (255 - oa) * a / 255;
-	or = r*a/255 + or*(255-a)/255;
-	og = g*a/255 + og*(255-a)/255;
-	ob = b*a/255 + ob*(255-a)/255;
+static inline void blend_row(uint32_t* d, uint32_t s, uint32_t a, int32_t n) {
+	for(int32_t i=0; i<n; i++)
+		d[i] = blend(d[i], s, a);
+}
 
-	graph->buffer[y * graph->w + x] = argb(oa, or, og, ob);
+static inline void pixel_argb(graph_t* graph, int32_t x, int32_t y,
+		uint8_t a, uint8_t r, uint8_t g, uint8_t b) {
+	uint32_t* p = &graph->buffer[y * graph->w + x];
+	*p = blend(*p, b << 16 | g << 8 | r, a);
 }
 
 static inline void pixel_argb_safe(graph_t* graph, int32_t x, int32_t y,
@@ -85,12 +137,9 @@ void clear(graph_t* g, uint32_t color) {
 		return;
 
 	critical_enter();
-	uint32_t i = 0;
+	uint32_t i;
 	uint32_t sz = g->w * 4;
-	while(i<g->w) {
-		g->buffer[i] = color;
-		++i;
-	}
+	fill32(g->buffer, color, g->w);
 	char* p = (char*)g->buffer;
 	for(i=1; i<g->h; ++i) {
 		memcpy(p+(i*sz), p, sz);
@@ -260,158 +309,193 @@ void fill(graph_t* g, int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color
 	if(!graph_insect(g, &r))
 		return;
 
-	int32_t ex, ey;
-	y = r.y;
-	ex = r.x + r.w;
-	ey = r.y + r.h;
+	uint32_t* p = &g->buffer[r.y * g->w + r.x];
+	int32_t ey = r.y + r.h;
 
 	critical_enter();
 
 	if(!has_alpha(color)) {
-		for(; y < ey; y++) {
-			x = r.x;
-			for(; x < ex; x++) {
-				pixel(g, x, y, color);
-			}
+		for(y = r.y; y < ey; y++) {
+			fill32(p, color, r.w);
+			p += g->w;
 		}
 	}
 	else {
-		uint8_t ca = (color >> 24) & 0xff;
-		uint8_t cr = (color >> 16) & 0xff;
-		uint8_t cg = (color >> 8) & 0xff;
-		uint8_t cb = (color) & 0xff;
-		for(; y < ey; y++) {
-			x = r.x;
-			for(; x < ex; x++) {
-				pixel_argb(g, x, y, ca, cr, cg, cb);
-			}
+		uint32_t ca = (color >> 24) & 0xff;
+		uint32_t c = argb_int(color); //to buffer byte order
+		for(y = r.y; y < ey; y++) {
+			blend_row(p, c, ca, r.w);
+			p += g->w;
 		}
 	}
 	critical_quit();
 
 }
 
-static void draw_char8(graph_t* g, int32_t x, int32_t y, char c, font_t* font, uint32_t color) {
-	if(g == NULL)
-		return;
-	int32_t xchar, ychar, xpart, ypart, index, pmask;
-	unsigned char *pdata = (unsigned char*) font->data, check;
-
-	index = (int32_t)c * font->h;
-	ypart = y;
-
-	if(has_alpha(color)) {
-		uint8_t ca = (color >> 24) & 0xff;
-		uint8_t cr = (color >> 16) & 0xff;
-		uint8_t cg = (color >> 8) & 0xff;
-		uint8_t cb = (color) & 0xff;
-		for(ychar=0; (uint32_t)ychar<font->h; ychar++) {
-			xpart = x;
-			pmask = 1 << (8-1);
-			check = pdata[index+ychar];
-			for(xchar=0; (uint32_t)xchar<8; xchar++) {
-				if(check&pmask)
-					pixel_argb_safe(g, xpart, ypart,
-							ca, cr, cg, cb);
-				xpart++;
-				pmask >>= 1;
-			}
-			ypart++;
-		}
+/*glyph cache: every glyph of a font is turned into row spans of set bits
+once, text is then drawn as word fills (or blended rows) per span,
+clipped once per glyph instead of tested per pixel*/
+#define GLYPH_FONT_MAX 4
+
+typedef struct {
+	uint8_t y;
+	uint8_t x;
+	uint8_t len;
+} gspan_t;
+
+typedef struct {
+	gspan_t* spans;
+	uint16_t num;
+	bool built;
+} glyph_t;
+
+typedef struct {
+	const font_t* font;
+	uint32_t stamp;
+	glyph_t glyphs[256];
+} glyph_font_t;
+
+static glyph_font_t _glyph_fonts[GLYPH_FONT_MAX];
+static uint32_t _glyph_stamp = 0;
+
+static void glyph_font_free(glyph_font_t* gf) {
+	for(int32_t i=0; i<256; i++) {
+		if(gf->glyphs[i].spans != NULL)
+			free(gf->glyphs[i].spans);
 	}
-	else {
-		for(ychar=0; (uint32_t)ychar<font->h; ychar++) {
-			xpart = x;
-			pmask = 1 << (8-1);
-			check = pdata[index+ychar];
-			for(xchar=0; (uint32_t)xchar<8; xchar++) {
-				if(check&pmask)
-					pixel_safe(g, xpart, ypart, color);
-				xpart++;
-				pmask >>= 1;
-			}
-			ypart++;
+	memset(gf, 0, sizeof(glyph_font_t));
+}
+
+static glyph_font_t* glyph_font_get(const font_t* font) {
+	glyph_font_t* ret = &_glyph_fonts[0];
+	for(int32_t i=0; i<GLYPH_FONT_MAX; i++) {
+		glyph_font_t* gf = &_glyph_fonts[i];
+		if(gf->font == font) {
+			gf->stamp = ++_glyph_stamp;
+			return gf;
 		}
+		if(gf->font == NULL || gf->stamp < ret->stamp)
+			ret = gf;
 	}
+
+	if(ret->font != NULL) //least recently used
+		glyph_font_free(ret);
+	ret->font = font;
+	ret->stamp = ++_glyph_stamp;
+	return ret;
 }
 
-static void draw_char16(graph_t* g, int32_t x, int32_t y, char c, font_t* font, uint32_t color) {
-	if(g == NULL)
-		return;
-	int32_t xchar, ychar, xpart, ypart, index, pmask;
-	unsigned char *pdata = (unsigned char*) font->data, check;
-
-	index = (int32_t)c * font->h * 2;
-	ypart = y;
-
-	if(has_alpha(color)) {
-		uint8_t ca = (color >> 24) & 0xff;
-		uint8_t cr = (color >> 16) & 0xff;
-		uint8_t cg = (color >> 8) & 0xff;
-		uint8_t cb = (color) & 0xff;
-		for(ychar=0; (uint32_t)ychar<font->h; ychar++) {
-			xpart = x;
-			pmask = 1 << (8-1);
-			check = pdata[index+ychar];
-			for(xchar=0; (uint32_t)xchar<8; xchar++) {
-				if(check&pmask)
-					pixel_argb_safe(g, xpart, ypart, ca, cr, cg, cb);
-				xpart++;
-				pmask >>= 1;
-			}
+static inline bool font_bit(const uint8_t* row, uint32_t x) {
+	return (row[x >> 3] & (0x80 >> (x & 0x7))) != 0;
+}
 
-			index++;
-			check = pdata[index+ychar];
-			pmask = 1 << (8-1);
-			for(xchar=0; (uint32_t)xchar<8; xchar++) {
-				if(check&pmask)
-					pixel_argb_safe(g, xpart, ypart, ca, cr, cg, cb);
-				xpart++;
-				pmask >>= 1;
+/*fonts are 1bpp, (w+7)/8 bytes a row, msb first*/
+static void glyph_build(glyph_t* gl, const font_t* font, uint8_t c) {
+	uint32_t bpr = (font->w + 7) / 8;
+	const uint8_t* data = (const uint8_t*)font->data + c * font->h * bpr;
+	uint32_t x, y, num = 0;
+
+	for(int32_t pass=0; pass<2; pass++) { //count, then fill
+		num = 0;
+		for(y=0; y<font->h; y++) {
+			const uint8_t* row = data + y*bpr;
+			x = 0;
+			while(x < font->w) {
+				if(!font_bit(row, x)) {
+					x++;
+					continue;
+				}
+				uint32_t sx = x;
+				while(x < font->w && font_bit(row, x))
+					x++;
+				if(pass == 1) {
+					gl->spans[num].y = y;
+					gl->spans[num].x = sx;
+					gl->spans[num].len = x - sx;
+				}
+				num++;
 			}
-			ypart++;
 		}
-	}
-	else {
-		for(ychar=0; (uint32_t)ychar<font->h; ychar++) {
-			xpart = x;
-			pmask = 1 << (8-1);
-			check = pdata[index+ychar];
-			for(xchar=0; (uint32_t)xchar<8; xchar++) {
-				if(check&pmask)
-					pixel_safe(g, xpart, ypart, color);
-				xpart++;
-				pmask >>= 1;
+		if(pass == 0) {
+			if(num == 0)
+				break;
+			gl->spans = (gspan_t*)malloc(num * sizeof(gspan_t));
+			if(gl->spans == NULL) {
+				num = 0;
+				break;
 			}
+		}
+	}
+	gl->num = num;
+	gl->built = true;
+}
 
-			index++;
-			check = pdata[index+ychar];
-			pmask = 1 << (8-1);
-			for(xchar=0; (uint32_t)xchar<8; xchar++) {
-				if(check&pmask)
-					pixel_safe(g, xpart, ypart, color);
-				xpart++;
-				pmask >>= 1;
+static inline glyph_t* glyph_get(glyph_font_t* gf, char c) {
+	glyph_t* gl = &gf->glyphs[(uint8_t)c];
+	if(!gl->built)
+		glyph_build(gl, gf->font, (uint8_t)c);
+	return gl;
+}
+
+static void draw_glyph(graph_t* g, int32_t x, int32_t y, glyph_t* gl, const font_t* font, uint32_t color) {
+	if(gl->num == 0)
+		return;
+	grect_t r = {x, y, font->w, font->h};
+	if(!graph_insect(g, &r))
+		return;
+
+	bool alpha = has_alpha(color);
+	uint32_t a = (color >> 24) & 0xff;
+	if(alpha)
+		color = argb_int(color); //to buffer byte order
+
+	bool inside = (r.x == x && r.y == y && r.w == (int32_t)font->w && r.h == (int32_t)font->h);
+	int32_t ex = r.x + r.w;
+	int32_t ey = r.y + r.h;
+	for(uint32_t i=0; i<gl->num; i++) {
+		gspan_t* sp = &gl->spans[i];
+		int32_t sy = y + sp->y;
+		int32_t sx = x + sp->x;
+		int32_t len = sp->len;
+		if(!inside) {
+			if(sy < r.y || sy >= ey)
+				continue;
+			if(sx < r.x) {
+				len -= r.x - sx;
+				sx = r.x;
 			}
-			ypart++;
+			if(sx + len > ex)
+				len = ex - sx;
+			if(len <= 0)
+				continue;
 		}
+
+		uint32_t* p = &g->buffer[sy * g->w + sx];
+		if(alpha)
+			blend_row(p, color, a, len);
+		else
+			fill32(p, color, len);
 	}
 }
 
 void draw_char(graph_t* g, int32_t x, int32_t y, char c, font_t* font, uint32_t color) {
-	if(g == NULL)
+	if(g == NULL || font == NULL)
 		return;
-	if(font->w <= 8)
-		draw_char8(g, x, y, c, font, color);
-	else if(font->w <= 16)
-		draw_char16(g, x, y, c, font, color);
+	glyph_font_t* gf = glyph_font_get(font);
+	draw_glyph(g, x, y, glyph_get(gf, c), font, color);
 }
 
 void draw_text(graph_t* g, int32_t x, int32_t y, const char* str, font_t* font, uint32_t color) {
-	if(g == NULL)
+	if(g == NULL || font == NULL)
+		return;
+	if(y >= (int32_t)g->h || (y + (int32_t)font->h) <= 0)
 		return;
+
+	glyph_font_t* gf = glyph_font_get(font);
 	while(*str) {
-		draw_char(g, x, y, *str, font, color);
+		if(x >= (int32_t)g->w)
+			break;
+		draw_glyph(g, x, y, glyph_get(gf, *str), font, color);
 		x += font->w;
 		str++;
 	}
@@ -424,18 +508,26 @@ inline void blt(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
 	if(!insect(src, &sr, dst, &dr))
 		return;
 
-	register int32_t ex, ey;
-	sy = sr.y;
-	dy = dr.y;
-	ex = sr.x + sr.w;
-	ey = sr.y + sr.h;
-
-	for(; sy < ey; sy++, dy++) {
-		sx = sr.x;
-		dx = dr.x;
-		for(; sx < ex; sx++, dx++) {
-			dst->buffer[dy * dst->w + dx] = src->buffer[sy * src->w + sx];
+	uint32_t* s = &src->buffer[sr.y * src->w + sr.x];
+	uint32_t* d = &dst->buffer[dr.y * dst->w + dr.x];
+	uint32_t sz = sr.w * 4;
+	int32_t i;
+
+	if(src->buffer == dst->buffer && dr.y > sr.y) { //overlapped, copy from bottom
+		s += (sr.h - 1) * src->w;
+		d += (sr.h - 1) * dst->w;
+		for(i = 0; i < sr.h; i++) {
+			memmove(d, s, sz);
+			s -= src->w;
+			d -= dst->w;
 		}
+		return;
+	}
+
+	for(i = 0; i < sr.h; i++) {
+		memmove(d, s, sz);
+		s += src->w;
+		d += dst->w;
 	}
 }
 
@@ -447,27 +539,214 @@ inline void blt_alpha(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t
 		return;
 
 	critical_enter();
-	register int32_t ex, ey;
-	sy = sr.y;
-	dy = dr.y;
-	ex = sr.x + sr.w;
-	ey = sr.y + sr.h;
-
-	for(; sy < ey; sy++, dy++) {
-		register int32_t sx = sr.x;
-		register int32_t dx = dr.x;
-		for(; sx < ex; sx++, dx++) {
-			register uint32_t color = argb_int(src->buffer[sy * src->w + sx]);
-			pixel_argb(dst, dx, dy,
-					(((color >> 24) & 0xff) * alpha)/0xff,
-					(color >> 16) & 0xff,
-					(color >> 8) & 0xff,
-					color & 0xff);
+	uint32_t* s = &src->buffer[sr.y * src->w + sr.x];
+	uint32_t* d = &dst->buffer[dr.y * dst->w + dr.x];
+	for(int32_t j = 0; j < sr.h; j++) {
+		if(alpha == 0xff) {
+			for(int32_t i = 0; i < sr.w; i++) {
+				register uint32_t c = s[i];
+				d[i] = blend(d[i], c, c >> 24);
+			}
+		}
+		else {
+			for(int32_t i = 0; i < sr.w; i++) {
+				register uint32_t c = s[i];
+				d[i] = blend(d[i], c, div255((c >> 24) * alpha));
+			}
 		}
+		s += src->w;
+		d += dst->w;
+	}
+	critical_quit();
+}
+
+/*src holds premultiplied pixels (see graph_premultiply), alpha scales the whole src*/
+void blt_alpha_pre(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+		graph_t* dst, int32_t dx, int32_t dy, int32_t dw, int32_t dh, uint8_t alpha) {
+	grect_t sr = {sx, sy, sw, sh};
+	grect_t dr = {dx, dy, dw, dh};
+	if(!insect(src, &sr, dst, &dr))
+		return;
+
+	critical_enter();
+	uint32_t* s = &src->buffer[sr.y * src->w + sr.x];
+	uint32_t* d = &dst->buffer[dr.y * dst->w + dr.x];
+	for(int32_t j = 0; j < sr.h; j++) {
+		for(int32_t i = 0; i < sr.w; i++)
+			d[i] = blend_pre(d[i], scale_pre(s[i], alpha));
+		s += src->w;
+		d += dst->w;
 	}
 	critical_quit();
 }
 
+/*mix two pixels, w in 0..256 is the weight of b. both lanes stay within
+16 bits (255*256), so no divide is needed*/
+static inline uint32_t lerp32(uint32_t a, uint32_t b, uint32_t w) {
+	uint32_t iw = 256 - w;
+	uint32_t rb = (((a & 0x00ff00ff) * iw + (b & 0x00ff00ff) * w) >> 8) & 0x00ff00ff;
+	uint32_t ag = (((a >> 8) & 0x00ff00ff) * iw + ((b >> 8) & 0x00ff00ff) * w) & 0xff00ff00;
+	return rb | ag;
+}
+
+/*16.16 fixed point source position of dst index i, sample centers aligned*/
+static inline int32_t scale_pos(int32_t i, int32_t step, bool smooth) {
+	int32_t f = i * step + (step >> 1);
+	if(smooth)
+		f -= 0x8000;
+	return f < 0 ? 0 : f;
+}
+
+static void scale_row(const uint32_t* s, uint32_t* d,
+		const int32_t* xs, const uint32_t* xw, int32_t n) {
+	int32_t i;
+	if(xw == NULL) {
+		for(i = 0; i < n; i++)
+			d[i] = s[xs[i]];
+		return;
+	}
+	for(i = 0; i < n; i++) {
+		int32_t x = xs[i];
+		uint32_t w = xw[i];
+		d[i] = w == 0 ? s[x] : lerp32(s[x], s[x+1], w);
+	}
+}
+
+/*src rect (sx, sy, sw, sh) is stretched to dst rect (dx, dy, dw, dh).
+dst is clipped, reads out of src are clamped to its edge pixels.
+column sources are computed once, scaled rows are kept by their src row
+so vertical upscaling only re-scales a row when the src row changes.*/
+static void blt_scaled_raw(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+		graph_t* dst, int32_t dx, int32_t dy, int32_t dw, int32_t dh,
+		bool smooth, bool alpha_on, uint8_t alpha) {
+	if(src == NULL || sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0)
+		return;
+
+	grect_t dr = {dx, dy, dw, dh};
+	if(!graph_insect(dst, &dr))
+		return;
+
+	int32_t xlo = sx < 0 ? 0 : sx;
+	int32_t xhi = (sx + sw > (int32_t)src->w ? (int32_t)src->w : sx + sw) - 1;
+	int32_t ylo = sy < 0 ? 0 : sy;
+	int32_t yhi = (sy + sh > (int32_t)src->h ? (int32_t)src->h : sy + sh) - 1;
+	if(xlo > xhi || ylo > yhi)
+		return;
+
+	int32_t n = dr.w;
+	int32_t* xs = (int32_t*)malloc(n * (sizeof(int32_t) + sizeof(uint32_t)));
+	uint32_t* rows = (uint32_t*)malloc(n * 3 * 4);
+	if(xs == NULL || rows == NULL) {
+		free(xs);
+		free(rows);
+		return;
+	}
+	uint32_t* xw = smooth ? (uint32_t*)(xs + n) : NULL;
+	uint32_t* r0 = rows;
+	uint32_t* r1 = rows + n;
+	uint32_t* mix = rows + n*2;
+	int32_t t0 = -1, t1 = -1; //src rows held by r0, r1
+
+	int32_t step = (sw << 16) / dw;
+	int32_t i, j;
+	for(i = 0; i < n; i++) {
+		int32_t f = scale_pos(dr.x - dx + i, step, smooth);
+		int32_t x = sx + (f >> 16);
+		uint32_t w = (f >> 8) & 0xff;
+		if(x < xlo)
+			x = xlo;
+		if(x >= xhi) {
+			x = xhi;
+			w = 0;
+		}
+		xs[i] = x;
+		if(xw != NULL)
+			xw[i] = w;
+	}
+
+	step = (sh << 16) / dh;
+	uint32_t* d = &dst->buffer[dr.y * dst->w + dr.x];
+	for(j = 0; j < dr.h; j++) {
+		int32_t f = scale_pos(dr.y - dy + j, step, smooth);
+		int32_t y = sy + (f >> 16);
+		uint32_t w = smooth ? ((f >> 8) & 0xff) : 0;
+		if(y < ylo)
+			y = ylo;
+		if(y >= yhi) {
+			y = yhi;
+			w = 0;
+		}
+
+		if(t0 != y) {
+			if(t1 == y) { //moved down by one src row, reuse it
+				uint32_t* t = r0; r0 = r1; r1 = t;
+				t1 = t0;
+			}
+			else
+				scale_row(&src->buffer[y * src->w], r0, xs, xw, n);
+			t0 = y;
+		}
+
+		uint32_t* s = r0;
+		if(w != 0) {
+			if(t1 != y+1) {
+				scale_row(&src->buffer[(y+1) * src->w], r1, xs, xw, n);
+				t1 = y+1;
+			}
+			for(i = 0; i < n; i++)
+				mix[i] = lerp32(r0[i], r1[i], w);
+			s = mix;
+		}
+
+		if(!alpha_on)
+			memcpy(d, s, n * 4);
+		else if(alpha == 0xff) {
+			for(i = 0; i < n; i++) {
+				register uint32_t c = s[i];
+				d[i] = blend(d[i], c, c >> 24);
+			}
+		}
+		else {
+			for(i = 0; i < n; i++) {
+				register uint32_t c = s[i];
+				d[i] = blend(d[i], c, div255((c >> 24) * alpha));
+			}
+		}
+		d += dst->w;
+	}
+	free(xs);
+	free(rows);
+}
+
+void blt_scaled(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+		graph_t* dst, int32_t dx, int32_t dy, int32_t dw, int32_t dh, bool smooth) {
+	if(sw == dw && sh == dh) {
+		blt(src, sx, sy, sw, sh, dst, dx, dy, dw, dh);
+		return;
+	}
+	blt_scaled_raw(src, sx, sy, sw, sh, dst, dx, dy, dw, dh, smooth, false, 0xff);
+}
+
+void blt_scaled_alpha(graph_t* src, int32_t sx, int32_t sy, int32_t sw, int32_t sh,
+		graph_t* dst, int32_t dx, int32_t dy, int32_t dw, int32_t dh, bool smooth, uint8_t alpha) {
+	if(sw == dw && sh == dh) {
+		blt_alpha(src, sx, sy, sw, sh, dst, dx, dy, dw, dh, alpha);
+		return;
+	}
+	blt_scaled_raw(src, sx, sy, sw, sh, dst, dx, dy, dw, dh, smooth, true, alpha);
+}
+
+void graph_premultiply(graph_t* g) {
+	if(g == NULL)
+		return;
+	uint32_t i, sz = g->w * g->h;
+	for(i = 0; i < sz; i++) {
+		uint32_t c = g->buffer[i];
+		uint32_t a = c >> 24;
+		g->buffer[i] = (c & 0xff000000) | (scale_pre(c, a) & 0x00ffffff);
+	}
+}
+
 int32_t check_in_rect(int32_t x, int32_t y, grect_t* rect) {
 	if(x >= rect->x && x < (rect->x+rect->w) && 
 			y >= rect->y && y < (rect->y+rect->h))
@@ -483,31 +762,36 @@ int32_t get_text_size(const char* s, font_t* font, gsize_t* size) {
 	return 0;
 }
 
+static inline uint32_t to16(uint32_t s) {
+	return ((s & 0xf8) << 8) | ((s >> 5) & 0x7c0) | ((s >> 19) & 0x1f);
+}
+
 inline void dup16(uint16_t* dst, uint32_t* src, uint32_t w, uint32_t h) {
 	register int32_t i, size;
 	size = w * h;
 	critical_enter();
-	for(i=0; i < size; i++) {
-		register uint32_t s = src[i];
-		register uint8_t b = (s >> 16);
-		register uint8_t g = (s >> 8);
-		register uint8_t r = s;
-		dst[i] = ((r >> 3) <<11) | ((g >> 3) << 6) | (b >> 3);
+	i = 0;
+	if(((uint32_t)dst & 0x3) != 0 && size > 0) { //align dst to word
+		dst[0] = to16(src[0]);
+		i = 1;
+	}
+	uint32_t* d = (uint32_t*)(dst + i);
+	for(; i+1 < size; i+=2) { //two pixels per word store
+		*d++ = to16(src[i]) | (to16(src[i+1]) << 16);
 	}
+	if(i < size)
+		dst[i] = to16(src[i]);
 	critical_quit();
 }
 
-/*graph_t* graph_zoom(graph_t* g, uint32_t w, uint32_t h) {
-	graph_t * ret = graph_new(NULL, w, h);
-	float zw = ((float)w) / g->w;
-	float zh = ((float)h) / g->h;
-	for(uint32_t j=0; j<h; j++) {
-		uint32_t y = (int32_t)(j*zh);
-		for(uint32_t i=0; i<w; i++) {
-			uint32_t x = 0;//(int32_t)i*zw;
-			ret->buffer[j*w+i] = g->buffer[y*g->w+x];
-		}
+graph_t* graph_zoom(graph_t* g, uint32_t w, uint32_t h) {
+	if(g == NULL || w == 0 || h == 0)
+		return NULL;
+	graph_t* ret = graph_new(NULL, w, h);
+	if(ret == NULL || ret->buffer == NULL) {
+		graph_free(ret);
+		return NULL;
 	}
-	return ret;	
+	blt_scaled(g, 0, 0, g->w, g->h, ret, 0, 0, w, h, true);
+	return ret;
 }
-*/
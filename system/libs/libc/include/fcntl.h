@@ -11,6 +11,13 @@
 #define SEEK_CUR 1
 #define SEEK_END 2
 
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
+
+#define MAP_SHARED  0x1
+#define MAP_PRIVATE 0x2
+#define MAP_FAILED  ((void*)-1)
+
 #include <proto.h>
 
 enum {
@@ -24,6 +31,10 @@ int  open(const char* name, int oflag);
 void close(int fd);
 int  dma(int fd, int* size);
 void flush(int fd);
+void flush_data(int fd, const void* data, int size);
+
+void* mmap(void* addr, int size, int prot, int flags, int fd, int offset);
+int   munmap(void* addr, int size);
 
 int dev_ping(int pid);
 
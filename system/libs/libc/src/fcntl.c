@@ -2,6 +2,7 @@
 #include <sys/syscall.h>
 #include <sys/ipc.h>
 #include <sys/vfs.h>
+#include <sys/shm.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -86,7 +87,64 @@ int dma(int fd, int* size) {
 	return shm_id;
 }
 
+/*map file content of fd. the device daemon hands back a shared memory
+holding the whole file, which is mapped at the same address by every
+process, so addr and flags are only hints here*/
+void* mmap(void* addr, int size, int prot, int flags, int fd, int offset) {
+	(void)addr;
+	(void)flags;
+	if(size <= 0 || offset < 0)
+		return MAP_FAILED;
+
+	fsinfo_t info;
+	if(vfs_get_by_fd(fd, &info) != 0)
+		return MAP_FAILED;
+	
+	mount_t mount;
+	if(vfs_get_mount(&info, &mount) != 0)
+		return MAP_FAILED;
+
+	proto_t in, out;
+	proto_init(&in, NULL, 0);
+	proto_init(&out, NULL, 0);
+
+	proto_add_int(&in, fd);
+	proto_add(&in, &info, sizeof(fsinfo_t));
+	proto_add_int(&in, prot);
+
+	int shm_id = -1;
+	int shm_size = 0;
+	if(ipc_call(mount.pid, FS_CMD_MMAP, &in, &out) == 0) {
+		shm_id = proto_read_int(&out);
+		shm_size = proto_read_int(&out);
+	}
+	proto_clear(&in);
+	proto_clear(&out);
+
+	//the whole [offset, offset+size) must be inside the shm, offset < shm_size keeps it overflow safe.
+	if(shm_id < 0 || offset >= shm_size || size > shm_size - offset)
+		return MAP_FAILED;
+
+	char* p = (char*)shm_map(shm_id);
+	if(p == NULL)
+		return MAP_FAILED;
+	return p + offset;
+}
+
+int munmap(void* addr, int size) {
+	(void)size;
+	int id = shm_id(addr);
+	if(id < 0)
+		return -1;
+	return shm_unmap(id);
+}
+
 void flush(int fd) {
+	flush_data(fd, NULL, 0);
+}
+
+/*flush with a device specific hint, like the dirty rects of a framebuffer*/
+void flush_data(int fd, const void* data, int size) {
 	fsinfo_t info;
 	if(vfs_get_by_fd(fd, &info) != 0)
 		return;
@@ -99,6 +157,8 @@ void flush(int fd) {
 
 		proto_add_int(&in, fd);
 		proto_add(&in, &info, sizeof(fsinfo_t));
+		if(data != NULL && size > 0)
+			proto_add(&in, data, size);
 		ipc_call(mount.pid, FS_CMD_FLUSH, &in, &out);
 		proto_clear(&in);
 		proto_clear(&out);
@@ -347,6 +347,52 @@ void exec_elf(const char* cmd_line, const char* elf, int32_t size) {
 	syscall3(SYS_EXEC_ELF, (int32_t)cmd_line, (int32_t)elf, size);
 }
 
+#define EXEC_CHUNK (32*1024)
+
+/*get the elf image of fname into a shm, mapped straight from the file
+provider when it supports mmap, or streamed in chunks otherwise.
+the kernel loads segments from there and drops the shm on success*/
+static void* exec_image(const char* fname, int* rsz) {
+	fsinfo_t info;
+	if(vfs_get(fname, &info) != 0 || info.size <= 0)
+		return NULL;
+	int fd = open(fname, O_RDONLY);
+	if(fd < 0)
+		return NULL;
+
+	char* img = (char*)mmap(NULL, info.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(img == MAP_FAILED) {
+		img = NULL;
+		int id = shm_alloc(info.size, SHM_FAMILY);
+		if(id >= 0) {
+			img = (char*)shm_map(id);
+			if(img == NULL)
+				shm_unmap(id);
+		}
+		if(img != NULL) {
+			int off = 0;
+			while(off < (int)info.size) {
+				int n = info.size - off;
+				if(n > EXEC_CHUNK)
+					n = EXEC_CHUNK;
+				int sz = read(fd, img + off, n);
+				if(sz < 0 && errno == EAGAIN)
+					continue;
+				if(sz <= 0) //eof or error, the file may have shrunk
+					break;
+				off += sz;
+			}
+			if(off != (int)info.size) {
+				shm_unmap(id);
+				img = NULL;
+			}
+		}
+	}
+	close(fd);
+	*rsz = info.size;
+	return img;
+}
+
 int exec(const char* cmd_line) {
 	str_t* cmd = str_new("");
 	const char *p = cmd_line;
@@ -356,14 +402,13 @@ int exec(const char* cmd_line) {
 	}
 	str_addc(cmd, 0);
 	int sz;
-	void* buf = vfs_readfile(cmd->cstr, &sz);
-	if(buf == NULL) {
-		str_free(cmd);
+	void* img = exec_image(vfs_fullname(cmd->cstr), &sz);
+	str_free(cmd);
+	if(img == NULL)
 		return -1;
-	}
-	exec_elf(cmd_line, buf, sz);
-	free(buf);
-	return 0;
+	exec_elf(cmd_line, img, sz);
+	munmap(img, sz); //still here, exec failed
+	return -1;
 }
 
 char* getcwd(char* buf, uint32_t size) {
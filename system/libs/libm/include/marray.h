@@ -9,8 +9,8 @@ array functions.
 */
 typedef struct st_array {
 	void** items;
-	uint32_t max: 16;
-	uint32_t size: 16;
+	uint32_t max;
+	uint32_t size;
 } m_array_t;
 
 typedef void (*free_func_t)(void* p);
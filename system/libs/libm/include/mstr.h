@@ -9,8 +9,8 @@ string functions.
 */
 typedef struct st_str {
 	char* cstr;
-	uint32_t max: 16;
-	uint32_t len: 16;
+	uint32_t max;
+	uint32_t len;
 } str_t;
 
 void str_reset(str_t* str);
@@ -20,6 +20,7 @@ str_t* str_new(const char* s);
 str_t* str_new_by_size(uint32_t sz);
 char* str_add(str_t* str, const char* src);
 char* str_addc(str_t* str, char c);
+char* str_addn(str_t* str, const char* src, uint32_t len);
 char* str_add_int(str_t* str, int i, int base);
 char* str_add_float(str_t* str, float f);
 void str_free(str_t* str);
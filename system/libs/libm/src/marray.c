@@ -18,13 +18,17 @@ m_array_t* array_new() {
 	return ret;
 }
 
+//grow twice as big, so adding n items costs O(n) copies.
+static inline void array_grow(m_array_t* array) {
+	uint32_t new_size = array->max < ARRAY_BUF ? ARRAY_BUF : array->max*2;
+	array->items = (void**)realloc_raw(array->items, array->max*sizeof(void*), new_size*sizeof(void*)); 
+	array->max = new_size; 
+}
+
 inline void array_add(m_array_t* array, void* item) {
 	uint32_t new_size = array->size + 1; 
-	if(array->max <= new_size) { 
-		new_size = array->size + ARRAY_BUF;
-		array->items = (void**)realloc_raw(array->items, array->max*sizeof(void*), new_size*sizeof(void*)); 
-		array->max = new_size; 
-	} 
+	if(array->max <= new_size)
+		array_grow(array);
 	array->items[array->size] = item; 
 	array->size++; 
 	array->items[array->size] = NULL; 
@@ -32,11 +36,8 @@ inline void array_add(m_array_t* array, void* item) {
 
 inline void array_add_head(m_array_t* array, void* item) {
 	uint32_t new_size = array->size + 1; 
-	if(array->max <= new_size) { 
-		new_size = array->size + ARRAY_BUF;
-		array->items = (void**)realloc_raw(array->items, array->max*sizeof(void*), new_size*sizeof(void*)); 
-		array->max = new_size; 
-	} 
+	if(array->max <= new_size)
+		array_grow(array);
 	int32_t i;
 	for(i=array->size; i>0; i--) {
 		array->items[i] = array->items[i-1];
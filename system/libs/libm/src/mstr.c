@@ -9,6 +9,17 @@
 #define STR_BUF 16
 #define STATIC_STR_MAX 64
 
+/*grow to hold size bytes, twice as big at least, so appending is linear.*/
+static void str_grow(str_t* str, uint32_t size) {
+	if(str->max > size)
+		return;
+	uint32_t new_size = str->max * 2;
+	if(new_size <= size)
+		new_size = size + STR_BUF; /*STR BUF for buffer*/
+	str->cstr = realloc_raw(str->cstr, str->max, new_size);
+	str->max = new_size;
+}
+
 void str_reset(str_t* str) {
 	if(str->cstr == NULL) {
 		str->cstr = (char*)malloc(STR_BUF);
@@ -29,21 +40,15 @@ char* str_ncpy(str_t* str, const char* src, uint32_t l) {
 	if(len > l)
 		len = l;
 
-	uint32_t new_size = len;
-	if(str->max <= new_size) {
-		new_size = len + STR_BUF; /*STR BUF for buffer*/
-		str->cstr = realloc_raw(str->cstr, str->max, new_size);
-		str->max = new_size;
-	}
-
-	strncpy(str->cstr, src, len);
+	str_grow(str, len);
+	memcpy(str->cstr, src, len);
 	str->cstr[len] = 0;
 	str->len = len;
 	return str->cstr;
 }
 
 char* str_cpy(str_t* str, const char* src) {
-	str_ncpy(str, src, 0x0FFFF);
+	str_ncpy(str, src, 0xFFFFFFFF);
 	return str->cstr;
 }
 
@@ -70,15 +75,18 @@ char* str_add(str_t* str, const char* src) {
 		return str->cstr;
 	}
 
-	uint32_t len = (uint32_t)strlen(src);
-	uint32_t new_size = str->len + len;
-	if(str->max <= new_size) {
-		new_size = str->len + len + STR_BUF; /*STR BUF for buffer*/
-		str->cstr = realloc_raw(str->cstr, str->max, new_size);
-		str->max = new_size;
+	return str_addn(str, src, (uint32_t)strlen(src));
+}
+
+char* str_addn(str_t* str, const char* src, uint32_t len) {
+	if(len == 0) {
+		if(str->cstr == NULL)
+			str_reset(str);
+		return str->cstr;
 	}
 
-	strcpy(str->cstr + str->len, src);
+	str_grow(str, str->len + len);
+	memcpy(str->cstr + str->len, src, len);
 	str->len = str->len + len;
 	str->cstr[str->len] = 0;
 	return str->cstr;
@@ -90,13 +98,7 @@ char* str_addc(str_t* str, char c) {
 		return str->cstr;
 	}
 
-	uint32_t new_size = str->len + 1;
-	if(str->max <= new_size) {
-		new_size = str->len + STR_BUF; /*STR BUF for buffer*/
-		str->cstr = realloc_raw(str->cstr, str->max, new_size);
-		str->max = new_size;
-	}
-
+	str_grow(str, str->len + 1);
 	str->cstr[str->len] = c;
 	str->len++;
 	str->cstr[str->len] = 0;
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mario/mario_vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+host bench of the mario vm, built with MARIO_STATS by host/Makefile.
+each script is compiled and run in a fresh vm, the fastest of the runs is
+reported with its counters:
+
+  mario_bench [-r runs] [-o] [-v] script.js ...
+    -r  runs of each script, 3 by default
+    -o  instructions executed by opcode
+    -v  keep the output of scripts
+*/
+
+#define OPS_SHOW_MAX 16
+
+typedef struct {
+	double compile_ms;
+	double run_ms;
+	uint32_t gc_cycles;
+	vm_stats_t stats;
+} bench_t;
+
+static uint64_t clock_us(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000 + (uint64_t)t.tv_nsec / 1000;
+}
+
+static char* read_file(const char* fname) {
+	FILE* fp = fopen(fname, "rb");
+	if(fp == NULL)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	char* s = (char*)malloc(size + 1);
+	size = (long)fread(s, 1, size, fp);
+	s[size] = 0;
+	fclose(fp);
+	return s;
+}
+
+static uint64_t ops_total(const vm_stats_t* stats) {
+	uint64_t n = 0;
+	int i;
+	for(i=0; i<256; i++)
+		n += stats->ops[i];
+	return n;
+}
+
+static bool bench_run(const char* src, bench_t* b) {
+	vm_t* vm = vm_new(compile);
+	vm->stats.clock_us = clock_us;
+	vm_init(vm, NULL, NULL);
+
+	uint64_t t0 = clock_us();
+	bool ret = vm_load(vm, src);
+	uint64_t t1 = clock_us();
+	if(ret)
+		vm_run(vm);
+	uint64_t t2 = clock_us();
+
+	b->compile_ms = (t1 - t0) / 1000.0;
+	b->run_ms = (t2 - t1) / 1000.0;
+	b->gc_cycles = vm->gc_cycles;
+	b->stats = vm->stats;
+	vm_close(vm);
+	return ret;
+}
+
+static void show_ops(const vm_stats_t* stats) {
+	uint64_t total = ops_total(stats);
+	bool shown[256] = { false };
+	int i, k;
+	for(k=0; k<OPS_SHOW_MAX; k++) {
+		int max = -1;
+		for(i=0; i<256; i++) {
+			if(!shown[i] && stats->ops[i] > 0 && (max < 0 || stats->ops[i] > stats->ops[max]))
+				max = i;
+		}
+		if(max < 0)
+			break;
+		shown[max] = true;
+		const char* name = instr_str((opr_code_t)max);
+		printf("    %-8s %12llu %6.2f%%\n", name[0] == 0 ? "?" : name,
+				(unsigned long long)stats->ops[max], stats->ops[max] * 100.0 / total);
+	}
+}
+
+int main(int argc, char** argv) {
+	int runs = 3;
+	bool ops = false;
+	bool verbose = false;
+	int i = 1;
+	for(; i<argc && argv[i][0] == '-'; i++) {
+		if(strcmp(argv[i], "-r") == 0 && i+1 < argc)
+			runs = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-o") == 0)
+			ops = true;
+		else if(strcmp(argv[i], "-v") == 0)
+			verbose = true;
+		else {
+			fprintf(stderr, "usage: %s [-r runs] [-o] [-v] script.js ...\n", argv[0]);
+			return 1;
+		}
+	}
+	if(runs < 1)
+		runs = 1;
+
+	printf("%-16s %9s %9s %12s %9s %10s %10s %6s %6s %9s %9s\n",
+			"script", "comp(ms)", "run(ms)", "ops", "Mops/s",
+			"vars", "mallocs", "gc", "steps", "pause(ms)", "max(us)");
+
+	int null_fd = open("/dev/null", O_WRONLY);
+	int out_fd = dup(1);
+	int failed = 0;
+	for(; i<argc; i++) {
+		char* src = read_file(argv[i]);
+		if(src == NULL) {
+			fprintf(stderr, "can't read %s\n", argv[i]);
+			failed++;
+			continue;
+		}
+
+		bench_t best, b;
+		bool ok = true;
+		int r;
+		for(r=0; r<runs && ok; r++) {
+			fflush(stdout);
+			if(!verbose)
+				dup2(null_fd, 1);
+			ok = bench_run(src, &b);
+			fflush(stdout);
+			dup2(out_fd, 1);
+			if(r == 0 || b.run_ms < best.run_ms)
+				best = b;
+		}
+		free(src);
+
+		const char* name = strrchr(argv[i], '/');
+		name = name == NULL ? argv[i] : name + 1;
+		if(!ok) {
+			printf("%-16s compile error\n", name);
+			failed++;
+			continue;
+		}
+
+		uint64_t total = ops_total(&best.stats);
+		printf("%-16s %9.2f %9.2f %12llu %9.2f %10llu %10llu %6u %6u %9.2f %9llu\n",
+				name, best.compile_ms, best.run_ms,
+				(unsigned long long)total,
+				best.run_ms > 0 ? total / best.run_ms / 1000.0 : 0.0,
+				(unsigned long long)best.stats.var_news,
+				(unsigned long long)best.stats.var_mallocs,
+				best.gc_cycles, best.stats.gc_steps,
+				best.stats.gc_pause_us / 1000.0,
+				(unsigned long long)best.stats.gc_pause_max_us);
+		if(ops)
+			show_ops(&best.stats);
+	}
+
+	close(out_fd);
+	close(null_fd);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,7 @@
+var a = [];
+var i = 0;
+while(i < 60000) { a[i] = i; i++; }
+var s = 0;
+i = 0;
+while(i < a.length) { s = s + a[i]; i++; }
+debug(a.length, s);
@@ -0,0 +1,5 @@
+function add(a, b) { return a + b; }
+var s = 0;
+var i = 0;
+while(i < 100000) { s = add(s, i) % 1000003; i++; }
+debug(s);
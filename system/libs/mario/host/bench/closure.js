@@ -0,0 +1,10 @@
+function counter(step) { var n = 0; return function() { n = n + step; return n; }; }
+var total = 0;
+var k = 0;
+while(k < 2000) {
+	var c = counter(k);
+	var i = 0;
+	while(i < 50) { total = c(); i++; }
+	k++;
+}
+debug(total);
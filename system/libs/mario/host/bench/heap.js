@@ -0,0 +1,9 @@
+function mk(i) { return {id: i, tag: "n", kids: [i, i + 1]}; }
+var live = [];
+var i = 0;
+while(i < 20000) { live[i] = mk(i); i++; }
+function touch(o) { var t = {o: o}; return t.o.id; }
+var s = 0;
+var r = 0;
+while(r < 40000) { s = s + touch(live[r % 20000]); r++; }
+debug(s);
@@ -0,0 +1,14 @@
+var items = [];
+var i = 0;
+while(i < 2000) { items[i] = {id: i, name: "item" + i, tags: ["a", "b"], pos: {x: i, y: i + 1}}; i++; }
+var doc = {items: items, version: 1};
+var text = JSON.stringify(doc);
+var n = 0;
+var k = 0;
+while(k < 5) {
+	var back = JSON.parse(text);
+	n = n + back.items.length;
+	text = JSON.stringify(back);
+	k++;
+}
+debug(text.length, n);
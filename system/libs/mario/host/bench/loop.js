@@ -0,0 +1,4 @@
+var s = 0;
+var i = 0;
+while(i < 300000) { s = (s + i) % 1000003; i++; }
+debug(s);
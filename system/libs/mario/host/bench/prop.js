@@ -0,0 +1,6 @@
+class P { constructor(x) { this.a=1; this.b=2; this.c=3; this.d=4; this.e=5; this.f=6; this.g=7; this.h=8; this.i=9; this.j=x; } }
+var p = new P(10);
+var s = 0;
+var i = 0;
+while(i < 100000) { s = s + p.j + p.a + p.h; i++; }
+debug(s);
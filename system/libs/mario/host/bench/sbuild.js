@@ -0,0 +1,7 @@
+var s = "";
+var i = 0;
+while(i < 200000) {
+	s += "abc";
+	i++;
+}
+debug(s.length);
@@ -0,0 +1,40 @@
+#include "host.h"
+#include <vprintf.h>
+#include <string.h>
+
+/** EwokOS libc extras on the host libc.-----------------------------*/
+
+uint32_t div_u32(uint32_t v, uint32_t by) {
+	return by == 0 ? 0 : v / by;
+}
+
+uint32_t mod_u32(uint32_t v, uint32_t by) {
+	return by == 0 ? 0 : v % by;
+}
+
+int atoi_base(const char* s, int b) {
+	return (int)strtol(s, NULL, b);
+}
+
+void* realloc_raw(void* s, uint32_t old_size, uint32_t new_size) {
+	(void)old_size;
+	return realloc(s, new_size);
+}
+
+void v_printf(outc_func_t outc, void* p, const char* format, va_list ap) {
+	char buf[1024];
+	va_list aq;
+	va_copy(aq, ap);
+	int n = vsnprintf(buf, sizeof(buf), format, aq);
+	va_end(aq);
+
+	char* s = buf;
+	if(n >= (int)sizeof(buf)) {
+		s = (char*)malloc(n + 1);
+		vsnprintf(s, n + 1, format, ap);
+	}
+	for(int i = 0; i < n; i++)
+		outc(s[i], p);
+	if(s != buf)
+		free(s);
+}
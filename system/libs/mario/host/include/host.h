@@ -0,0 +1,18 @@
+#ifndef MARIO_HOST_H
+#define MARIO_HOST_H
+
+/*
+EwokOS libc extras used by libmario and libm, for building them on a host
+with the system libc. included ahead of every source by the host Makefile.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+uint32_t div_u32(uint32_t v, uint32_t by);
+uint32_t mod_u32(uint32_t v, uint32_t by);
+int atoi_base(const char* s, int b);
+void* realloc_raw(void* s, uint32_t old_size, uint32_t new_size);
+
+#endif
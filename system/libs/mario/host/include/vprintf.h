@@ -0,0 +1,12 @@
+#ifndef VPRINTF_H
+#define VPRINTF_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef void (*outc_func_t)(char c, void* p);
+
+void v_printf(outc_func_t outc, void* p, const char* format, va_list ap);
+
+#endif
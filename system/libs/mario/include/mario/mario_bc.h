@@ -21,6 +21,8 @@ typedef uint16_t opr_code_t;
 typedef struct st_bytecode {
 	PC cindex;
 	m_array_t str_table;
+	uint32_t* str_index; //hashed str_table, item index+1, 0 for empty
+	uint32_t str_index_max;
 	PC *code_buf;
 	uint32_t buf_size;
 } bytecode_t;
@@ -71,6 +73,9 @@ typedef struct st_bytecode {
 #define INSTR_MEMBERN      0x018 // : member with name
 #define INSTR_EXTENDS      0x019 // : class extends
 #define INSTR_FUNC_STC     0x01A // ST FUNC x     : static function definetion x
+#define INSTR_LOAD_LOCAL   0x01B // LOAD_LOCAL n  : load and push frame slot n
+#define INSTR_STORE_LOCAL  0x01C // STORE_LOCAL n : store to frame slot n
+#define INSTR_LOAD_UPVAL   0x01D // LOAD_UPVAL n  : load and push enclosing function var in slot n
 
 #define INSTR_NOT          0x020 // NOT           : !
 #define INSTR_MULTI        0x021 // MULTI         : *
@@ -86,6 +91,8 @@ typedef struct st_bytecode {
 #define INSTR_LSHIFT       0x02B // LSHIFT        : <<
 #define INSTR_RSHIFT       0x02C // RSHIFT        : >>
 #define INSTR_URSHIFT      0x02D // URSHIFT       : >>>
+#define INSTR_ADD_INT      0x02E // ADD_INT       : + of ints, quickened from PLUS
+#define INSTR_SUB_INT      0x02F // SUB_INT       : - of ints, quickened from MINUS
 
 #define INSTR_EQ           0x030 // EQ            : ==
 #define INSTR_NEQ          0x031 // NEQ           : !=
@@ -93,6 +100,9 @@ typedef struct st_bytecode {
 #define INSTR_GEQ          0x033 // GEQ           : >=
 #define INSTR_GRT          0x034 // GRT           : >
 #define INSTR_LES          0x035 // LES           : <
+#define INSTR_LT_INT       0x03B // LT_INT        : < of ints, quickened from LES
+#define INSTR_NJMP_LT      0x03C // NJMP_LT       : < of ints and the following NJMP/NJMPB in one
+#define INSTR_LOAD_LOCAL2  0x03D // LOAD_LOCAL2 ab: LOAD_LOCAL a; LOAD_LOCAL b (b in next word)
 
 #define INSTR_PLUSEQ       0x036 // +=
 #define INSTR_MINUSEQ      0x037 // -=	
@@ -139,6 +149,9 @@ typedef struct st_bytecode {
 #define INSTR_LOOP_END     0x0A3 // loop end
 #define INSTR_TRY          0x0A4 // try
 #define INSTR_TRY_END      0x0A5 // try end
+#define INSTR_SLOTS        0x0A6 // SLOTS n       : alloc n frame slots
+#define INSTR_LOCAL        0x0A7 // LOCAL x       : declare x in function scope, bind next slot
+#define INSTR_UPVAL        0x0A8 // UPVAL x       : next slot is enclosing var x, bound on first use
 
 #define INSTR_THROW        0x0B0 // throw
 #define INSTR_CATCH        0x0B1 // catch
@@ -161,10 +174,32 @@ PC bc_reserve(bytecode_t* bc);
 
 #define bc_getstr(bc, i) (((i)>=(bc)->str_table.size) ? "" : (const char*)(bc)->str_table.items[(i)])
 
+#ifdef MARIO_DEBUG
+const char* instr_str(opr_code_t ins);
+#endif
 void bc_dump(bytecode_t* bc);
 void bc_init(bytecode_t* bc);
 void bc_release(bytecode_t* bc);
 
+/*
+bytecode cache file, code and strings compiled after [base_code, base_strs):
++--------+-------------------------------------------------------------+
+| header | magic, version, src_hash, base_code, base_strs, base_hash,   |
+|        | code_num, strs_size, data_hash                              |
+|--------+-------------------------------------------------------------|
+| code   | code_num words                                              |
+| strs   | strs_size bytes of '\0' ended strings                       |
++--------+-------------------------------------------------------------+
+loaded only when the source and the base bytecode are the same.
+*/
+#define BC_CACHE_MAGIC   0x4342414D // "MABC"
+#define BC_CACHE_VERSION 1 // bump when opcodes or encoding change
+#define BC_HASH_INIT     2166136261u
+
+uint32_t bc_hash(uint32_t h, const void* data, uint32_t size);
+bool bc_save(bytecode_t* bc, PC base_code, uint32_t base_strs, uint32_t src_hash, const char* fname);
+bool bc_load(bytecode_t* bc, uint32_t src_hash, const char* fname);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
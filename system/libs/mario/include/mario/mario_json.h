@@ -8,6 +8,10 @@ extern "C" {
 #include "mario_vm.h"
 
 extern var_t* json_parse(vm_t* vm, const char* str);
+extern var_t* json_parse_fd(vm_t* vm, int fd);
+extern void json_stringify(var_t* var, str_t* ret);
+extern bool json_write_fd(var_t* var, int fd);
+extern void json_reg_natives(vm_t* vm);
 
 #ifdef __cplusplus
 }
@@ -27,6 +27,12 @@ bool compile(bytecode_t *bc, const char* input);
 #define V_ST_GC_FREE   1
 #define V_ST_GC        2
 #define V_ST_REF       3 
+#define V_ST_GC_OLD    4 //tenured, in vm->gc_old list
+
+#define GC_IDLE        0
+#define GC_MARK        1 //marking in steps, var_ref shades vars
+#define GC_SWEEP       2 //sweeping sealed nursery, then gc_old for major cycles, in steps
+#define GC_CLEAR       3 //unmarking in steps
 
 #define THIS "this"
 #define PROTOTYPE "prototype"
@@ -34,20 +40,27 @@ bool compile(bytecode_t *bc, const char* input);
 #define CONSTRUCTOR "constructor"
 
 struct st_vm;
+struct st_var_index;
 
 typedef struct st_var {
 	uint32_t magic: 8; //0 for var; 1 for node
-	uint32_t type:10;
+	uint32_t type:8;
+	uint32_t is_imm:2; //shared immediate(true/false/null/small int), never mutated or collected.
 	uint32_t status: 4;
 	uint32_t is_array:2;
 	uint32_t is_func:2;
 	uint32_t is_class:2;
-	uint32_t gc_marking: 2;
-	uint32_t gc_marked: 2;
+	uint32_t gc_marked: 1;
+	uint32_t gc_old: 1; //tenured, minor cycles don't scan it
+	uint32_t is_bytes:2; //byte array, bytes in value, length in size
 	uint32_t refs;
 
 	uint32_t size;  // size for bytes type of value;
 	void* value;
+	union {
+		int i;
+		float f;
+	} num; //inline storage of int/bool/float value, pointed by value.
 
 	free_func_t free_func; //how to free value
 	free_func_t on_destroy; //before destroyed.
@@ -55,9 +68,16 @@ typedef struct st_var {
 	struct st_var* prev; //for var list
 	struct st_var* next; //for var list
 	m_array_t children;
+	struct st_var_index* index; //hashed children, built when members grow
 	struct st_vm* vm;
 } var_t;
 
+typedef struct st_gc_list {
+	var_t* head;
+	var_t* tail;
+	uint32_t num;
+} gc_list_t;
+
 typedef var_t* (*native_func_t)(struct st_vm *, var_t*, void*);
 
 typedef struct st_func {
@@ -74,8 +94,9 @@ typedef struct st_func {
 typedef struct st_node {
 	int16_t magic: 8; //1 for node
   int16_t be_const : 8;
-	char* name;
+	const char* name; //interned by vm, compare by pointer
 	var_t* var;
+	var_t* owner; //var having it in children, for the gc write barrier
 } node_t;
 
 
@@ -97,6 +118,28 @@ typedef struct st_isignal {
 #endif
 
 #define VM_STACK_MAX    32
+#define VM_INT_MIN      (-8)
+#define VM_INT_MAX      255
+
+//inline cache for name resolving instructions, one per pc
+typedef struct st_icache {
+	uint32_t epoch; //vm->ic_epoch when filled
+	uint32_t ver;   //name version for LOAD, member slot for GET
+	node_t* node;
+} icache_t;
+
+#ifdef MARIO_STATS
+//perf counters for the host bench(libs/mario/host), not built for the target.
+typedef struct st_vm_stats {
+	uint64_t ops[256]; //instructions executed by opcode
+	uint64_t var_news; //vars created
+	uint64_t var_mallocs; //vars not reused from free_vars
+	uint32_t gc_steps; //gc pauses, a cycle takes one or more
+	uint64_t gc_pause_us;
+	uint64_t gc_pause_max_us;
+	uint64_t (*clock_us)(void); //set by the host for gc timing
+} vm_stats_t;
+#endif
 
 typedef struct st_vm {
 	bytecode_t bc;
@@ -131,25 +174,62 @@ typedef struct st_vm {
 	#endif
 
 	uint32_t this_strIndex;
+
+	//interned names
+	const char** names;
+	uint32_t names_num;
+	uint32_t names_max;
+	const char** bc_names; //interned names by string table index
+	uint32_t bc_names_num;
+	const char* name_this;
+	const char* name_prototype;
+	const char* name_closure;
+	const char* name_array;
+	const char* name_length;
+
+	icache_t* icache;
+	uint32_t icache_size;
+	uint32_t ic_epoch;
+
 	var_t* var_Object;
 	var_t* var_String;
 	var_t* var_Number;
 	var_t* var_Array;
+	var_t* var_Bytes;
 	var_t* var_true;
 	var_t* var_false;
 	var_t* var_null;
+	var_t* var_ints[VM_INT_MAX - VM_INT_MIN + 1]; //small int immediates, created on demand
 
 	//for gc
 	bool is_doing_gc;
-	uint32_t gc_buffer_size;
+	uint8_t gc_phase;
+	bool gc_major; //current cycle scans tenured vars and sweeps gc_old too
+	uint32_t gc_buffer_size; //young or remembered vars to start a cycle
 	uint32_t gc_free_buffer_size;
-	var_t* gc_vars;
-	var_t* gc_vars_tail;
-	uint32_t gc_vars_num;
+	uint32_t gc_step_size; //marked vars scanned by each step
+	uint32_t gc_major_cycles; //major cycle when tenured since last one reach live vars, n nurseries at least
+	uint32_t gc_cycles;
+	gc_list_t gc_young; //nursery, young vars unrefed but still referenced
+	gc_list_t gc_old; //tenured vars unrefed but still referenced
+	var_t* gc_sealed; //last nursery var of the running cycle, swept from head to it
+	var_t* gc_cursor; //next old var to sweep
+	uint32_t gc_tenured; //vars tenured since the last major cycle
+	uint32_t gc_live; //vars marked by the last major cycle
+	var_t** gc_marks; //marked vars, [0, gc_scan) are scanned
+	uint32_t gc_marks_num;
+	uint32_t gc_marks_max;
+	uint32_t gc_scan;
 	var_t* free_vars;
 	uint32_t free_vars_num;
+
+	#ifdef MARIO_STATS
+	vm_stats_t stats;
+	#endif
 } vm_t;
 
+const char* vm_name(vm_t* vm, const char* s, bool create);
+
 typedef str_t* (*load_m_func_t)(struct st_vm *, const char* jsname);
 extern load_m_func_t _load_m_func;
 
@@ -195,6 +275,7 @@ var_t* var_new_obj(vm_t* vm, void*p, free_func_t fr);
 var_t* var_new_float(vm_t* vm, float i);
 var_t* var_new_str(vm_t* vm, const char* s);
 var_t* var_new_str2(vm_t* vm, const char* s, uint32_t len);
+var_t* var_new_bytes(vm_t* vm, void* data, uint32_t size, bool borrowed);
 const char* var_get_str(var_t* var);
 var_t* var_set_str(var_t* var, const char* v);
 int var_get_int(var_t* var);
@@ -223,6 +304,7 @@ vm_t* vm_from(vm_t* vm);
 
 bool vm_load(vm_t* vm, const char* s);
 bool vm_load_run(vm_t* vm, const char* s);
+bool vm_load_bc(vm_t* vm, const char* s, const char* bc_fname);
 bool vm_load_run_native(vm_t* vm, const char* s);
 void vm_dump(vm_t* vm);
 bool vm_run(vm_t* vm);
@@ -367,6 +367,193 @@ bool statement(lex_t*, bytecode_t*);
 bool factor(lex_t*, bytecode_t*, bool member);
 bool base(lex_t*, bytecode_t*);
 
+/**
+function slots: "var"s and arguments of a function are declared at entry and
+bound to frame slots, loads of them compile to LOAD_LOCAL/STORE_LOCAL. names
+declared by enclosing functions compile to LOAD_UPVAL, bound once per call.
+names also declared by let/const/catch/function/class keep the name lookup.
+*/
+typedef struct st_func_ctx {
+	struct st_func_ctx* father;
+	m_array_t vars;   //arguments and var names
+	m_array_t others; //let, const, catch, function and class names
+	PC* skips;        //nested function and class ranges, [from, to) pairs
+	uint32_t skips_num;
+	uint32_t skips_max;
+	bool slotted;     //false for arrow functions
+} func_ctx_t;
+
+static func_ctx_t* _func = NULL;
+
+static bool names_has(m_array_t* names, const char* name) {
+	uint32_t i;
+	for(i=0; i<names->size; i++) {
+		if(strcmp((const char*)names->items[i], name) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void func_declare(const char* name, bool is_var) {
+	if(_func == NULL || name[0] == 0)
+		return;
+	m_array_t* names = is_var ? &_func->vars : &_func->others;
+	if(!names_has(names, name))
+		array_add_buf(names, (void*)name, strlen(name)+1);
+}
+
+static void func_begin(bool slotted) {
+	func_ctx_t* f = (func_ctx_t*)malloc(sizeof(func_ctx_t));
+	memset(f, 0, sizeof(func_ctx_t));
+	array_init(&f->vars);
+	array_init(&f->others);
+	f->slotted = slotted;
+	f->father = _func;
+	_func = f;
+}
+
+static void func_pop(void) {
+	func_ctx_t* f = _func;
+	_func = f->father;
+	array_clean(&f->vars, NULL);
+	array_clean(&f->others, NULL);
+	if(f->skips != NULL)
+		free(f->skips);
+	free(f);
+}
+
+/*record a nested range, ranges nested inside it were recorded before and are dropped*/
+static void func_skip(PC from, PC to) {
+	func_ctx_t* f = _func;
+	if(f == NULL)
+		return;
+	while(f->skips_num > 0 && f->skips[f->skips_num-2] >= from)
+		f->skips_num -= 2;
+	if(f->skips_num + 2 > f->skips_max) {
+		uint32_t max = f->skips_max == 0 ? 8 : f->skips_max*2;
+		f->skips = (PC*)realloc_raw(f->skips, f->skips_max*sizeof(PC), max*sizeof(PC));
+		f->skips_max = max;
+	}
+	f->skips[f->skips_num++] = from;
+	f->skips[f->skips_num++] = to;
+}
+
+/*code after 'from' moved by 'num' instructions back*/
+static void func_skip_shift(PC from, uint32_t num) {
+	func_ctx_t* f = _func;
+	uint32_t i;
+	if(f == NULL)
+		return;
+	for(i=0; i<f->skips_num; i++) {
+		if(f->skips[i] > from)
+			f->skips[i] -= num;
+	}
+}
+
+/*nearest enclosing function declaring name has it in a slot*/
+static bool func_upper_local(func_ctx_t* f, const char* name) {
+	while(f != NULL) {
+		if(names_has(&f->others, name))
+			return false;
+		if(names_has(&f->vars, name))
+			return f->slotted;
+		f = f->father;
+	}
+	return false;
+}
+
+static int32_t slot_index(m_array_t* slots, uint32_t str_index) {
+	uint32_t i;
+	for(i=0; i<slots->size; i++) {
+		if((uint32_t)(uintptr_t)slots->items[i] == str_index)
+			return (int32_t)i;
+	}
+	return -1;
+}
+
+/*
+body starts at the reserved 'pcs', which becomes a jump to the trailer:
+	SLOTS n; LOCAL x ...; UPVAL y ...; JMPB pcs+1
+*/
+static void func_end(bytecode_t* bc, PC pcs) {
+	func_ctx_t* f = _func;
+	if(!f->slotted) {
+		func_pop();
+		return;
+	}
+
+	m_array_t slots;
+	array_init(&slots);
+	uint32_t i, k, local_num;
+	PC pc, ins, end = bc->cindex;
+
+	for(i=0; i<f->vars.size; i++) {
+		const char* name = (const char*)f->vars.items[i];
+		if(!names_has(&f->others, name))
+			array_add(&slots, (void*)(uintptr_t)bc_getstrindex(bc, name));
+	}
+	local_num = slots.size;
+
+	for(k=0, pc=pcs+1; pc<end; ) {
+		if(k < f->skips_num && pc >= f->skips[k]) {
+			pc = f->skips[k+1];
+			k += 2;
+			continue;
+		}
+		ins = bc->code_buf[pc];
+		opr_code_t op = OP(ins);
+		if((op == INSTR_LOAD || op == INSTR_LOADO) && slot_index(&slots, OFF(ins)) < 0) {
+			const char* name = bc_getstr(bc, OFF(ins));
+			if(!names_has(&f->vars, name) && !names_has(&f->others, name) &&
+					func_upper_local(f->father, name))
+				array_add(&slots, (void*)(uintptr_t)OFF(ins));
+		}
+		pc += (op == INSTR_INT || op == INSTR_FLOAT) ? 2 : 1;
+	}
+
+	if(slots.size > 0) {
+		PC pair = ILLEGAL_PC; //last LOAD_LOCAL, fused with the next one into LOAD_LOCAL2
+		for(k=0, pc=pcs+1; pc<end; ) {
+			if(k < f->skips_num && pc >= f->skips[k]) {
+				pc = f->skips[k+1];
+				k += 2;
+				continue;
+			}
+			ins = bc->code_buf[pc];
+			opr_code_t op = OP(ins);
+			int32_t n;
+			if((op == INSTR_LOAD || op == INSTR_LOADO) && (n = slot_index(&slots, OFF(ins))) >= 0)
+				bc->code_buf[pc] = INS(((uint32_t)n < local_num) ? INSTR_LOAD_LOCAL : INSTR_LOAD_UPVAL, n);
+			else if(op == INSTR_STORE && (n = slot_index(&slots, OFF(ins))) >= 0 && (uint32_t)n < local_num)
+				bc->code_buf[pc] = INS(INSTR_STORE_LOCAL, n);
+			else if(op == INSTR_VAR && (n = slot_index(&slots, OFF(ins))) >= 0 && (uint32_t)n < local_num)
+				bc->code_buf[pc] = INS(INSTR_NIL, OFF_MASK);
+
+			ins = bc->code_buf[pc];
+			if(OP(ins) == INSTR_LOAD_LOCAL && pair + 1 == pc &&
+					OFF(ins) < 0x400 && OFF(bc->code_buf[pair]) < 0x400) {
+				/*keep the second LOAD_LOCAL, jumps may land on it*/
+				bc->code_buf[pair] = INS(INSTR_LOAD_LOCAL2, OFF(bc->code_buf[pair]) | (OFF(ins) << 10));
+				pair = ILLEGAL_PC;
+			}
+			else {
+				pair = (OP(ins) == INSTR_LOAD_LOCAL) ? pc : ILLEGAL_PC;
+			}
+			pc += (op == INSTR_INT || op == INSTR_FLOAT) ? 2 : 1;
+		}
+
+		bc_set_instr(bc, pcs, INSTR_JMP, ILLEGAL_PC);
+		bc_gen_short(bc, INSTR_SLOTS, slots.size);
+		for(i=0; i<slots.size; i++) {
+			bc_gen_short(bc, i < local_num ? INSTR_LOCAL : INSTR_UPVAL,
+					(int32_t)(uintptr_t)slots.items[i]);
+		}
+		bc_add_instr(bc, pcs+1, INSTR_JMPB, ILLEGAL_PC);
+	}
+	array_remove_all(&slots);
+	func_pop();
+}
+
 void gen_func_name(const char* name, int arg_num, str_t* full) {
 	str_reset(full);
 	str_cpy(full, name);
@@ -440,6 +627,7 @@ bool stmt_block(lex_t* l, bytecode_t* bc, bool func) {
 
 bool factor_def_func(lex_t* l, bytecode_t* bc, str_t* name) {
 	bool is_static = false;
+	PC start = bc->cindex;
 	lex_skip_empty(l);
 
 	if (l->tk == LEX_R_STATIC) {
@@ -470,8 +658,10 @@ bool factor_def_func(lex_t* l, bytecode_t* bc, str_t* name) {
 	lex_skip_empty(l);
 	//do arguments
 	if(!lex_chkread(l, '(')) return false;
+	func_begin(true);
 	while (l->tk!=')') {
 		bc_gen_str(bc, INSTR_LOAD, l->tk_str->cstr);
+		func_declare(l->tk_str->cstr, true);
 		//bc_gen_str(bc, INSTR_VAR, l->tk_str->cstr);
 		if(!lex_chkread(l, LEX_ID)) return false;
 		if (l->tk!=')') {
@@ -481,17 +671,26 @@ bool factor_def_func(lex_t* l, bytecode_t* bc, str_t* name) {
 	if(!lex_chkread(l, ')')) return false;
 	lex_skip_empty(l);
 	PC pc = bc_reserve(bc);
+	PC pcs = bc_reserve(bc); //entry, jump to slots binding
 	stmt_block(l, bc, true);
 	opr_code_t op = bc->code_buf[bc->cindex - 1] >> 16;
 
 	if(op != INSTR_RETURN && op != INSTR_RETURNV)
 		bc_gen(bc, INSTR_RETURN);
+	func_end(bc, pcs);
 	bc_set_instr(bc, pc, INSTR_JMP, ILLEGAL_PC);
+	func_skip(start, bc->cindex);
 	return true;
 }
 
-bool factor_def_afunc(lex_t* l, bytecode_t* bc) {
+bool factor_def_afunc(lex_t* l, bytecode_t* bc, PC start) {
+	PC i;
 	lex_skip_empty(l);
+	func_begin(false);
+	for(i=start+1; i<bc->cindex; i++) { //arguments
+		if(OP(bc->code_buf[i]) == INSTR_LOAD)
+			func_declare(bc_getstr(bc, OFF(bc->code_buf[i])), true);
+	}
 	PC pc = bc_reserve(bc);
 	statement(l, bc);
 
@@ -500,6 +699,8 @@ bool factor_def_afunc(lex_t* l, bytecode_t* bc) {
 	if(op != INSTR_RETURN && op != INSTR_RETURNV)
 		bc_gen(bc, INSTR_RETURN);
 	bc_set_instr(bc, pc, INSTR_JMP, ILLEGAL_PC);
+	func_end(bc, pc);
+	func_skip(start, bc->cindex);
 	return true;	
 }
 
@@ -519,6 +720,7 @@ bool factor_def_class(lex_t* l, bytecode_t* bc) {
 	// actually parse a class...
 	if(!lex_chkread(l, LEX_R_CLASS)) return false;
 	str_t* name = str_new("");
+	PC start = bc->cindex;
 
 	lex_skip_empty(l);
 	/* we can have classes without names */
@@ -527,6 +729,7 @@ bool factor_def_class(lex_t* l, bytecode_t* bc) {
 		if(!lex_chkread(l, LEX_ID)) return false;
 	}
 	bc_gen_str(bc, INSTR_CLASS, name->cstr);
+	func_declare(name->cstr, false);
 
 	lex_skip_empty(l);
 	/*read extends*/
@@ -561,6 +764,7 @@ bool factor_def_class(lex_t* l, bytecode_t* bc) {
 	}
 	if(!lex_chkread(l, '}')) return false;
 	bc_gen(bc, INSTR_CLASS_END);
+	func_skip(start, bc->cindex);
 
 	str_free(name);
 	return true;
@@ -664,10 +868,11 @@ bool factor(lex_t* l, bytecode_t* bc, bool member) {
 		if(l->tk == LEX_R_AFUNCTION) {
 			if(!lex_chkread(l, LEX_R_AFUNCTION)) return false;
 			bc_set_instr(bc, pc, INSTR_FUNC, 0);
-			factor_def_afunc(l, bc);
+			factor_def_afunc(l, bc, pc);
 		}
 		else {
 			bc_remove_instr(bc, pc, 1);
+			func_skip_shift(pc, 1);
 		}
 	}
 	else if (l->tk==LEX_R_TRUE) {
@@ -735,9 +940,9 @@ bool factor(lex_t* l, bytecode_t* bc, bool member) {
 			}
 			else if (l->tk == LEX_R_AFUNCTION) {
 				if(!lex_chkread(l, LEX_R_AFUNCTION)) return false;
-				bc_gen(bc, INSTR_FUNC);
+				PC pc = bc_gen(bc, INSTR_FUNC) - 1;
 				bc_gen_str(bc, INSTR_LOAD, name->cstr);	
-				factor_def_afunc(l, bc);
+				factor_def_afunc(l, bc, pc);
 			}
 			else {
 				bc_gen_str(bc, INSTR_LOAD, name->cstr);	
@@ -962,7 +1167,15 @@ bool ternary(lex_t *l, bytecode_t* bc) {
 	return true;	
 }
 
+/*plain "x = ..." on a var of the current function stores without loading x first*/
+static bool is_var_load(bytecode_t* bc, PC pc) {
+	if(_func == NULL || pc+1 != bc->cindex || OP(bc->code_buf[pc]) != INSTR_LOAD)
+		return false;
+	return names_has(&_func->vars, bc_getstr(bc, OFF(bc->code_buf[pc])));
+}
+
 bool base(lex_t* l, bytecode_t* bc) {
+	PC pc = bc->cindex;
 	if(!ternary(l, bc))
 		return false;
 
@@ -973,10 +1186,18 @@ bool base(lex_t* l, bytecode_t* bc) {
 			l->tk==LEX_MODEQUAL ||
 			l->tk==LEX_MINUSEQUAL) {
 		LEX_TYPES op = (LEX_TYPES)l->tk;
+		uint32_t store = OFF_MASK;
 		if(!lex_chkread(l, l->tk)) return false;
+		if(op == '=' && is_var_load(bc, pc)) {
+			store = OFF(bc->code_buf[pc]);
+			bc_remove_instr(bc, pc, 1);
+		}
 		base(l, bc);
 		// sort out initialiser
-		if (op == '=')  {
+		if (store != OFF_MASK)  {
+			bc_gen_short(bc, INSTR_STORE, store);
+		}
+		else if (op == '=')  {
 			bc_gen(bc, INSTR_ASIGN);
 		}
 		else if(op == LEX_PLUSEQUAL) {
@@ -1023,12 +1244,19 @@ bool stmt_var(lex_t* l, bytecode_t* bc) {
 		str_t* vname = str_new(l->tk_str->cstr);
 		if(!lex_chkread(l, LEX_ID)) return false;
 		bc_gen_str(bc, op, vname->cstr);
+		func_declare(vname->cstr, op == INSTR_VAR);
 		// sort out initialiser
 		if (l->tk == '=') {
 			if(!lex_chkread(l, '=')) return false;
-			bc_gen_str(bc, INSTR_LOAD, vname->cstr);
-			if(!base(l, bc)) return false;
-			bc_gen(bc, INSTR_ASIGN);
+			if(op == INSTR_VAR && _func != NULL) {
+				if(!base(l, bc)) return false;
+				bc_gen_str(bc, INSTR_STORE, vname->cstr);
+			}
+			else {
+				bc_gen_str(bc, INSTR_LOAD, vname->cstr);
+				if(!base(l, bc)) return false;
+				bc_gen(bc, INSTR_ASIGN);
+			}
 			bc_gen(bc, INSTR_POP);
 		}
 		if (!is_stmt_end(l->tk))
@@ -1140,6 +1368,7 @@ bool stmt_function(lex_t* l, bytecode_t* bc) {
 	if(!lex_chkread(l, LEX_R_FUNCTION)) return false;
 	str_t* fname = str_new("");
 	factor_def_func(l, bc, fname);
+	func_declare(fname->cstr, false);
 	bc_gen_str(bc, INSTR_MEMBERN, fname->cstr);
 	str_free(fname);
 	return true;
@@ -1189,6 +1418,7 @@ bool stmt_try(lex_t* l, bytecode_t* bc) {
 	lex_skip_empty(l);
 	if(!lex_chkread(l, '(')) return false;
 	bc_gen_str(bc, INSTR_CATCH, l->tk_str->cstr);
+	func_declare(l->tk_str->cstr, false);
 	if(!lex_chkread(l, LEX_ID)) return false;
 	if(!lex_chkread(l, ')')) return false;
 	lex_skip_empty(l);
@@ -1291,15 +1521,19 @@ bool compile(bytecode_t *bc, const char* input) {
 	lex_init(&lex, input);
 	lex_get_next_token(&lex);
 
+	bool ret = true;
 	while(lex.tk) {
 		if(!statement(&lex, bc)) {
-			lex_release(&lex);
-			return false;
+			ret = false;
+			break;
 		}
 	}
-	bc_gen(bc, INSTR_END);
+	while(_func != NULL) //left by errors
+		func_pop();
+	if(ret)
+		bc_gen(bc, INSTR_END);
 	lex_release(&lex);
-	return true;
+	return ret;
 }
 
 #ifdef __cplusplus
@@ -17,22 +17,58 @@ extern "C" {
 #define BC_BUF_SIZE  3232
 
 
+//FNV-1a
+uint32_t bc_hash(uint32_t h, const void* data, uint32_t size) {
+	const uint8_t* p = (const uint8_t*)data;
+	while(size-- > 0) {
+		h ^= *p++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void bc_str_index_grow(bytecode_t* bc) {
+	uint32_t max = bc->str_index_max == 0 ? 256 : bc->str_index_max*2;
+	uint32_t* index = (uint32_t*)malloc(max * sizeof(uint32_t));
+	memset(index, 0, max * sizeof(uint32_t));
+
+	uint32_t i;
+	for(i=0; i<bc->str_table.size; i++) {
+		const char* s = (const char*)bc->str_table.items[i];
+		uint32_t h = bc_hash(BC_HASH_INIT, s, (uint32_t)strlen(s)) & (max-1);
+		while(index[h] != 0)
+			h = (h+1) & (max-1);
+		index[h] = i+1;
+	}
+
+	if(bc->str_index != NULL)
+		free(bc->str_index);
+	bc->str_index = index;
+	bc->str_index_max = max;
+}
+
 uint32_t bc_getstrindex(bytecode_t* bc, const char* str) {
 	uint32_t sz = bc->str_table.size;
-	uint32_t i;
 	if(str == NULL || str[0] == 0)
 		return OFF_MASK;
 
-	for(i=0; i<sz; ++i) {
-		char* s = (char*)bc->str_table.items[i];
-		if(s != NULL && strcmp(s, str) == 0)
-			return i;
-	}
+	if((sz+1)*4 >= bc->str_index_max*3)
+		bc_str_index_grow(bc);
 
 	uint32_t len = (uint32_t)strlen(str);
+	uint32_t mask = bc->str_index_max - 1;
+	uint32_t h = bc_hash(BC_HASH_INIT, str, len) & mask;
+	uint32_t i;
+	while((i = bc->str_index[h]) != 0) {
+		if(strcmp((const char*)bc->str_table.items[i-1], str) == 0)
+			return i-1;
+		h = (h+1) & mask;
+	}
+
 	char* p = (char*)malloc(len + 1);
 	memcpy(p, str, len+1);
 	array_add(&bc->str_table, p);
+	bc->str_index[h] = sz+1;
 	return sz;
 }	
 
@@ -40,18 +76,23 @@ void bc_init(bytecode_t* bc) {
 	bc->cindex = 0;
 	bc->code_buf = NULL;
 	bc->buf_size = 0;
+	bc->str_index = NULL;
+	bc->str_index_max = 0;
 	array_init(&bc->str_table);
 }
 
 void bc_release(bytecode_t* bc) {
 	array_clean(&bc->str_table, NULL);
+	if(bc->str_index != NULL)
+		free(bc->str_index);
 	if(bc->code_buf != NULL)
 		free(bc->code_buf);
 }
 
-void bc_addc(bytecode_t* bc, PC ins) {
-	if(bc->cindex >= bc->buf_size) {
-		bc->buf_size = bc->cindex + BC_BUF_SIZE;
+//make room for num more code words.
+static void bc_grow(bytecode_t* bc, uint32_t num) {
+	if(bc->cindex + num > bc->buf_size) {
+		bc->buf_size = bc->cindex + num + BC_BUF_SIZE;
 		PC *new_buf = (PC*)malloc(bc->buf_size*sizeof(PC));
 
 		if(bc->cindex > 0 && bc->code_buf != NULL) {
@@ -60,7 +101,10 @@ void bc_addc(bytecode_t* bc, PC ins) {
 		}
 		bc->code_buf = new_buf;
 	}
+}
 
+void bc_addc(bytecode_t* bc, PC ins) {
+	bc_grow(bc, 1);
 	bc->code_buf[bc->cindex] = ins;
 	bc->cindex++;
 }
@@ -89,7 +133,7 @@ PC bc_gen_int(bytecode_t* bc, opr_code_t instr, int32_t i) {
 
 PC bc_gen_short(bytecode_t* bc, opr_code_t instr, int32_t s) {
 	PC ins = bc_bytecode(bc, instr, "");
-	ins = (ins&0xFFF0000) | (s&OFF_MASK);
+	ins = (ins&0xFFF00000) | (s&OFF_MASK);
 	bc_addc(bc, ins);
 	return bc->cindex;
 }
@@ -165,6 +209,160 @@ PC bc_add_instr(bytecode_t* bc, PC anchor, opr_code_t op, PC target) {
 	return bc->cindex;
 } 
 
+/** bytecode cache file.-----------------------------*/
+
+typedef struct st_bc_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t src_hash;
+	uint32_t base_code;
+	uint32_t base_strs;
+	uint32_t base_hash;
+	uint32_t code_num;
+	uint32_t strs_size;
+	uint32_t data_hash;
+} bc_cache_header_t;
+
+//hash of the bytecode compiled before the cached one(natives and included js).
+static uint32_t bc_base_hash(bytecode_t* bc, PC base_code, uint32_t base_strs) {
+	uint32_t h = bc_hash(BC_HASH_INIT, bc->code_buf, base_code*sizeof(PC));
+	uint32_t i;
+	for(i=0; i<base_strs; i++) {
+		const char* s = bc_getstr(bc, i);
+		h = bc_hash(h, s, (uint32_t)strlen(s)+1);
+	}
+	return h;
+}
+
+static bool bc_fwrite(FILE* fp, const void* data, uint32_t size) {
+	const char* p = (const char*)data;
+	while(size > 0) {
+		uint32_t n = fwrite(p, 1, size, fp);
+		if(n == 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool bc_fread(FILE* fp, void* data, uint32_t size) {
+	char* p = (char*)data;
+	while(size > 0) {
+		uint32_t n = fread(p, 1, size, fp);
+		if(n == 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+/*save code and strings added since base_code/base_strs, before it runs(quickening rewrites code).*/
+bool bc_save(bytecode_t* bc, PC base_code, uint32_t base_strs, uint32_t src_hash, const char* fname) {
+	if(base_code >= bc->cindex || base_strs > bc->str_table.size)
+		return false;
+
+	bc_cache_header_t hd;
+	hd.magic = BC_CACHE_MAGIC;
+	hd.version = BC_CACHE_VERSION;
+	hd.src_hash = src_hash;
+	hd.base_code = base_code;
+	hd.base_strs = base_strs;
+	hd.base_hash = bc_base_hash(bc, base_code, base_strs);
+	hd.code_num = bc->cindex - base_code;
+
+	uint32_t i;
+	hd.strs_size = 0;
+	for(i=base_strs; i<bc->str_table.size; i++)
+		hd.strs_size += (uint32_t)strlen(bc_getstr(bc, i)) + 1;
+
+	char* strs = NULL;
+	if(hd.strs_size > 0) {
+		strs = (char*)malloc(hd.strs_size);
+		if(strs == NULL)
+			return false;
+		char* p = strs;
+		for(i=base_strs; i<bc->str_table.size; i++) {
+			const char* s = bc_getstr(bc, i);
+			uint32_t len = (uint32_t)strlen(s) + 1;
+			memcpy(p, s, len);
+			p += len;
+		}
+	}
+
+	hd.data_hash = bc_hash(BC_HASH_INIT, bc->code_buf + base_code, hd.code_num*sizeof(PC));
+	hd.data_hash = bc_hash(hd.data_hash, strs, hd.strs_size);
+
+	bool ret = false;
+	FILE* fp = fopen(fname, "w+");
+	if(fp != NULL) {
+		ret = bc_fwrite(fp, &hd, sizeof(hd)) &&
+				bc_fwrite(fp, bc->code_buf + base_code, hd.code_num*sizeof(PC)) &&
+				bc_fwrite(fp, strs, hd.strs_size);
+		fclose(fp);
+	}
+	if(strs != NULL)
+		free(strs);
+	return ret;
+}
+
+static bool bc_load_fp(bytecode_t* bc, uint32_t src_hash, FILE* fp) {
+	bc_cache_header_t hd;
+	if(!bc_fread(fp, &hd, sizeof(hd)) ||
+			hd.magic != BC_CACHE_MAGIC ||
+			hd.version != BC_CACHE_VERSION ||
+			hd.src_hash != src_hash ||
+			hd.base_code != bc->cindex ||
+			hd.base_strs != bc->str_table.size ||
+			hd.code_num == 0 ||
+			hd.base_hash != bc_base_hash(bc, hd.base_code, hd.base_strs))
+		return false;
+
+	//read code right behind the base, it's only taken by moving cindex.
+	bc_grow(bc, hd.code_num);
+	PC* code = bc->code_buf + bc->cindex;
+	if(!bc_fread(fp, code, hd.code_num*sizeof(PC)))
+		return false;
+
+	char* strs = NULL;
+	if(hd.strs_size > 0) {
+		strs = (char*)malloc(hd.strs_size);
+		if(strs == NULL)
+			return false;
+		if(!bc_fread(fp, strs, hd.strs_size) || strs[hd.strs_size-1] != 0) {
+			free(strs);
+			return false;
+		}
+	}
+
+	uint32_t h = bc_hash(BC_HASH_INIT, code, hd.code_num*sizeof(PC));
+	bool ret = (bc_hash(h, strs, hd.strs_size) == hd.data_hash);
+	uint32_t off = 0;
+	while(ret && off < hd.strs_size) { //each one is new, or indexes in code differ.
+		const char* s = strs + off;
+		uint32_t n = bc->str_table.size;
+		ret = (bc_getstrindex(bc, s) == n);
+		off += (uint32_t)strlen(s) + 1;
+	}
+	if(strs != NULL)
+		free(strs);
+
+	if(ret)
+		bc->cindex += hd.code_num;
+	return ret;
+}
+
+/*load cached code compiled from the same source onto the same base bytecode.*/
+bool bc_load(bytecode_t* bc, uint32_t src_hash, const char* fname) {
+	FILE* fp = fopen(fname, "r");
+	if(fp == NULL)
+		return false;
+	bool ret = bc_load_fp(bc, src_hash, fp);
+	fclose(fp);
+	return ret;
+}
+
 #ifdef MARIO_DEBUG
 
 const char* instr_str(opr_code_t ins) {
@@ -189,6 +387,12 @@ const char* instr_str(opr_code_t ins) {
 		case  INSTR_LOAD				: return "LOAD";
 		case  INSTR_LOADO				: return "LOADO";
 		case  INSTR_STORE				: return "STORE";
+		case  INSTR_LOAD_LOCAL	: return "LOADL";
+		case  INSTR_STORE_LOCAL	: return "STOREL";
+		case  INSTR_LOAD_UPVAL	: return "LOADU";
+		case  INSTR_SLOTS				: return "SLOTS";
+		case  INSTR_LOCAL				: return "LOCAL";
+		case  INSTR_UPVAL				: return "UPVAL";
 		case  INSTR_JMP					: return "JMP";
 		case  INSTR_NJMP				: return "NJMP";
 		case  INSTR_JMPB				: return "JMPB";
@@ -216,6 +420,11 @@ const char* instr_str(opr_code_t ins) {
 		case  INSTR_LSHIFT			: return "LSHIFT";
 		case  INSTR_RSHIFT			: return "RSHIFT";
 		case  INSTR_URSHIFT			: return "URSHIFT";
+		case  INSTR_ADD_INT			: return "ADDI";
+		case  INSTR_SUB_INT			: return "SUBI";
+		case  INSTR_LT_INT			: return "LTI";
+		case  INSTR_NJMP_LT			: return "NJMPLT";
+		case  INSTR_LOAD_LOCAL2	: return "LOADL2";
 		case  INSTR_EQ					: return "EQ";
 		case  INSTR_NEQ					: return "NEQ";
 		case  INSTR_LEQ					: return "LEQ";
@@ -274,7 +483,12 @@ PC bc_get_instr_str(bytecode_t* bc, PC i, str_t* ret) {
 				instr == INSTR_NJMP || 
 				instr == INSTR_NJMPB ||
 				instr == INSTR_JMPB ||
-				instr == INSTR_INT_S) {
+				instr == INSTR_INT_S ||
+				instr == INSTR_LOAD_LOCAL ||
+				instr == INSTR_STORE_LOCAL ||
+				instr == INSTR_LOAD_UPVAL ||
+				instr == INSTR_LOAD_LOCAL2 ||
+				instr == INSTR_SLOTS) {
 			snprintf(s, 128, "%08d | 0x%08X ; %s\t%d", i, ins, instr_str(instr), offset);	
 			str_add(ret, s);
 		}
@@ -3,199 +3,614 @@ extern "C" {
 #endif
 
 #include "mario/mario_json.h"
-#include "mario/mario_lex.h"
 #include "mario/mario_vm.h"
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 
-typedef enum {
-  // reserved words
-#define LEX_R_LIST_START LEX_R_IF
-  LEX_R_FUNCTION,
-  LEX_R_TRUE,
-  LEX_R_FALSE,
-  LEX_R_NULL,
-  LEX_R_UNDEFINED,
-  LEX_R_LIST_END /* always the last entry */
-} JSON_LEX_TYPES;
-
-static void lex_js_get_js_str(lex_t* lex) {
-	// js style strings 
-	lex_get_nextch(lex);
-	while (lex->curr_ch && lex->curr_ch!='\'') {
-		if (lex->curr_ch == '\\') {
-			lex_get_nextch(lex);
-			switch (lex->curr_ch) {
-				case 'n' : str_addc(lex->tk_str, '\n'); break;
-				case 'a' : str_addc(lex->tk_str, '\a'); break;
-				case 'r' : str_addc(lex->tk_str, '\r'); break;
-				case 't' : str_addc(lex->tk_str, '\t'); break;
-				case '\'' : str_addc(lex->tk_str, '\''); break;
-				case '\\' : str_addc(lex->tk_str, '\\'); break;
-				case 'x' : { // hex digits
-										 char buf[3] = "??";
-										 lex_get_nextch(lex);
-										 buf[0] = lex->curr_ch;
-										 lex_get_nextch(lex);
-										 buf[1] = lex->curr_ch;
-										 str_addc(lex->tk_str, (char)atoi_base(buf, 16));
-									 } break;
-				default: if (lex->curr_ch>='0' && lex->curr_ch<='7') {
-									 // octal digits
-									 char buf[4] = "???";
-									 buf[0] = lex->curr_ch;
-									 lex_get_nextch(lex);
-									 buf[1] = lex->curr_ch;
-									 lex_get_nextch(lex);
-									 buf[2] = lex->curr_ch;
-									 str_addc(lex->tk_str, (char)atoi_base(buf, 8));
-								 } else
-									 str_addc(lex->tk_str, lex->curr_ch);
+/** json reader.-----------------------------
+chars come from a string or from an fd read JSON_CHUNK bytes at a time, so a
+file is never held in memory as a whole. token text(strings, keys, numbers)
+is decoded into tok, a scratch buffer owned by the document and reused by
+every token, so parsing allocates nothing but the vars it returns.
+*/
+
+#define JSON_CHUNK 4096
+#define JSON_EOF (-1)
+
+typedef struct {
+	int fd; //-1 for parsing a string
+	const char* p;
+	uint32_t pos;
+	uint32_t size;
+	bool err;
+	str_t tok;
+	char* chunk;
+} json_in_t;
+
+static bool json_fill(json_in_t* in) {
+	if(in->fd < 0)
+		return false;
+
+	while(true) {
+		int n = read(in->fd, in->chunk, JSON_CHUNK);
+		if(n < 0 && errno == EAGAIN)
+			continue;
+		if(n <= 0)
+			return false;
+		in->p = in->chunk;
+		in->pos = 0;
+		in->size = n;
+		return true;
+	}
+}
+
+static inline int json_peek(json_in_t* in) {
+	if(in->pos >= in->size && !json_fill(in))
+		return JSON_EOF;
+	return (uint8_t)in->p[in->pos];
+}
+
+static inline int json_getc(json_in_t* in) {
+	int c = json_peek(in);
+	if(c != JSON_EOF)
+		in->pos++;
+	return c;
+}
+
+static void json_skip_spaces(json_in_t* in) {
+	while(true) {
+		int c = json_peek(in);
+		if(c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+			in->pos++;
+			continue;
+		}
+		if(c != '/')
+			return;
+
+		in->pos++;
+		c = json_getc(in);
+		if(c == '/') { //comment line
+			while(c != JSON_EOF && c != '\n')
+				c = json_getc(in);
+		}
+		else if(c == '*') { //comment block
+			int last = 0;
+			while(true) {
+				c = json_getc(in);
+				if(c == JSON_EOF || (last == '*' && c == '/'))
+					break;
+				last = c;
 			}
-		} else {
-			str_addc(lex->tk_str, lex->curr_ch);
 		}
-		lex_get_nextch(lex);
+		else {
+			in->err = true;
+			return;
+		}
 	}
-	lex_get_nextch(lex);
-	lex->tk = LEX_STR;
 }
 
-static void lex_js_get_reserved_word(lex_t *lex) {
-	if (strcmp(lex->tk_str->cstr, "function") == 0)  lex->tk = LEX_R_FUNCTION;
-	else if (strcmp(lex->tk_str->cstr, "true") == 0)      lex->tk = LEX_R_TRUE;
-	else if (strcmp(lex->tk_str->cstr, "false") == 0)     lex->tk = LEX_R_FALSE;
-	else if (strcmp(lex->tk_str->cstr, "null") == 0)      lex->tk = LEX_R_NULL;
-	else if (strcmp(lex->tk_str->cstr, "undefined") == 0) lex->tk = LEX_R_UNDEFINED;
+static inline int json_hex(int c) {
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
 }
 
-static void lex_js_get_next_token(lex_t* lex) {
-	lex->tk = LEX_EOF;
-	str_reset(lex->tk_str);
-
-	lex_skip_whitespace(lex);
-	if(lex_skip_comments_line(lex, "//")) {
-		lex_js_get_next_token(lex);
-		return;
+static void json_add_utf8(str_t* s, uint32_t u) {
+	if(u < 0x80) {
+		str_addc(s, (char)u);
 	}
-	if(lex_skip_comments_block(lex, "/*", "*/")) {
-		lex_js_get_next_token(lex);
-		return;
+	else if(u < 0x800) {
+		str_addc(s, (char)(0xC0 | (u >> 6)));
+		str_addc(s, (char)(0x80 | (u & 0x3F)));
+	}
+	else {
+		str_addc(s, (char)(0xE0 | (u >> 12)));
+		str_addc(s, (char)(0x80 | ((u >> 6) & 0x3F)));
+		str_addc(s, (char)(0x80 | (u & 0x3F)));
+	}
+}
+
+static void json_read_escape(json_in_t* in) {
+	int c = json_getc(in);
+	int i, h, u = 0;
+	switch(c) {
+		case 'n' : str_addc(&in->tok, '\n'); break;
+		case 'a' : str_addc(&in->tok, '\a'); break;
+		case 'b' : str_addc(&in->tok, '\b'); break;
+		case 'f' : str_addc(&in->tok, '\f'); break;
+		case 'r' : str_addc(&in->tok, '\r'); break;
+		case 't' : str_addc(&in->tok, '\t'); break;
+		case 'x' :
+		case 'u' :
+			for(i = 0; i < (c == 'x' ? 2 : 4); i++) {
+				h = json_hex(json_peek(in));
+				if(h < 0)
+					break;
+				in->pos++;
+				u = (u << 4) | h;
+			}
+			json_add_utf8(&in->tok, u);
+			break;
+		case JSON_EOF: in->err = true; break;
+		default: str_addc(&in->tok, (char)c); //quotes, slashes
 	}
+}
 
-	lex_token_start(lex);
-	lex_get_basic_token(lex);
+//string quoted by ' or ", plain runs are copied in bulk from the chunk.
+static void json_read_str(json_in_t* in) {
+	int q = json_getc(in);
+	str_reset(&in->tok);
+	while(true) {
+		uint32_t start = in->pos;
+		while(in->pos < in->size) {
+			char c = in->p[in->pos];
+			if(c == q || c == '\\')
+				break;
+			in->pos++;
+		}
+		str_addn(&in->tok, in->p + start, in->pos - start);
 
-	if (lex->tk == LEX_ID) { //  IDs
-		lex_js_get_reserved_word(lex);
-	} 
-	else if(lex->tk == LEX_EOF) {
-		if (lex->curr_ch=='\'') {
-			// js style strings 
-			lex_js_get_js_str(lex);
-		} 
-		else {
-			lex_get_char_token(lex);
+		int c = json_getc(in);
+		if(c == q)
+			return;
+		if(c == '\\')
+			json_read_escape(in);
+		else if(c == JSON_EOF) {
+			in->err = true;
+			return;
 		}
+		else
+			str_addc(&in->tok, (char)c);
 	}
+}
 
-	lex_token_end(lex);
+static inline bool json_word_char(int c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+			(c >= 'A' && c <= 'Z') || c == '_' || c == '$' ||
+			c == '.' || c == '-' || c == '+';
 }
 
-static bool lex_js_chkread(lex_t* lex, uint32_t expected_tk) {
-	if (lex->tk != expected_tk) {
-		return false;
+//numbers and names(true, false, null, keys not quoted).
+static void json_read_word(json_in_t* in) {
+	str_reset(&in->tok);
+	while(json_word_char(json_peek(in)))
+		str_addc(&in->tok, (char)in->p[in->pos++]);
+}
+
+static var_t* json_read_value(vm_t* vm, json_in_t* in);
+
+//scalars are cloned when added, the parsed one is dropped after.
+static void json_add(var_t* var, const char* name, var_t* v) {
+	var_ref(v);
+	if(name == NULL)
+		var_array_add(var, v);
+	else
+		var_add(var, name, v);
+	var_unref(v);
+}
+
+static var_t* json_read_array(vm_t* vm, json_in_t* in) {
+	var_t* arr = var_new_array(vm);
+	in->pos++; // [
+	json_skip_spaces(in);
+	if(json_peek(in) == ']') {
+		in->pos++;
+		return arr;
 	}
-	lex_js_get_next_token(lex);
-	return true;
+
+	while(!in->err) {
+		json_add(arr, NULL, json_read_value(vm, in));
+		json_skip_spaces(in);
+		int c = json_getc(in);
+		if(c == ']')
+			break;
+		if(c != ',') {
+			in->err = true;
+			break;
+		}
+		json_skip_spaces(in);
+		if(json_peek(in) == ']') { //trailing comma
+			in->pos++;
+			break;
+		}
+	}
+	return arr;
 }
 
-static var_t* json_parse_factor(vm_t* vm, lex_t *l) {
-	if (l->tk==LEX_R_TRUE) {
-		lex_js_chkread(l, LEX_R_TRUE);
-		return var_new_int(vm, 1);
+static var_t* json_read_object(vm_t* vm, json_in_t* in) {
+	var_t* obj = var_new_obj(vm, NULL, NULL);
+	in->pos++; // {
+	while(!in->err) {
+		json_skip_spaces(in);
+		int c = json_peek(in);
+		if(c == '}') {
+			in->pos++;
+			break;
+		}
+
+		if(c == '"' || c == '\'')
+			json_read_str(in);
+		else
+			json_read_word(in);
+		if(in->tok.len == 0) {
+			in->err = true;
+			break;
+		}
+		//keys are interned, so tok can be reused by the value.
+		const char* name = vm_name(vm, in->tok.cstr, true);
+
+		json_skip_spaces(in);
+		if(json_getc(in) != ':') {
+			in->err = true;
+			break;
+		}
+		json_add(obj, name, json_read_value(vm, in));
+
+		json_skip_spaces(in);
+		c = json_getc(in);
+		if(c == '}')
+			break;
+		if(c != ',')
+			in->err = true;
 	}
-	else if (l->tk==LEX_R_FALSE) {
-		lex_js_chkread(l, LEX_R_FALSE);
-		return var_new_int(vm, 0);
+	return obj;
+}
+
+static var_t* json_read_number(vm_t* vm, const char* s) {
+	const char* p = (s[0] == '-' || s[0] == '+') ? s + 1 : s;
+	if(p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		int i = atoi_base(p + 2, 16);
+		return var_new_int(vm, s[0] == '-' ? -i : i);
 	}
-	else if (l->tk==LEX_R_NULL) {
-		lex_js_chkread(l, LEX_R_NULL);
+	if(strchr(s, '.') != NULL || strchr(s, 'e') != NULL || strchr(s, 'E') != NULL)
+		return var_new_float(vm, atof(s));
+	return var_new_int(vm, atoi(s));
+}
+
+static var_t* json_read_value(vm_t* vm, json_in_t* in) {
+	json_skip_spaces(in);
+	int c = json_peek(in);
+	if(c == '{')
+		return json_read_object(vm, in);
+	if(c == '[')
+		return json_read_array(vm, in);
+	if(c == '"' || c == '\'') {
+		json_read_str(in);
+		return var_new_str2(vm, in->tok.cstr, in->tok.len);
+	}
+
+	json_read_word(in);
+	const char* s = in->tok.cstr;
+	if(in->tok.len == 0) {
+		in->err = true;
 		return var_new(vm);
 	}
-	else if (l->tk==LEX_R_UNDEFINED) {
-		lex_js_chkread(l, LEX_R_UNDEFINED);
+	if((s[0] >= '0' && s[0] <= '9') || s[0] == '-' || s[0] == '+' || s[0] == '.')
+		return json_read_number(vm, s);
+	if(strcmp(s, "true") == 0)
+		return var_new_int(vm, 1);
+	if(strcmp(s, "false") == 0)
+		return var_new_int(vm, 0);
+	return var_new(vm); //null, undefined and anything unknown.
+}
+
+static var_t* json_read(vm_t* vm, json_in_t* in) {
+	in->err = false;
+	in->tok.cstr = NULL;
+	in->tok.max = 0;
+	in->tok.len = 0;
+	str_reset(&in->tok);
+
+	var_t* ret = json_read_value(vm, in);
+	free(in->tok.cstr);
+	if(in->err) {
+		var_unref(ret); //drop the partial tree.
 		return var_new(vm);
 	}
-	else if (l->tk==LEX_INT) {
-		int i = atoi(l->tk_str->cstr);
-		lex_js_chkread(l, LEX_INT);
-		return var_new_int(vm, i);
+	return ret;
+}
+
+var_t* json_parse(vm_t* vm, const char* str) {
+	json_in_t in;
+	in.fd = -1;
+	in.chunk = NULL;
+	in.p = str;
+	in.pos = 0;
+	in.size = (uint32_t)strlen(str);
+	return json_read(vm, &in);
+}
+
+var_t* json_parse_fd(vm_t* vm, int fd) {
+	json_in_t in;
+	in.fd = fd;
+	in.chunk = (char*)malloc(JSON_CHUNK);
+	in.p = in.chunk;
+	in.pos = 0;
+	in.size = 0;
+	var_t* ret = json_read(vm, &in);
+	free(in.chunk);
+	return ret;
+}
+
+/** json writer.-----------------------------
+output goes to a str_t in bulk, or to an fd through JSON_OUT_BUF bytes of
+buffer. objects on the way down from the root are kept in path, an object
+met again on it is a cycle and written as {}.
+*/
+
+#define JSON_OUT_BUF 4096
+#define JSON_ARRAY_SHOW_MAX 100
+
+static const char _json_spaces[] = "                                                                ";
+
+typedef struct {
+	str_t* str; //NULL for writing to fd
+	int fd;
+	bool strict; //escaped strings, all array items, for JSON.stringify/save.
+	bool err;
+	m_array_t path;
+	uint32_t size;
+	char* buf;
+} json_out_t;
+
+static void json_write_raw(json_out_t* out, const char* s, uint32_t len) {
+	uint32_t done = 0;
+	while(done < len && !out->err) {
+		int n = write(out->fd, s + done, len - done);
+		if(n < 0 && errno == EAGAIN)
+			continue;
+		if(n <= 0)
+			out->err = true;
+		else
+			done += n;
 	}
-	else if (l->tk==LEX_FLOAT) {
-		float f = atof(l->tk_str->cstr);
-		lex_js_chkread(l, LEX_FLOAT);
-		return var_new_float(vm, f);
+}
+
+static void json_flush(json_out_t* out) {
+	json_write_raw(out, out->buf, out->size);
+	out->size = 0;
+}
+
+static void json_put(json_out_t* out, const char* s, uint32_t len) {
+	if(out->str != NULL) {
+		str_addn(out->str, s, len);
+		return;
 	}
-	else if (l->tk==LEX_STR) {
-		str_t* s = str_new(l->tk_str->cstr);
-		lex_js_chkread(l, LEX_STR);
-		var_t* ret = var_new_str(vm, s->cstr);
-		str_free(s);
-		return ret;
+
+	if(out->size + len > JSON_OUT_BUF) {
+		json_flush(out);
+		if(len >= JSON_OUT_BUF) { //too big to gather, write it straight.
+			json_write_raw(out, s, len);
+			return;
+		}
 	}
-	else if(l->tk==LEX_R_FUNCTION) {
-		lex_js_chkread(l, LEX_R_FUNCTION);
-		//TODO
-		//_err("Error: Can not parse json function item!\n");
-		return var_new(vm);
+	memcpy(out->buf + out->size, s, len);
+	out->size += len;
+}
+
+static inline void json_puts(json_out_t* out, const char* s) {
+	json_put(out, s, (uint32_t)strlen(s));
+}
+
+//(level+1)*2 spaces from the precomputed run.
+static void json_indent(json_out_t* out, int level) {
+	uint32_t n = (uint32_t)(level + 1) * 2;
+	while(n > 0) {
+		uint32_t k = n < sizeof(_json_spaces) - 1 ? n : sizeof(_json_spaces) - 1;
+		json_put(out, _json_spaces, k);
+		n -= k;
 	}
-	else if (l->tk=='[') {
-		/* JSON-style array */
-		var_t* arr = var_new_array(vm);
-		lex_js_chkread(l, '[');
-		while (l->tk != ']') {
-			var_t* v = json_parse_factor(vm, l);
-			var_add(arr, "", v);
-			if (l->tk != ']') 
-				lex_js_chkread(l, ',');
-		}
-		lex_js_chkread(l, ']');
-		return arr;
+}
+
+static void json_put_str(json_out_t* out, const char* s) {
+	json_put(out, "\"", 1);
+	if(!out->strict) {
+		json_puts(out, s);
+		json_put(out, "\"", 1);
+		return;
 	}
-	else if (l->tk=='{') {
-		lex_js_chkread(l, '{');
-		var_t* obj = var_new_obj(vm, NULL, NULL);
-		while(l->tk != '}') {
-			str_t* id = str_new(l->tk_str->cstr);
-			if(l->tk == LEX_STR)
-				lex_js_chkread(l, LEX_STR);
-			else
-				lex_js_chkread(l, LEX_ID);
 
-			lex_js_chkread(l, ':');
-			var_t* v = json_parse_factor(vm, l);
-			var_add(obj, id->cstr, v);
-			str_free(id);
-			if(l->tk != '}')
-				lex_js_chkread(l, ',');
+	const char* start = s;
+	for(; *s != 0; s++) {
+		const char* esc = NULL;
+		switch(*s) {
+			case '\\': esc = "\\\\"; break;
+			case '"':  esc = "\\\""; break;
+			case '\n': esc = "\\n"; break;
+			case '\r': esc = "\\r"; break;
+			case '\t': esc = "\\t"; break;
+			case '\b': esc = "\\b"; break;
+			case '\f': esc = "\\f"; break;
 		}
-		lex_js_chkread(l, '}');
-		return obj;
+		if(esc == NULL)
+			continue;
+		json_put(out, start, s - start);
+		json_puts(out, esc);
+		start = s + 1;
 	}
-	return var_new(vm);
+	json_put(out, start, s - start);
+	json_put(out, "\"", 1);
 }
 
-var_t* json_parse(vm_t* vm, const char* str) {
-	lex_t lex;
-	lex_init(&lex, str);
-	lex_js_get_next_token(&lex);
+static void json_write(json_out_t* out, var_t* var, int level) {
+	if(var == NULL || (out->strict && (var->type == V_UNDEF || var->is_func))) {
+		json_puts(out, out->strict ? "null" : "undefined");
+		return;
+	}
+
+	if(var->type == V_OBJECT) {
+		uint32_t i;
+		for(i=0; i<out->path.size; ++i) {
+			if(out->path.items[i] == var) { //cycle
+				json_puts(out, "{}");
+				return;
+			}
+		}
+	}
+
+	if (var->is_array) {
+		array_add(&out->path, var);
+		json_put(out, "[", 1);
+		uint32_t len = var_array_size(var);
+		if (!out->strict && len > JSON_ARRAY_SHOW_MAX)
+			len = JSON_ARRAY_SHOW_MAX; // we don't want to get stuck here!
 
-	var_t* ret = json_parse_factor(vm, &lex);
-	lex_release(&lex);
+		uint32_t i;
+		for (i=0;i<len;i++) {
+			if (i > 0)
+				json_put(out, ", ", 2);
+			json_write(out, var_array_get(var, i)->var, level);
+		}
+		json_put(out, "]", 1);
+		out->path.size--;
+	}
+	else if (var->is_func) {
+		json_puts(out, "function (");
+		// get list of parameters
+		if(var->value != NULL) {
+			func_t* func = var_get_func(var);
+			uint32_t i;
+			for(i=0; i<func->args.size; ++i) {
+				if(i > 0)
+					json_put(out, ", ", 2);
+				json_puts(out, (const char*)func->args.items[i]);
+			}
+		}
+		// add function body
+		json_puts(out, ") {}");
+	}
+	else if (var->type == V_OBJECT) {
+		array_add(&out->path, var);
+		// children - handle with bracketed list
+		uint32_t sz = var->children.size;
+		if(sz > 0)
+			json_put(out, "{\n", 2);
+		else
+			json_put(out, "{", 1);
+
+		uint32_t i;
+		bool had = false;
+		for(i=0; i<sz; ++i) {
+			node_t* n = var_get(var, i);
+			if(strcmp(n->name, "prototype") == 0)
+				continue;
+			if(had)
+				json_put(out, ",\n", 2);
+			had = true;
+			json_indent(out, level);
+			json_put(out, "\"", 1);
+			json_puts(out, n->name);
+			json_put(out, "\": ", 3);
+			json_write(out, n->var, level+1);
+		}
+		if(sz > 0)
+			json_put(out, "\n", 1);
+		json_indent(out, level - 1);
+		json_put(out, "}", 1);
+		out->path.size--;
+	}
+	else if(var->type == V_STRING) {
+		json_put_str(out, var_get_str(var));
+	}
+	else {
+		// no children... just write value directly
+		str_t* s = str_new("");
+		var_to_str(var, s);
+		json_put(out, s->cstr, s->len);
+		str_free(s);
+	}
+}
+
+static void json_out_init(json_out_t* out, str_t* str, int fd, bool strict) {
+	out->str = str;
+	out->fd = fd;
+	out->strict = strict;
+	out->err = false;
+	out->size = 0;
+	out->buf = NULL;
+	array_init(&out->path);
+}
+
+static void json_to_str(var_t* var, str_t* ret, bool strict) {
+	json_out_t out;
+	str_reset(ret);
+	json_out_init(&out, ret, -1, strict);
+	json_write(&out, var, 0);
+	array_clean(&out.path, NULL);
+}
+
+void var_to_json_str(var_t* var, str_t* ret, int level) {
+	(void)level;
+	json_to_str(var, ret, false);
+}
+
+void json_stringify(var_t* var, str_t* ret) {
+	json_to_str(var, ret, true);
+}
+
+bool json_write_fd(var_t* var, int fd) {
+	json_out_t out;
+	json_out_init(&out, NULL, fd, true);
+	out.buf = (char*)malloc(JSON_OUT_BUF);
+	json_write(&out, var, 0);
+	json_flush(&out);
+	array_clean(&out.path, NULL);
+	free(out.buf);
+	return !out.err;
+}
+
+/** JSON natives.-----------------------------*/
+
+static var_t* native_json_parse(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	return json_parse(vm, get_str(env, "str"));
+}
+
+static var_t* native_json_stringify(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	str_t* s = str_new("");
+	json_stringify(get_obj(env, "value"), s);
+	var_t* ret = var_new_str2(vm, s->cstr, s->len);
+	str_free(s);
 	return ret;
 }
 
+static var_t* native_json_load(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	int fd = open(get_str(env, "fname"), O_RDONLY);
+	if(fd < 0)
+		return var_new(vm);
+	var_t* ret = json_parse_fd(vm, fd);
+	close(fd);
+	return ret;
+}
+
+static var_t* native_json_save(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	const char* fname = get_str(env, "fname");
+	unlink(fname);
+	int fd = open(fname, O_WRONLY | O_CREAT);
+	if(fd < 0)
+		return var_new_bool(vm, false);
+	bool ret = json_write_fd(get_obj(env, "value"), fd);
+	close(fd);
+	return var_new_bool(vm, ret);
+}
+
+void json_reg_natives(vm_t* vm) {
+	vm_reg_static(vm, "JSON", "parse(str)", native_json_parse, NULL);
+	vm_reg_static(vm, "JSON", "stringify(value)", native_json_stringify, NULL);
+	vm_reg_static(vm, "JSON", "load(fname)", native_json_load, NULL);
+	vm_reg_static(vm, "JSON", "save(fname, value)", native_json_save, NULL);
+}
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
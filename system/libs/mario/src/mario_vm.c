@@ -3,6 +3,7 @@ very tiny script engine in single file.
 */
 
 #include "mario/mario_vm.h"
+#include "mario/mario_json.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -13,16 +14,209 @@ extern "C" {
 
 load_m_func_t _load_m_func = NULL;
 
+#define CLOSURE "__closure"
+
+/*vm_run dispatches through a label table with gcc, define MARIO_NO_COMPUTED_GOTO for plain switch*/
+#if defined(__GNUC__) && !defined(MARIO_NO_COMPUTED_GOTO)
+#define MARIO_COMPUTED_GOTO
+#endif
+
+/*perf counters of vm->stats, only built with MARIO_STATS for the host bench*/
+#ifdef MARIO_STATS
+#define STAT(vm, expr) ((vm)->stats.expr)
+#else
+#define STAT(vm, expr)
+#endif
+
+/** interned names-----------------------------
+every member name is interned once per vm, so nodes are matched by pointer.
+a version word is kept in front of each name, bumped when a var holding
+that name enters or leaves the scope chain, for inline cache checking.
+*/
+
+#define NAME_VER(name) (*(uint32_t*)((name) - sizeof(uint32_t)))
+
+static inline uint32_t name_hash(const char* s) {
+	uint32_t h = 2166136261u;
+	while(*s != 0) {
+		h ^= (uint8_t)(*s++);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void vm_names_grow(vm_t* vm) {
+	uint32_t max = vm->names_max == 0 ? 256 : vm->names_max*2;
+	const char** names = (const char**)malloc(max * sizeof(const char*));
+	memset(names, 0, max * sizeof(const char*));
+
+	uint32_t i;
+	for(i=0; i<vm->names_max; i++) {
+		const char* n = vm->names[i];
+		if(n == NULL)
+			continue;
+		uint32_t h = name_hash(n) & (max-1);
+		while(names[h] != NULL)
+			h = (h+1) & (max-1);
+		names[h] = n;
+	}
+
+	if(vm->names != NULL)
+		free(vm->names);
+	vm->names = names;
+	vm->names_max = max;
+}
+
+const char* vm_name(vm_t* vm, const char* s, bool create) {
+	if(vm->names_max == 0) {
+		if(!create)
+			return NULL;
+		vm_names_grow(vm);
+	}
+
+	uint32_t mask = vm->names_max - 1;
+	uint32_t h = name_hash(s) & mask;
+	const char* n;
+	while((n = vm->names[h]) != NULL) {
+		if(n == s || strcmp(n, s) == 0)
+			return n;
+		h = (h+1) & mask;
+	}
+
+	if(!create)
+		return NULL;
+
+	uint32_t len = (uint32_t)strlen(s);
+	char* p = (char*)malloc(sizeof(uint32_t) + len + 1);
+	*(uint32_t*)p = 0;
+	p += sizeof(uint32_t);
+	memcpy(p, s, len+1);
+
+	vm->names[h] = p;
+	vm->names_num++;
+	if(vm->names_num*4 >= vm->names_max*3)
+		vm_names_grow(vm);
+	return p;
+}
+
+static void vm_names_free(vm_t* vm) {
+	uint32_t i;
+	for(i=0; i<vm->names_max; i++) {
+		const char* n = vm->names[i];
+		if(n != NULL)
+			free((char*)n - sizeof(uint32_t));
+	}
+	if(vm->names != NULL)
+		free(vm->names);
+	if(vm->bc_names != NULL)
+		free(vm->bc_names);
+	vm->names = vm->bc_names = NULL;
+	vm->names_num = vm->names_max = vm->bc_names_num = 0;
+}
+
+//interned name of bytecode string table item.
+static inline const char* vm_bc_name(vm_t* vm, uint32_t index) {
+	if(index < vm->bc_names_num && vm->bc_names[index] != NULL)
+		return vm->bc_names[index];
+
+	const char* n = vm_name(vm, bc_getstr(&vm->bc, index), true);
+	if(index >= vm->bc.str_table.size)
+		return n;
+
+	if(index >= vm->bc_names_num) {
+		uint32_t num = vm->bc.str_table.size;
+		const char** names = (const char**)malloc(num * sizeof(const char*));
+		memset(names, 0, num * sizeof(const char*));
+		if(vm->bc_names != NULL) {
+			memcpy(names, vm->bc_names, vm->bc_names_num * sizeof(const char*));
+			free(vm->bc_names);
+		}
+		vm->bc_names = names;
+		vm->bc_names_num = num;
+	}
+	vm->bc_names[index] = n;
+	return n;
+}
+
+//"this", "prototype" and closure hold other vars, changing them may change how any name resolves.
+static inline bool name_is_holder(vm_t* vm, const char* name) {
+	return (name == vm->name_this || name == vm->name_prototype || name == vm->name_closure);
+}
+
+//a name was added to or removed from a reachable var, drop cached resolving.
+static inline void name_touch(vm_t* vm, const char* name) {
+	if(name[0] == 0)
+		return;
+	if(name_is_holder(vm, name))
+		vm->ic_epoch++;
+	else
+		NAME_VER(name)++;
+}
+
+static inline void var_touch_all(var_t* var) {
+	uint32_t i;
+	for(i=0; i<var->children.size; i++) {
+		node_t* node = (node_t*)var->children.items[i];
+		if(node != NULL)
+			name_touch(var->vm, node->name);
+	}
+}
+
+/** hashed members-----------------------------*/
+
+#define VAR_INDEX_MIN 8
+
+typedef struct st_var_index {
+	uint32_t mask;
+	uint32_t num;
+	node_t* slots[];
+} var_index_t;
+
+static inline uint32_t var_index_slot(const char* name, uint32_t mask) {
+	uint32_t h = (uint32_t)(uintptr_t)name;
+	h = (h ^ (h >> 5)) * 0x9E3779B1u;
+	return (h ^ (h >> 15)) & mask;
+}
+
+static inline void var_index_put(var_index_t* index, node_t* node) {
+	uint32_t h = var_index_slot(node->name, index->mask);
+	while(index->slots[h] != NULL)
+		h = (h+1) & index->mask;
+	index->slots[h] = node;
+	index->num++;
+}
+
+static void var_index_build(var_t* var) {
+	uint32_t max = 32;
+	while(max < var->children.size*2)
+		max <<= 1;
+
+	var_index_t* index = (var_index_t*)malloc(sizeof(var_index_t) + max*sizeof(node_t*));
+	memset(index, 0, sizeof(var_index_t) + max*sizeof(node_t*));
+	index->mask = max - 1;
+
+	uint32_t i;
+	for(i=0; i<var->children.size; i++) {
+		node_t* node = (node_t*)var->children.items[i];
+		if(node != NULL && node->name[0] != 0)
+			var_index_put(index, node);
+	}
+
+	if(var->index != NULL)
+		free(var->index);
+	var->index = index;
+}
+
 /** vm var-----------------------------*/
 
+static inline void gc_write(var_t* owner, var_t* v);
+
 node_t* node_new(vm_t* vm, const char* name) {
 	node_t* node = (node_t*)malloc(sizeof(node_t));
 	memset(node, 0, sizeof(node_t));
 
 	node->magic = 1;
-	uint32_t len = (uint32_t)strlen(name);
-	node->name = (char*)malloc(len+1);
-	memcpy(node->name, name, len+1);
+	node->name = vm_name(vm, name, true);
 	node->var = var_new(vm);	
 	return node;
 }
@@ -38,13 +232,15 @@ void node_free(void* p) {
 	if(node == NULL)
 		return;
 
-	free(node->name);
 	if(!var_empty(node->var)) {
 		var_unref(node->var);
 	}
 	free(node);
 }
 
+//value is not the inline storage.
+#define var_value_owned(var) ((var)->value != NULL && (var)->value != (void*)&(var)->num)
+
 static inline bool node_empty(node_t* node) {
 	if(node == NULL || var_empty(node->var))
 		return true;
@@ -76,50 +272,64 @@ inline var_t* node_replace(node_t* node, var_t* v) {
 	var_t* old = node->var;
 	node->var = var_ref(var_clone(v));
 	//node->var = var_ref((v));
+	gc_write(node->owner, node->var);
+	if(name_is_holder(v->vm, node->name))
+		v->vm->ic_epoch++;
 	var_unref(old);
 	return v;
 }
 
 inline void var_remove_all(var_t* var) {
+	var_touch_all(var);
+	if(var->index != NULL) {
+		free(var->index);
+		var->index = NULL;
+	}
 	/*free children*/
 	array_clean(&var->children, node_free);
 }
 
+//name must be interned by vm_name.
 static inline node_t* var_find_raw(var_t* var, const char*name) {
 	if(var_empty(var))
 		return NULL;
 
+	if(var->index != NULL) {
+		var_index_t* index = var->index;
+		uint32_t h = var_index_slot(name, index->mask);
+		node_t* node;
+		while((node = index->slots[h]) != NULL) {
+			if(node->name == name)
+				return node;
+			h = (h+1) & index->mask;
+		}
+		return NULL;
+	}
+
 	uint32_t i;
 	for(i=0; i<var->children.size; i++) {
 		node_t* node = (node_t*)var->children.items[i];
-		if(node != NULL && node->name != NULL) {
-			if(strcmp(node->name, name) == 0) {
-				return node;
-			}
-		}
+		if(node != NULL && node->name == name)
+			return node;
 	}
 	return NULL;
 }
 
-node_t* var_add(var_t* var, const char* name, var_t* add) {
-	node_t* node = NULL;
-
-	if(name[0] != 0) 
-		node = var_find_raw(var, name);
-
-	if(node == NULL) {
-		node = node_new(var->vm, name);
-		var_ref(node->var);
-		array_add(&var->children, node);
-	}
-
-	if(add != NULL)
-		node_replace(node, add);
-
+static inline node_t* var_find_name(var_t* var, const char*name) {
+	node_t* node = var_find_raw(var, name);
+	if(node_empty(node))
+		return NULL;
 	return node;
 }
 
-node_t* var_add_head(var_t* var, const char* name, var_t* add) {
+static inline var_t* var_find_name_var(var_t* var, const char*name) {
+	node_t* node = var_find_name(var, name);
+	if(node == NULL)
+		return NULL;
+	return node->var;
+}
+
+static node_t* var_add_name(var_t* var, const char* name, var_t* add) {
 	node_t* node = NULL;
 
 	if(name[0] != 0) 
@@ -127,8 +337,24 @@ node_t* var_add_head(var_t* var, const char* name, var_t* add) {
 
 	if(node == NULL) {
 		node = node_new(var->vm, name);
+		node->owner = var;
 		var_ref(node->var);
+		gc_write(var, node->var); //placeholder may be turned into an object in place.
 		array_add(&var->children, node);
+
+		if(name[0] != 0) {
+			if(var->refs > 0) //a fresh var is not reachable yet.
+				name_touch(var->vm, name);
+
+			if(var->index != NULL) {
+				if((var->index->num+1)*4 >= (var->index->mask+1)*3)
+					var_index_build(var);
+				else
+					var_index_put(var->index, node);
+			}
+			else if(var->children.size > VAR_INDEX_MIN)
+				var_index_build(var);
+		}
 	}
 
 	if(add != NULL)
@@ -137,11 +363,21 @@ node_t* var_add_head(var_t* var, const char* name, var_t* add) {
 	return node;
 }
 
+node_t* var_add(var_t* var, const char* name, var_t* add) {
+	return var_add_name(var, vm_name(var->vm, name, true), add);
+}
+
+node_t* var_add_head(var_t* var, const char* name, var_t* add) {
+	return var_add_name(var, vm_name(var->vm, name, true), add);
+}
+
 inline node_t* var_find(var_t* var, const char*name) {
-	node_t* node = var_find_raw(var, name);
-	if(node_empty(node))
+	if(var_empty(var))
 		return NULL;
-	return node;
+	name = vm_name(var->vm, name, false);
+	if(name == NULL) //never interned, no var has it.
+		return NULL;
+	return var_find_name(var, name);
 }
 
 inline var_t* var_find_var(var_t* var, const char*name) {
@@ -159,6 +395,12 @@ inline node_t* var_find_create(var_t* var, const char*name) {
 	return n;
 }
 
+static inline var_t* var_array_var(var_t* var) {
+	if(var_empty(var))
+		return NULL;
+	return var_find_name_var(var, var->vm->name_array);
+}
+
 node_t* var_get(var_t* var, int32_t index) {
 	node_t* node = (node_t*)array_get(&var->children, index);
 	if(node_empty(node))
@@ -167,7 +409,7 @@ node_t* var_get(var_t* var, int32_t index) {
 }
 
 node_t* var_array_get(var_t* var, int32_t index) {
-	var_t* arr_var = var_find_var(var, "_ARRAY_");
+	var_t* arr_var = var_array_var(var);
 	if(arr_var == NULL)
 		return NULL;
 
@@ -196,24 +438,37 @@ node_t* var_array_set(var_t* var, int32_t index, var_t* set_var) {
 	return node;
 }
 
+/*element nodes are unnamed, so it's appended without looking up or
+a placeholder var to be replaced.*/
 node_t* var_array_add(var_t* var, var_t* add_var) {
-	node_t* ret = NULL;
-	var_t* arr_var = var_find_var(var, "_ARRAY_");
-	if(arr_var != NULL)
-		ret = var_add(arr_var, "", add_var);
-	return ret;
+	var_t* arr_var = var_array_var(var);
+	if(arr_var == NULL)
+		return NULL;
+	if(add_var == NULL)
+		return var_add(arr_var, "", NULL);
+
+	vm_t* vm = var->vm;
+	node_t* node = (node_t*)malloc(sizeof(node_t));
+	memset(node, 0, sizeof(node_t));
+	node->magic = 1;
+	node->name = vm_name(vm, "", true);
+	node->var = var_ref(var_clone(add_var));
+	node->owner = arr_var;
+	gc_write(arr_var, node->var);
+	array_add(&arr_var->children, node);
+	return node;
 }
 
 node_t* var_array_add_head(var_t* var, var_t* add_var) {
 	node_t* ret = NULL;
-	var_t* arr_var = var_find_var(var, "_ARRAY_");
+	var_t* arr_var = var_array_var(var);
 	if(arr_var != NULL)
 		ret = var_add_head(arr_var, "", add_var);
 	return ret;
 }
 
 uint32_t var_array_size(var_t* var) {
-	var_t* arr_var = var_find_var(var, "_ARRAY_");
+	var_t* arr_var = var_array_var(var);
 	if(arr_var == NULL)
 		return 0;
 	return arr_var->children.size;
@@ -234,14 +489,17 @@ void var_array_reverse(var_t* arr) {
 }
 
 node_t* var_array_remove(var_t* var, int32_t index) {
-	var_t* arr_var = var_find_var(var, "_ARRAY_");
+	var_t* arr_var = var_array_var(var);
 	if(arr_var == NULL)
 		return NULL;
-	return (node_t*)array_remove(&arr_var->children, index);
+	node_t* node = (node_t*)array_remove(&arr_var->children, index);
+	if(node != NULL)
+		node->owner = NULL;
+	return node;
 }
 
 void var_array_del(var_t* var, int32_t index) {
-	var_t* arr_var = var_find_var(var, "_ARRAY_");
+	var_t* arr_var = var_array_var(var);
 	if(arr_var == NULL)
 		return;
 	array_del(&arr_var->children, index, node_free);
@@ -258,13 +516,13 @@ inline void var_clean(var_t* var) {
 		var_remove_all(var);	
 
 	/*free value*/
-	if(var->value != NULL) {
+	if(var_value_owned(var)) {
 		if(var->free_func != NULL) 
 			var->free_func(var->value);
 		else
 			free(var->value);
-		var->value = NULL;
 	}
+	var->value = NULL;
 
 	if(var->on_destroy != NULL) {
 		var->on_destroy(var);
@@ -288,18 +546,70 @@ static inline void add_to_free(var_t* var) {
 	vm->free_vars_num++;
 }
 
-static inline void add_to_gc(var_t* var) {
-	vm_t* vm = var->vm;
-	var->prev = vm->gc_vars_tail;
-	if(vm->gc_vars_tail != NULL)
-		vm->gc_vars_tail->next = var;
+//scope of vm runing
+typedef struct st_scope {
+	struct st_scope* prev;
+	var_t* var;
+	PC pc_start; // continue anchor for loop
+	PC pc; // try cache anchor , or break anchor for loop
+	uint32_t is_func: 8;
+	uint32_t is_block: 8;
+	uint32_t is_try: 8;
+	uint32_t is_loop: 8;
+	//continue and break anchor for loop(while/for)
+	struct st_scope* func; // scope of the running function
+	node_t** slots; // frame slots of function scope, LOAD_LOCAL/LOAD_UPVAL
+	PC slots_pc; // pc of first LOCAL/UPVAL, slot names
+} scope_t;
+
+static inline gc_list_t* gc_list(vm_t* vm, uint32_t status) {
+	return status == V_ST_GC_OLD ? &vm->gc_old : &vm->gc_young;
+}
+
+static inline void gc_list_add(gc_list_t* list, var_t* var) {
+	var->prev = list->tail;
+	if(list->tail != NULL)
+		list->tail->next = var;
 	else {
-		vm->gc_vars = var;
+		list->head = var;
 	}
 	var->next = NULL;
-	vm->gc_vars_tail = var;
-	var->status = V_ST_GC;
-	vm->gc_vars_num++;
+	list->tail = var;
+	list->num++;
+}
+
+static inline void gc_list_remove(gc_list_t* list, var_t* var) {
+	if(var->vm->gc_cursor == var) //removed while sweeping
+		var->vm->gc_cursor = var->next;
+	if(var->vm->gc_sealed == var) //sealed part of nursery shrinks
+		var->vm->gc_sealed = var->prev;
+
+	if(var->prev != NULL)
+		var->prev->next = var->next;
+	else
+		list->head = var->next;
+
+	if(var->next != NULL)
+		var->next->prev = var->prev;
+	else
+		list->tail = var->prev;
+
+	var->prev = var->next = NULL;
+	if(list->num > 0)
+		list->num--;
+}
+
+/*vars unrefed but still referenced are kept in the young list(nursery) for rooted checking,
+tenured ones go to the old list and are only checked by major cycles.*/
+static inline void add_to_gc(var_t* var) {
+	if(var->gc_old) {
+		gc_list_add(&var->vm->gc_old, var);
+		var->status = V_ST_GC_OLD;
+	}
+	else {
+		gc_list_add(&var->vm->gc_young, var);
+		var->status = V_ST_GC;
+	}
 }
 
 static inline var_t* get_from_free(vm_t* vm) {
@@ -315,54 +625,36 @@ static inline var_t* get_from_free(vm_t* vm) {
 }
 
 static inline void remove_from_gc(var_t* var) {
-	vm_t* vm = var->vm;
-	if(var->prev != NULL)
-		var->prev->next = var->next;
-	else
-		vm->gc_vars = var->next;
-
-	if(var->next != NULL)
-		var->next->prev = var->prev;
-	else
-		vm->gc_vars_tail = var->prev;
-
-	var->prev = var->next = NULL;
-	if(var->vm->gc_vars_num > 0)
-		var->vm->gc_vars_num--;
+	gc_list_remove(gc_list(var->vm, var->status), var);
 }
 
-static inline void gc_mark(var_t* var, bool mark) {
- 	if(var_empty(var))
- 		return;
-
- 	var->gc_marking = true;
- 	uint32_t i;
- 	for(i=0; i<var->children.size; i++) {
- 		node_t* node = (node_t*)var->children.items[i];
- 		if(!node_empty(node)) {
- 			node->var->gc_marked = mark;
-			if(node->var->gc_marking == false) {
-				gc_mark(node->var, mark);
-			}
- 		}
- 	}
- 	var->gc_marking = false;
+/*mark var and queue it for scanning children, no recursion.
+minor cycles stop at tenured vars, young ones under them are remembered by gc_write.*/
+static inline void gc_shade(vm_t* vm, var_t* var) {
+	if(var_empty(var) || var->gc_marked || var->is_imm)
+		return;
+	if(var->gc_old && !vm->gc_major)
+		return;
+	var->gc_marked = true;
+	if(vm->gc_marks_num >= vm->gc_marks_max) { //may outgrow m_array_t, keep own buffer.
+		uint32_t max = vm->gc_marks_max == 0 ? 256 : vm->gc_marks_max * 2;
+		vm->gc_marks = (var_t**)realloc_raw(vm->gc_marks, vm->gc_marks_max*sizeof(var_t*), max*sizeof(var_t*));
+		vm->gc_marks_max = max;
+	}
+	vm->gc_marks[vm->gc_marks_num++] = var;
 }
 
-static inline void gc_mark_cache(vm_t* vm, bool mark) {
+static inline void gc_mark_cache(vm_t* vm) {
 #ifndef MARIO_CACHE
 	(void)vm;
-	(void)mark;
 #else
 	uint32_t i;
-	for(i=0; i<vm->var_cache_used; ++i) {
-		var_t* v = vm->var_cache[i];
-		gc_mark(v, mark);
-	}
+	for(i=0; i<vm->var_cache_used; ++i)
+		gc_shade(vm, vm->var_cache[i]);
 #endif
 }
 
-static inline void gc_mark_stack(vm_t* vm, bool mark) {
+static inline void gc_mark_stack(vm_t* vm) {
 	int i = vm->stack_top-1;
 	while(i>=0) {
 		void *p = vm->stack[i];
@@ -381,24 +673,70 @@ static inline void gc_mark_stack(vm_t* vm, bool mark) {
 				v = node->var;
 		}
 
-		gc_mark(v, mark);
+		gc_shade(vm, v);
 	}
 }
 
-static inline void gc_mark_isignal(vm_t* vm, bool mark) {
+static inline void gc_mark_isignal(vm_t* vm) {
 #ifndef MARIO_THREAD
 	(void)vm;
-	(void)mark;
 #else
 	isignal_t* sig = vm->isignal_head;
 	while(sig != NULL) {
-		gc_mark(sig->handle_func, mark);
-		gc_mark(sig->obj, mark);
+		gc_shade(vm, sig->handle_func);
+		gc_shade(vm, sig->obj);
 		sig = sig->next;
 	}
 #endif
 }
 
+static inline void gc_mark_scopes(vm_t* vm) {
+	if(vm->scopes == NULL)
+		return;
+	uint32_t i;
+	for(i=0; i<vm->scopes->size; i++) {
+		scope_t* sc = (scope_t*)vm->scopes->items[i];
+		gc_shade(vm, sc->var);
+	}
+}
+
+static inline void gc_mark_roots(vm_t* vm) {
+	gc_shade(vm, vm->root); //mark all rooted vars
+	gc_mark_scopes(vm); //mark all scoped vars
+	gc_mark_stack(vm); //mark all stacked vars
+	gc_mark_isignal(vm); //mark all interrupt signal vars
+	gc_mark_cache(vm); //mark all cached vars
+}
+
+/*scan children of at most n marked vars, return true if nothing left.*/
+static inline bool gc_mark_step(vm_t* vm, uint32_t n) {
+	while(vm->gc_scan < vm->gc_marks_num) {
+		if(n == 0)
+			return false;
+		n--;
+
+		var_t* var = vm->gc_marks[vm->gc_scan++];
+		if(var_empty(var)) //freed by refs after marked.
+			continue;
+		uint32_t i;
+		for(i=0; i<var->children.size; i++) {
+			node_t* node = (node_t*)var->children.items[i];
+			if(!node_empty(node))
+				gc_shade(vm, node->var);
+		}
+	}
+	return true;
+}
+
+/*write barrier of v put in children of owner. a young var under a tenured one(or a
+marked one, tenured when cleared) is shaded, so it's remembered till scanned by
+the running cycle or the next one. shaded vars are scanned before sweeping
+or clearing, so a tenured var never misses young children.*/
+static inline void gc_write(var_t* owner, var_t* v) {
+	if(owner != NULL && !v->gc_old && (owner->gc_old || owner->gc_marked))
+		gc_shade(v->vm, v);
+}
+
 static inline void var_free(void* p) {
 	var_t* var = (var_t*)p;
 	if(var_empty(var))
@@ -406,29 +744,28 @@ static inline void var_free(void* p) {
 
 	vm_t* vm = var->vm;
 	uint32_t status = var->status; //store status of variable
+	if(status == V_ST_GC || status == V_ST_GC_OLD) //if in gc lists
+		remove_from_gc(var);
 	//clean var.
 	var_clean(var);
 	var->type = V_UNDEF;
 	var->vm = vm;
 
-	if(status == V_ST_GC) { //if in gc_vars list
-		if(vm->is_doing_gc) { // if is doing gc, change status to GC_FREE for moving to free_vars list later.
-			var->status = V_ST_GC_FREE;
-		}
-		else { //not doing gc, move to free_vars list immediately.
-			remove_from_gc(var);
-			add_to_free(var);
-		}
-	}
-	else if(status != V_ST_FREE) {
+	if(status != V_ST_FREE)
 		add_to_free(var);
-	}
 }
 
 inline var_t* var_ref(var_t* var) {
+	/*a referenced var may be moved under a scanned one while marking,
+	shade it. fresh vars(refs 0) are unreachable to the cycle.
+	while sweeping, a revived var is shaded too, its children are scanned
+	by the next step before sweeping on.*/
+	if(var->refs > 0 && (var->vm->gc_phase == GC_MARK || var->vm->gc_phase == GC_SWEEP))
+		gc_shade(var->vm, var);
+
 	++var->refs;
-	if(var->status == V_ST_GC) {
-		/*remove from vm->gc_vars list.*/
+	if(var->status == V_ST_GC || var->status == V_ST_GC_OLD) {
+		/*remove from vm gc lists.*/
 		remove_from_gc(var);
 		var->status = V_ST_REF;
 	}
@@ -438,6 +775,8 @@ inline var_t* var_ref(var_t* var) {
 inline void var_unref(var_t* var) {
 	if(var_empty(var))
 		return;
+	if(var->is_imm && var->refs <= 1) //pinned by vm, temporaries may be unrefed without ref.
+		return;
 
 	if(var->refs > 0)
 		--var->refs;
@@ -447,44 +786,112 @@ inline void var_unref(var_t* var) {
 		free it immediately.*/
 		var_free(var);
 	}
-	else if(var->status == V_ST_REF) { 
+	else if(var->status == V_ST_REF && !var->is_imm) { 
 		/*referenced count not 0, means this variable still be referenced,
-		add to vm->gc_vars list for rooted checking.*/
+		add to vm gc lists for rooted checking.*/
 		add_to_gc(var);
 	}
 }
 
-static inline void gc_vars(vm_t* vm) {
-	gc_mark(vm->root, true); //mark all rooted vars
-	gc_mark_stack(vm, true); //mark all stacked vars
-	gc_mark_isignal(vm, true); //mark all interrupt signal vars
-	gc_mark_cache(vm, true); //mark all cached vars
+/*drop children of an unreachable var. other garbage may still reference it,
+so it's only freed when refs gone.*/
+static inline void gc_free_unreachable(var_t* var) {
+	remove_from_gc(var);
+	var->status = V_ST_REF;
+	var->refs++; //hold it, children may unref it back.
+	var_remove_all(var);
+	if(--var->refs == 0)
+		var_free(var);
+}
 
-	var_t* v = vm->gc_vars;
-	//first step: free unmarked vars
-	while(v != NULL) {
-		var_t* next = v->next;
-		if(v->status == V_ST_GC && v->gc_marked == false) {
-			var_free(v);
+/*sweep at most n vars, return true if done. the sealed nursery is swept from
+head, survivors are tenured to gc_old. major cycles sweep gc_old from gc_cursor
+then. vars removed meanwhile move the bounds on(gc_list_remove).*/
+static inline bool gc_sweep_step(vm_t* vm, uint32_t n) {
+	while(vm->gc_sealed != NULL) {
+		if(n == 0)
+			return false;
+		n--;
+
+		var_t* v = vm->gc_young.head;
+		if(!v->gc_marked) { //unreachable
+			gc_free_unreachable(v);
+		}
+		else { //survived, tenure it.
+			gc_list_remove(&vm->gc_young, v);
+			gc_list_add(&vm->gc_old, v);
+			v->status = V_ST_GC_OLD;
 		}
-		v = next;
 	}
 
-	gc_mark(vm->root, false); //unmark all rooted vars
-	gc_mark_stack(vm, false); //unmark all stacked vars
-	gc_mark_isignal(vm, false); //unmark all interrupt signal vars
-	gc_mark_cache(vm, false); //unmark all cached vars
+	while(vm->gc_cursor != NULL) {
+		if(n == 0)
+			return false;
+		n--;
 
-	//second step: move freed var to free_var_list for reusing.
-	v = vm->gc_vars;
-	while(v != NULL) {
-		var_t* next = v->next;
-		if(v->status == V_ST_GC_FREE) {
-			remove_from_gc(v);	
-			add_to_free(v);
+		var_t* v = vm->gc_cursor;
+		vm->gc_cursor = v->next;
+		if(!v->gc_marked) //unreachable
+			gc_free_unreachable(v);
+	}
+	return true;
+}
+
+static inline bool gc_major_due(vm_t* vm) {
+	uint32_t min = vm->gc_buffer_size * vm->gc_major_cycles;
+	return vm->gc_major_cycles == 0 ||
+			vm->gc_tenured >= (vm->gc_live > min ? vm->gc_live : min);
+}
+
+/*vars remembered by gc_write since last cycle are marked already, and scanned first.*/
+static inline void gc_begin(vm_t* vm, bool major) {
+	vm->gc_cycles++;
+	vm->gc_major = major;
+	if(major)
+		vm->gc_tenured = 0;
+	vm->gc_phase = GC_MARK;
+	gc_mark_roots(vm);
+}
+
+/*finish marking in one pause: rescan roots changed while marking. the nursery is
+sealed then, vars entering it after are not marked and left to the next cycle,
+so it's swept in steps like the old list.*/
+static inline void gc_finish(vm_t* vm) {
+	gc_mark_roots(vm);
+	gc_mark_step(vm, 0xFFFFFFFF);
+	vm->gc_sealed = vm->gc_young.tail;
+	vm->gc_cursor = NULL;
+	if(vm->gc_major) {
+		vm->gc_live = vm->gc_marks_num;
+		vm->gc_cursor = vm->gc_old.head;
+	}
+	vm->gc_phase = GC_SWEEP;
+}
+
+/*unmark at most n vars and tenure them, return true if cycle done.
+marked vars may be on free_vars list, so don't free it before done.*/
+static inline bool gc_clear_step(vm_t* vm, uint32_t n) {
+	while(vm->gc_marks_num > 0) {
+		if(n == 0) {
+			vm->gc_scan = vm->gc_marks_num; //scanned before, vars shaded later go after.
+			return false;
 		}
-		v = next;
+		n--;
+		var_t* v = vm->gc_marks[--vm->gc_marks_num];
+		if(v->gc_marked && !v->gc_old && !var_empty(v)) {
+			v->gc_old = true;
+			vm->gc_tenured++;
+			if(v->status == V_ST_GC) { //entered nursery after sealed, minor cycles skip it now.
+				gc_list_remove(&vm->gc_young, v);
+				gc_list_add(&vm->gc_old, v);
+				v->status = V_ST_GC_OLD;
+			}
+		}
+		v->gc_marked = false;
 	}
+	vm->gc_scan = 0;
+	vm->gc_phase = GC_IDLE;
+	return true;
 }
 
 static inline void gc_free_vars(vm_t* vm, uint32_t buffer_size) {
@@ -500,13 +907,80 @@ static inline void gc_free_vars(vm_t* vm, uint32_t buffer_size) {
 	}
 }
 
+static inline void gc_complete(vm_t* vm) {
+	if(vm->gc_phase == GC_MARK)
+		gc_finish(vm);
+	gc_mark_step(vm, 0xFFFFFFFF);
+	if(vm->gc_phase == GC_SWEEP)
+		gc_sweep_step(vm, 0xFFFFFFFF);
+	gc_clear_step(vm, 0xFFFFFFFF);
+}
+
+#ifdef MARIO_STATS
+static inline uint64_t stat_clock(vm_t* vm) {
+	return vm->stats.clock_us == NULL ? 0 : vm->stats.clock_us();
+}
+
+static inline void stat_gc_pause(vm_t* vm, uint64_t start) {
+	uint64_t t = stat_clock(vm) - start;
+	vm->stats.gc_steps++;
+	vm->stats.gc_pause_us += t;
+	if(t > vm->stats.gc_pause_max_us)
+		vm->stats.gc_pause_max_us = t;
+}
+#endif
+
+/*full collection, not in steps. marks of a running cycle may be stale, complete it first.*/
+static inline void gc_vars(vm_t* vm) {
+#ifdef MARIO_STATS
+	uint64_t start = stat_clock(vm);
+#endif
+	bool doing = vm->is_doing_gc;
+	vm->is_doing_gc = true;
+	gc_complete(vm);
+	gc_begin(vm, true);
+	gc_complete(vm);
+	vm->is_doing_gc = doing;
+#ifdef MARIO_STATS
+	stat_gc_pause(vm, start);
+#endif
+}
+
+/*one bounded step of the incremental cycle. a cycle starts when nursery is full,
+or as many young vars are remembered by gc_write. vars shaded by barriers after
+marking finished are scanned in steps before sweeping or clearing on.*/
 static inline void gc(vm_t* vm) {
-	if(vm->is_doing_gc || vm->gc_vars_num < vm->gc_buffer_size)
+	if(vm->is_doing_gc)
 		return;
+#ifdef MARIO_STATS
+	uint64_t start = stat_clock(vm);
+#endif
+	if(vm->gc_phase == GC_IDLE) {
+		if(vm->gc_young.num < vm->gc_buffer_size && vm->gc_marks_num < vm->gc_buffer_size)
+			return;
+		gc_begin(vm, gc_major_due(vm));
+	}
+
 	vm->is_doing_gc = true;
-	gc_vars(vm);
-	gc_free_vars(vm, vm->gc_free_buffer_size);
+	if(vm->gc_phase == GC_MARK) {
+		if(gc_mark_step(vm, vm->gc_step_size))
+			gc_finish(vm);
+	}
+	else if(gc_mark_step(vm, vm->gc_step_size)) {
+		if(vm->gc_phase == GC_SWEEP) {
+			if(gc_sweep_step(vm, vm->gc_step_size))
+				vm->gc_phase = GC_CLEAR;
+		}
+		else if(gc_clear_step(vm, vm->gc_step_size * 8)) { //unmarking is much cheaper than scanning
+			//trim a step per cycle, vars freed by a major in a burst are reused, not malloced again.
+			uint32_t keep = vm->free_vars_num > vm->gc_step_size ? vm->free_vars_num - vm->gc_step_size : 0;
+			gc_free_vars(vm, keep > vm->gc_free_buffer_size ? keep : vm->gc_free_buffer_size);
+		}
+	}
 	vm->is_doing_gc = false;
+#ifdef MARIO_STATS
+	stat_gc_pause(vm, start);
+#endif
 }
 
 const char* get_typeof(var_t* var) {
@@ -533,7 +1007,9 @@ inline var_t* var_new(vm_t* vm) {
 	if(var == NULL) {
         uint32_t sz = sizeof(var_t);
 		var = (var_t*)malloc(sz);
+		STAT(vm, var_mallocs++);
 	}
+	STAT(vm, var_news++);
 
 	memset(var, 0, sizeof(var_t));
 	var->type = V_UNDEF;
@@ -551,15 +1027,29 @@ inline var_t* var_new_array(vm_t* vm) {
 	var_t* var = var_new_obj(vm, NULL, NULL);
 	var->is_array = 1;
 	var_t* members = var_new_obj(vm, NULL, NULL);
-	var_add(var, "_ARRAY_", members);
+	var_add_name(var, vm->name_array, members);
 	return var;
 }
 
 inline var_t* var_new_int(vm_t* vm, int i) {
 	var_t* var = var_new(vm);
 	var->type = V_INT;
-	var->value = malloc(sizeof(int));
-	*((int*)var->value) = i;
+	var->value = &var->num;
+	var->num.i = i;
+	return var;
+}
+
+/*immediate int for vm temporaries, shared for small values, never mutated*/
+static inline var_t* vm_int(vm_t* vm, int i) {
+	if(i < VM_INT_MIN || i > VM_INT_MAX)
+		return var_new_int(vm, i);
+
+	var_t* var = vm->var_ints[i - VM_INT_MIN];
+	if(var == NULL) {
+		var = var_ref(var_new_int(vm, i));
+		var->is_imm = 1;
+		vm->var_ints[i - VM_INT_MIN] = var;
+	}
 	return var;
 }
 
@@ -572,8 +1062,8 @@ inline var_t* var_new_null(vm_t* vm) {
 inline var_t* var_new_bool(vm_t* vm, bool b) {
 	var_t* var = var_new(vm);
 	var->type = V_BOOL;
-	var->value = malloc(sizeof(int));
-	*((int*)var->value) = b;
+	var->value = &var->num;
+	var->num.i = b;
 	return var;
 }
 
@@ -585,16 +1075,65 @@ inline var_t* var_new_obj(vm_t* vm, void*p, free_func_t fr) {
 	return var;
 }
 
+static void bytes_borrowed(void* p) {
+	(void)p;
+}
+
+static void var_set_bytes(var_t* var, void* data, uint32_t size, bool borrowed) {
+	if(data == NULL && size > 0) {
+		data = malloc(size);
+		memset(data, 0, size);
+		borrowed = false;
+	}
+	var->value = data;
+	var->size = size;
+	var->free_func = borrowed ? bytes_borrowed : NULL;
+	var->is_bytes = 1;
+}
+
+/*byte array of size, zeroed if data is NULL. a borrowed buffer(e.g. pixels of
+a graph) is shared by reference and never freed by the var.*/
+var_t* var_new_bytes(vm_t* vm, void* data, uint32_t size, bool borrowed) {
+	var_t* var = var_new_obj(vm, NULL, NULL);
+	if(vm->var_Bytes != NULL)
+		var_instance_from(var, vm->var_Bytes);
+	var_set_bytes(var, data, size, borrowed);
+	return var;
+}
+
 inline var_t* var_new_float(vm_t* vm, float i) {
 	var_t* var = var_new(vm);
 	var->type = V_FLOAT;
-	var->value = malloc(sizeof(float));
-	*((float*)var->value) = i;
+	var->value = &var->num;
+	var->num.f = i;
 	return var;
 }
 
 var_t* var_get_prototype(var_t* var) {
-	return get_obj(var, PROTOTYPE);
+	if(var_empty(var))
+		return NULL;
+	return var_find_name_var(var, var->vm->name_prototype);
+}
+
+/*string vars keep the value buffer capacity in num.i, appending grows it
+twice as big, so a string built by += in a loop costs linear time.*/
+static inline void var_str_reserve(var_t* var, uint32_t size) {
+	uint32_t cap = (uint32_t)var->num.i;
+	if(size < cap)
+		return;
+	if(cap < 16)
+		cap = 16;
+	while(cap <= size)
+		cap <<= 1;
+	var->value = realloc_raw(var->value, var->value == NULL ? 0 : var->size+1, cap);
+	var->num.i = (int)cap;
+}
+
+static inline void var_str_append(var_t* var, const char* s, uint32_t len) {
+	var_str_reserve(var, var->size + len);
+	memcpy((char*)var->value + var->size, s, len);
+	var->size += len;
+	((char*)var->value)[var->size] = 0;
 }
 
 inline var_t* var_new_str(vm_t* vm, const char* s) {
@@ -602,6 +1141,7 @@ inline var_t* var_new_str(vm_t* vm, const char* s) {
 	var->type = V_STRING;
 	var->size = (uint32_t)strlen(s);
 	var->value = malloc(var->size + 1);
+	var->num.i = (int)(var->size + 1);
 	memcpy(var->value, s, var->size + 1);
 	return var;
 }
@@ -613,6 +1153,7 @@ inline var_t* var_new_str2(vm_t* vm, const char* s, uint32_t len) {
 	if(var->size > len)
 		var->size = len;
 	var->value = malloc(var->size + 1);
+	var->num.i = (int)(var->size + 1);
 	memcpy(var->value, s, var->size + 1);
 	((char*)(var->value))[var->size] = 0;
 	return var;
@@ -630,10 +1171,12 @@ inline var_t* var_set_str(var_t* var, const char* v) {
 		return var;
 
 	var->type = V_STRING;
-	if(var->value != NULL)
+	if(var_value_owned(var))
 		free(var->value);
 	uint32_t len = (uint32_t)strlen(v)+1;
 	var->value = malloc(len);
+	var->size = len-1;
+	var->num.i = (int)len;
 	memcpy(var->value, v, len);
 	return var;
 }
@@ -659,10 +1202,10 @@ inline int var_get_int(var_t* var) {
 
 inline var_t* var_set_int(var_t* var, int v) {
 	var->type = V_INT;
-	if(var->value != NULL)
+	if(var_value_owned(var))
 		free(var->value);
-	var->value = malloc(sizeof(int));
-	*((int*)var->value) = v;
+	var->value = &var->num;
+	var->num.i = v;
 	return var;
 }
 
@@ -681,10 +1224,10 @@ inline float var_get_float(var_t* var) {
 
 inline var_t* var_set_float(var_t* var, float v) {
 	var->type = V_FLOAT;
-	if(var->value != NULL)
+	if(var_value_owned(var))
 		free(var->value);
-	var->value = malloc(sizeof(int));
-	*((float*)var->value) = v;
+	var->value = &var->num;
+	var->num.f = v;
 	return var;
 }
 
@@ -760,127 +1303,6 @@ void get_parsable_str(var_t* var, str_t* ret) {
 	str_free(s);
 }
 
-void append_json_spaces(str_t* ret, int level) {
-	int spaces;
-	for (spaces = 0; spaces<=level; ++spaces) {
-        str_addc(ret, ' '); str_addc(ret, ' ');
-	}
-}
-
-static bool _done_arr_inited = false;
-void var_to_json_str(var_t* var, str_t* ret, int level) {
-	str_reset(ret);
-
-	uint32_t i;
-
-	//check if done to avoid dead recursion
-	static m_array_t done;
-	if(level == 0) {
-		if(!_done_arr_inited) {		
-			array_init(&done);
-			_done_arr_inited = true;
-		}
-		array_remove_all(&done);
-	}
-	if(var->type == V_OBJECT) {
-		uint32_t sz = done.size;
-		for(i=0; i<sz; ++i) {
-			if(done.items[i] == var) { //already done before.
-				str_cpy(ret, "{}");
-				if(level == 0)
-					array_remove_all(&done);
-				return;
-			}
-		}
-		array_add(&done, var);
-	}
-
-	if (var->is_array) {
-		str_addc(ret, '[');
-		uint32_t len = var_array_size(var);
-		if (len>100) len=100; // we don't want to get stuck here!
-
-		uint32_t i;
-		for (i=0;i<len;i++) {
-			node_t* n = var_array_get(var, i);
-
-			str_t* s = str_new("");
-			var_to_json_str(n->var, s, level);
-			str_add(ret, s->cstr);
-			str_free(s);
-
-			if (i<len-1) 
-				str_add(ret, ", ");
-		}
-		str_addc(ret, ']');
-	}
-	else if (var->is_func) {
-		str_add(ret, "function (");
-		// get list of parameters
-		int sz = 0;
-		if(var->value != NULL) {
-			func_t* func = var_get_func(var);
-			sz = func->args.size;
-			int i=0;
-			for(i=0; i<sz; ++i) {
-				str_add(ret, (const char*)func->args.items[i]);
-				if ((i+1) < sz) {
-					str_add(ret, ", ");
-				}
-			}
-		}
-		// add function body
-		str_add(ret, ") {}");
-		return;
-	}
-	else if (var->type == V_OBJECT) {
-		// children - handle with bracketed list
-		int sz = (int)var->children.size;
-		if(sz > 0)
-			str_add(ret, "{\n");
-		else
-			str_add(ret, "{");
-
-		int i;
-		bool had = false;
-		for(i=0; i<sz; ++i) {
-			node_t* n = var_get(var, i);
-			if(strcmp(n->name, "prototype") == 0)
-				continue;
-			if(had)
-				str_add(ret, ",\n");
-			had = true;
-			append_json_spaces(ret, level);
-			str_addc(ret, '"');
-			str_add(ret, n->name);
-			str_addc(ret, '"');
-			str_add(ret, ": ");
-
-			str_t* s = str_new("");
-			var_to_json_str(n->var, s, level+1);
-			str_add(ret, s->cstr);
-			str_free(s);
-		}
-		if(sz > 0) {
-			str_addc(ret, '\n');
-		}
-	
-		append_json_spaces(ret, level - 1);	
-		str_addc(ret, '}');
-	} 
-	else {
-		// no children or a function... just write value directly
-		str_t* s = str_new("");
-		get_parsable_str(var, s);
-		str_add(ret, s->cstr);
-		str_free(s);
-	}
-
-	if(level == 0) {
-		array_remove_all(&done);
-	}
-}
-
 static inline var_t* vm_load_var(vm_t* vm, const char* name, bool create) {
 	node_t* n = vm_load_node(vm, name, create);
 	if(n != NULL)
@@ -1050,30 +1472,17 @@ var_t* vm_stack_pick(vm_t* vm, int depth) {
 		node_t* node = (node_t*)p;
 		ret = node->var;
 	}
-	else {
-		ret = (var_t*)p;
-	}
-
-	vm->stack_top--;
-	int i;
-	for(i=index; i<vm->stack_top; ++i) {
-		vm->stack[i] = vm->stack[i+1];
-	}
-	return ret;
-}
-
-//scope of vm runing
-typedef struct st_scope {
-	struct st_scope* prev;
-	var_t* var;
-	PC pc_start; // continue anchor for loop
-	PC pc; // try cache anchor , or break anchor for loop
-	uint32_t is_func: 8;
-	uint32_t is_block: 8;
-	uint32_t is_try: 8;
-	uint32_t is_loop: 8;
-	//continue and break anchor for loop(while/for)
-} scope_t;
+	else {
+		ret = (var_t*)p;
+	}
+
+	vm->stack_top--;
+	int i;
+	for(i=index; i<vm->stack_top; ++i) {
+		vm->stack[i] = vm->stack[i+1];
+	}
+	return ret;
+}
 
 #define vm_get_scope(vm) (scope_t*)array_tail((vm)->scopes)
 static inline var_t* vm_get_scope_var(vm_t* vm) {
@@ -1097,6 +1506,9 @@ scope_t* scope_new(var_t* var) {
 	sc->is_func = false;
 	sc->is_try = false;
 	sc->is_loop = false;
+	sc->func = NULL;
+	sc->slots = NULL;
+	sc->slots_pc = 0;
 	return sc;
 }
 
@@ -1106,6 +1518,8 @@ scope_t* scope_clone(scope_t* src) {
 	if(src->var != NULL)
 		sc->var = var_ref(src->var);
 	sc->prev = NULL;
+	sc->func = NULL;
+	sc->slots = NULL;
 	return sc;
 }
 
@@ -1115,6 +1529,8 @@ void scope_free(void* p) {
 		return;
 	if(sc->var != NULL)
 		var_unref(sc->var);
+	if(sc->slots != NULL)
+		free(sc->slots);
 	free(sc);
 }
 /*#define vm_get_scope_var(vm, skipBlock) ({ \
@@ -1131,11 +1547,15 @@ void scope_free(void* p) {
 */
 
 void vm_push_scope(vm_t* vm, scope_t* sc) {
+	if(!var_empty(sc->var))
+		var_touch_all(sc->var);
+
 	scope_t* prev = NULL;
 	if(vm->scopes->size > 0)
 		prev = (scope_t*)array_tail(vm->scopes);
 	array_add(vm->scopes, sc);	
 	sc->prev = prev;
+	sc->func = sc->is_func ? sc : (prev != NULL ? prev->func : NULL);
 }
 
 PC vm_pop_scope(vm_t* vm) {
@@ -1149,6 +1569,8 @@ PC vm_pop_scope(vm_t* vm) {
 
 	if(sc->is_func)
 		pc = sc->pc;
+	if(!var_empty(sc->var))
+		var_touch_all(sc->var);
 	array_del(vm->scopes, vm->scopes->size-1, scope_free);
 	gc(vm);
 	return pc;
@@ -1176,13 +1598,13 @@ node_t* vm_find(vm_t* vm, const char* name) {
 	return var_find(var, name);	
 }
 
-node_t* vm_find_in_class(var_t* var, const char* name) {
+static node_t* vm_find_in_class_name(var_t* var, const char* name) {
 	var_t* proto = var_get_prototype(var);
 	while(proto != NULL) {
 		node_t* ret = NULL;
-		ret = var_find(proto, name);
+		ret = var_find_name(proto, name);
 		if(ret != NULL) {
-			ret = var_add(var, name, var_clone(ret->var));
+			ret = var_add_name(var, name, var_clone(ret->var));
 			return ret;
 		}
 		proto = var_get_prototype(proto);
@@ -1190,6 +1612,15 @@ node_t* vm_find_in_class(var_t* var, const char* name) {
 	return NULL;
 }
 
+node_t* vm_find_in_class(var_t* var, const char* name) {
+	if(var_empty(var))
+		return NULL;
+	name = vm_name(var->vm, name, false);
+	if(name == NULL)
+		return NULL;
+	return vm_find_in_class_name(var, name);
+}
+
 bool var_instanceof(var_t* var, var_t* proto) {
 	var_t* v = var_get_prototype(proto);
 	if(v != NULL)
@@ -1204,34 +1635,46 @@ bool var_instanceof(var_t* var, var_t* proto) {
 	return false;
 }
 
-node_t* find_member(var_t* obj, const char* name) {
-	node_t* node = var_find(obj, name);
+static inline node_t* find_member_name(var_t* obj, const char* name) {
+	node_t* node = var_find_name(obj, name);
 	if(node != NULL)
 		return node;
 
-	return vm_find_in_class(obj, name);
+	return vm_find_in_class_name(obj, name);
+}
+
+node_t* find_member(var_t* obj, const char* name) {
+	if(var_empty(obj))
+		return NULL;
+	name = vm_name(obj->vm, name, false);
+	if(name == NULL)
+		return NULL;
+	return find_member_name(obj, name);
 }
 
 static inline node_t* vm_find_in_closure(var_t* closure, const char* name) {
-	int sz = var_array_size(closure);
-	int i;
-	node_t* ret = NULL;
-	for(i=0; i<sz; ++i) {
-		var_t* var = var_array_get_var(closure, i);
-		ret = var_find(var, name);
+	var_t* arr_var = var_array_var(closure);
+	if(arr_var == NULL)
+		return NULL;
+
+	uint32_t i;
+	for(i=0; i<arr_var->children.size; ++i) {
+		node_t* n = (node_t*)arr_var->children.items[i];
+		if(node_empty(n))
+			continue;
+		node_t* ret = var_find_name(n->var, name);
 		if(ret != NULL)
-			break;
+			return ret;
 	}
-	return ret;
+	return NULL;
 }
 
-#define CLOSURE "__closure"
-
+//name must be interned by vm_name.
 static inline node_t* vm_find_in_scopes(vm_t* vm, const char* name) {
 	node_t* ret = NULL;
 	scope_t* sc = vm_get_scope(vm);
 	if(sc != NULL && sc->is_func) {
-		var_t* closure = get_obj(sc->var, CLOSURE);
+		var_t* closure = var_find_name_var(sc->var, vm->name_closure);
 		if(closure != NULL) {
 			ret = vm_find_in_closure(closure, name);	
 			if(ret != NULL)
@@ -1241,13 +1684,13 @@ static inline node_t* vm_find_in_scopes(vm_t* vm, const char* name) {
 	
 	while(sc != NULL) {
 		if(!var_empty(sc->var)) {
-			ret = var_find(sc->var, name);
+			ret = var_find_name(sc->var, name);
 			if(ret != NULL)
 				return ret;
 			
-			var_t* obj = get_obj(sc->var, THIS);
+			var_t* obj = var_find_name_var(sc->var, vm->name_this);
 			if(obj != NULL) {
-				ret = find_member(obj, name);
+				ret = find_member_name(obj, name);
 				if(ret != NULL)
 					return ret;
 			}
@@ -1255,22 +1698,22 @@ static inline node_t* vm_find_in_scopes(vm_t* vm, const char* name) {
 		sc = sc->prev;
 	}
 
-	return var_find(vm->root, name);
+	return var_find_name(vm->root, name);
 }
 
 static inline var_t* vm_this_in_scopes(vm_t* vm) {
-	node_t* n = vm_find_in_scopes(vm, THIS);
+	node_t* n = vm_find_in_scopes(vm, vm->name_this);
 	if(n == NULL)
 		return NULL;
 	return n->var;
 }
 
-inline node_t* vm_load_node(vm_t* vm, const char* name, bool create) {
+static inline node_t* vm_load_name(vm_t* vm, const char* name, bool create) {
 	var_t* var = vm_get_scope_var(vm);
 
 	node_t* n;
 	if(var != NULL) {
-		n = find_member(var, name);
+		n = find_member_name(var, name);
 	}
 	else {
 		n = vm_find_in_scopes(vm, name);
@@ -1292,10 +1735,17 @@ inline node_t* vm_load_node(vm_t* vm, const char* name, bool create) {
 	if(var == NULL)
 		return NULL;
 
-	n =var_add(var, name, NULL);	
+	n =var_add_name(var, name, NULL);	
 	return n;
 }
 
+inline node_t* vm_load_node(vm_t* vm, const char* name, bool create) {
+	name = vm_name(vm, name, create);
+	if(name == NULL) //never interned, not defined.
+		return NULL;
+	return vm_load_name(vm, name, create);
+}
+
 /*static void var_clone_members(var_t* var, var_t* src) {
 	//clone member varibles.
 	uint32_t i;
@@ -1315,7 +1765,7 @@ inline node_t* vm_load_node(vm_t* vm, const char* name, bool create) {
 void var_set_prototype(var_t* var, var_t* proto) {
 	if(var == NULL || proto == NULL)
 		return;
-	var_add(var, PROTOTYPE, proto);
+	var_add_name(var, var->vm->name_prototype, proto);
 }
 
 void var_from_prototype(var_t* var, var_t* proto) {
@@ -1409,10 +1859,14 @@ var_t* var_new_func(vm_t* vm, func_t* func) {
 }
 
 var_t* find_func(vm_t* vm, var_t* obj, const char* fname) {
+	fname = vm_name(vm, fname, false);
+	if(fname == NULL)
+		return NULL;
+
 	//try full name with arg_num
 	node_t* node = NULL;
 	if(obj != NULL) {
-		node = find_member(obj, fname);
+		node = find_member_name(obj, fname);
 	}
 	if(node == NULL) {
 		node = vm_find_in_scopes(vm, fname);
@@ -1425,7 +1879,9 @@ var_t* find_func(vm_t* vm, var_t* obj, const char* fname) {
 }
 
 var_t* func_get_closure(var_t* var) {
-	return get_obj(var, CLOSURE);
+	if(var_empty(var))
+		return NULL;
+	return var_find_name_var(var, var->vm->name_closure);
 }
 
 void func_mark_closure(vm_t* vm, var_t* func) { //try mark function closure
@@ -1435,13 +1891,13 @@ void func_mark_closure(vm_t* vm, var_t* func) { //try mark function closure
 		return;
 
 	var_t* closure = var_new_array(vm);
-	int i;
+	uint32_t i;
 	bool mark = false;
 	for(i=0; i<vm->scopes->size; ++i) {
 		scope_t* sc = (scope_t*)array_get(vm->scopes, i);
 		if(sc->is_func) { //enter closure
 			mark = true;
-			var_add(func, CLOSURE, closure);
+			var_add_name(func, vm->name_closure, closure);
 		}
 		if(mark)
 			var_array_add(closure, sc->var);
@@ -1459,15 +1915,15 @@ bool func_call(vm_t* vm, var_t* obj, var_t* func_var, int arg_num) {
 		//obj = vm->root;
 	}
 	else {
-		var_add(env, THIS, obj);
+		var_add_name(env, vm->name_this, obj);
 	}
 	
 	var_t* closure = func_get_closure(func_var);
 	if(closure != NULL)
-		var_add(env, CLOSURE, closure);
+		var_add_name(env, vm->name_closure, closure);
 
 	int32_t i;
-	for(i=arg_num; i>func->args.size; i--) {
+	for(i=arg_num; i>(int32_t)func->args.size; i--) {
 		var_t* v = vm_pop2(vm);
 		var_array_add(args, v);
 		var_unref(v);
@@ -1548,6 +2004,27 @@ var_t* func_def(vm_t* vm, bool regular, bool is_static) {
 	return ret;
 }
 
+static inline bool is_op_eq(opr_code_t op) {
+	return (op == INSTR_PLUSEQ || 
+			op == INSTR_MINUSEQ ||
+			op == INSTR_DIVEQ ||
+			op == INSTR_MULTIEQ ||
+			op == INSTR_MODEQ);
+}
+
+/*int result into v1 for assign ops, or into an operand only held by the stack*/
+static inline var_t* vm_int_result(vm_t* vm, var_t* v1, var_t* v2, int ret, bool assign) {
+	var_t* v;
+	if(!v1->is_imm && (assign || v1->refs == 1))
+		v = v1;
+	else if(!v2->is_imm && v2->refs == 1)
+		v = v2;
+	else
+		return vm_int(vm, ret);
+	v->num.i = ret;
+	return v;
+}
+
 static inline void math_op(vm_t* vm, opr_code_t op, var_t* v1, var_t* v2) {
 	/*if(v1->value == NULL || v2->value == NULL) {
 		vm_push(vm, var_new());
@@ -1564,11 +2041,11 @@ static inline void math_op(vm_t* vm, opr_code_t op, var_t* v1, var_t* v2) {
 		switch(op) {
 			case INSTR_PLUS: 
 			case INSTR_PLUSEQ: 
-				ret = (i1 + i2);
+				ret = (int)((uint32_t)i1 + (uint32_t)i2); //wraps, overflowing int is undefined.
 				break; 
 			case INSTR_MINUS: 
 			case INSTR_MINUSEQ: 
-				ret = (i1 - i2);
+				ret = (int)((uint32_t)i1 - (uint32_t)i2);
 				break; 
 			case INSTR_DIV: 
 			case INSTR_DIVEQ: 
@@ -1576,7 +2053,7 @@ static inline void math_op(vm_t* vm, opr_code_t op, var_t* v1, var_t* v2) {
 				break; 
 			case INSTR_MULTI: 
 			case INSTR_MULTIEQ: 
-				ret = (i1 * i2);
+				ret = (int)((uint32_t)i1 * (uint32_t)i2);
 				break; 
 			case INSTR_MOD: 
 			case INSTR_MODEQ: 
@@ -1596,19 +2073,7 @@ static inline void math_op(vm_t* vm, opr_code_t op, var_t* v1, var_t* v2) {
 				break; 
 		}
 
-		var_t* v;
-		if(op == INSTR_PLUSEQ || 
-				op == INSTR_MINUSEQ ||
-				op == INSTR_DIVEQ ||
-				op == INSTR_MULTIEQ ||
-				op == INSTR_MODEQ)  {
-			v = v1;
-			*(int*)v->value = ret;
-		}
-		else {
-			v = var_new_int(vm, ret);
-		}
-		vm_push(vm, v);
+		vm_push(vm, vm_int_result(vm, v1, v2, ret, is_op_eq(op)));
 		return;
 	}
 
@@ -1646,13 +2111,16 @@ static inline void math_op(vm_t* vm, opr_code_t op, var_t* v1, var_t* v2) {
 		}
 
 		var_t* v;
-		if(op == INSTR_PLUSEQ || 
-				op == INSTR_MINUSEQ ||
-				op == INSTR_DIVEQ ||
-				op == INSTR_MULTIEQ ||
-				op == INSTR_MODEQ)  {
+		if(!v1->is_imm && v1->type == V_FLOAT && (is_op_eq(op) || v1->refs == 1))  {
 			v = v1;
-			*(float*)v->value = ret;
+			v->num.f = ret;
+		}
+		else if(!is_op_eq(op) && !v2->is_imm && v2->type == V_FLOAT && v2->refs == 1) {
+			v = v2;
+			v->num.f = ret;
+		}
+		else if(is_op_eq(op) && !v1->is_imm) {
+			v = var_set_float(v1, ret);
 		}
 		else {
 			v = var_new_float(vm, ret);
@@ -1662,27 +2130,45 @@ static inline void math_op(vm_t* vm, opr_code_t op, var_t* v1, var_t* v2) {
 	}
 #endif
 
-	//do string + 
+	//do string +, appended in place to the assigned var or a temporary one.
 	if(op == INSTR_PLUS || op == INSTR_PLUSEQ) {
-		str_t* s = str_new((const char*)v1->value);
-		str_t* json = str_new("");
-		var_to_str(v2, json);
-		str_add(s, json->cstr);
-		str_free(json);
-
-		var_t* v;
-		if(op == INSTR_PLUSEQ) {
-			v = v1;
-			char* p = (char*)v->value;
-			v->value = malloc(s->len+1);
-			memcpy(v->value, s->cstr, s->len+1);
-			if(p != NULL)
-				free(p);
+		str_t* s = NULL;
+		const char* p2;
+		if(v2->type == V_STRING && v2 != v1) {
+			p2 = var_get_str(v2);
 		}
 		else {
-			v = var_new_str(vm, s->cstr);
+			s = str_new("");
+			var_to_str(v2, s);
+			p2 = s->cstr;
+		}
+		uint32_t len2 = (uint32_t)strlen(p2);
+
+		var_t* v = v1;
+		bool in_place = !v1->is_imm && (op == INSTR_PLUSEQ || v1->refs == 1);
+		if(!in_place || v1->type != V_STRING) {
+			const char* p1 = var_get_str(v1);
+			str_t* s1 = NULL;
+			if(v1->type != V_STRING) {
+				s1 = str_new("");
+				var_to_str(v1, s1);
+				p1 = s1->cstr;
+			}
+			if(in_place) {
+				var_set_str(v1, p1);
+			}
+			else {
+				v = var_new(vm);
+				v->type = V_STRING;
+				var_str_reserve(v, (uint32_t)strlen(p1) + len2);
+				var_str_append(v, p1, (uint32_t)strlen(p1));
+			}
+			if(s1 != NULL)
+				str_free(s1);
 		}
-		str_free(s);
+		var_str_append(v, p2, len2);
+		if(s != NULL)
+			str_free(s);
 		vm_push(vm, v);
 	}
 }
@@ -1823,19 +2309,43 @@ static inline void compare(vm_t* vm, opr_code_t op, var_t* v1, var_t* v2) {
 #endif
 }
 
-void do_get(vm_t* vm, var_t* v, const char* name) {
-	if(v->type == V_STRING && strcmp(name, "length") == 0) {
-		int len = (int)strlen(var_get_str(v));
-		vm_push(vm, var_new_int(vm, len));
+/*name must be interned by vm_name. ic->ver keeps the children slot the member
+was found at last time, objects built the same way share it.*/
+void do_get(vm_t* vm, var_t* v, const char* name, icache_t* ic) {
+	if(v->type == V_STRING && name == vm->name_length) {
+		vm_push(vm, var_new_int(vm, (int)v->size));
+		return;
+	}
+	else if(v->is_bytes && name == vm->name_length) {
+		vm_push(vm, var_new_int(vm, (int)v->size));
 		return;
 	}
-	else if(v->is_array && strcmp(name, "length") == 0) {
+	else if(v->is_array && name == vm->name_length) {
 		int len = var_array_size(v);
 		vm_push(vm, var_new_int(vm, len));
 		return;
 	}	
 
-	node_t* n = find_member(v, name);
+	node_t* n = NULL;
+	if(ic->ver < v->children.size) {
+		n = (node_t*)v->children.items[ic->ver];
+		if(n == NULL || n->name != name || node_empty(n))
+			n = NULL;
+	}
+
+	if(n == NULL) {
+		n = find_member_name(v, name);
+		if(n != NULL && v->index == NULL) {
+			uint32_t i;
+			for(i=0; i<v->children.size; i++) {
+				if(v->children.items[i] == n) {
+					ic->ver = i;
+					break;
+				}
+			}
+		}
+	}
+
 	if(n != NULL) {
 		/*if(n->var->type == V_FUNC) {
 			func_t* func = var_get_func(n->var);
@@ -1851,7 +2361,7 @@ void do_get(vm_t* vm, var_t* v, const char* name) {
 			v->type = V_OBJECT;
 
 		if(v->type == V_OBJECT) {
-			n = var_add(v, name, NULL);
+			n = var_add_name(v, name, NULL);
 		}
 		else {
 			//_err("Can not get member '");
@@ -1867,7 +2377,7 @@ void do_get(vm_t* vm, var_t* v, const char* name) {
 }
 
 void doExtends(vm_t* vm, var_t* cls_var, const char* super_name) {
-	node_t* n = vm_find_in_scopes(vm, super_name);
+	node_t* n = vm_find_in_scopes(vm, vm_name(vm, super_name, true));
 	if(n == NULL) {
 		//_err("Super Class '");
 		//_err(super_name);
@@ -2156,7 +2666,7 @@ static void do_include(vm_t* vm, const char* jsname) {
 	if(_load_m_func == NULL)
 		return;
 	//check if included or not.
-	int i;
+	uint32_t i;
 	for(i=0; i<vm->included.size; i++) {
 		str_t* jsn = (str_t*)array_get(&vm->included, i);
 		if(strcmp(jsn->cstr, jsname) == 0)
@@ -2178,32 +2688,245 @@ static void do_include(vm_t* vm, const char* jsname) {
 	vm->pc = pc;
 }
 
+static void vm_icache_grow(vm_t* vm) {
+	uint32_t size = vm->bc.cindex;
+	icache_t* ic = (icache_t*)malloc(size * sizeof(icache_t));
+	memset(ic, 0, size * sizeof(icache_t));
+	if(vm->icache != NULL) {
+		memcpy(ic, vm->icache, vm->icache_size * sizeof(icache_t));
+		free(vm->icache);
+	}
+	vm->icache = ic;
+	vm->icache_size = size;
+}
+
+static inline node_t* vm_load_cached(vm_t* vm, const char* s, icache_t* ic) {
+	node_t* n = ic->node;
+	if(n == NULL || ic->epoch != vm->ic_epoch || ic->ver != NAME_VER(s) || node_empty(n)) {
+		n = vm_load_name(vm, s, true); //load variable, create if not exist.
+		ic->node = n;
+		ic->epoch = vm->ic_epoch;
+		ic->ver = NAME_VER(s);
+	}
+	return n;
+}
+
+//enclosing function vars, innermost captured scope first.
+static inline node_t* vm_find_upval(vm_t* vm, var_t* env, const char* name) {
+	var_t* closure = var_find_name_var(env, vm->name_closure);
+	var_t* arr_var = closure == NULL ? NULL : var_array_var(closure);
+	if(arr_var == NULL)
+		return NULL;
+
+	uint32_t i = arr_var->children.size;
+	while(i > 0) {
+		node_t* n = (node_t*)arr_var->children.items[--i];
+		if(node_empty(n))
+			continue;
+		node_t* ret = var_find_name(n->var, name);
+		if(ret != NULL && !node_empty(ret))
+			return ret;
+	}
+	return NULL;
+}
+
+/*frame slot i of running function, unbound or emptied slots are resolved by name*/
+static inline node_t* vm_slot(vm_t* vm, uint32_t i, bool upval) {
+	scope_t* sc = vm_get_scope(vm);
+	sc = sc->func;
+	node_t* n = sc->slots[i];
+	if(n != NULL && !node_empty(n))
+		return n;
+
+	const char* s = vm_bc_name(vm, OFF(vm->bc.code_buf[sc->slots_pc + i]));
+	n = upval ? vm_find_upval(vm, sc->var, s) : NULL;
+	if(n == NULL)
+		n = vm_load_name(vm, s, false);
+	if(n != NULL)
+		sc->slots[i] = n;
+	else
+		n = vm_load_name(vm, s, true);
+	return n;
+}
+
+#define node_modifiable(n) (!(n)->be_const || (n)->var->type == V_UNDEF)
+
+/*assign v to n, push n's var unless the next instruction just pops it*/
+static inline void vm_assign(vm_t* vm, node_t* n, var_t* v, bool modi, PC ins) {
+	PC* code = vm->bc.code_buf;
+	if(modi) 
+		node_replace(n, v);
+
+	if((ins & INSTR_OPT_CACHE) == 0) {
+		if(OP(code[vm->pc]) != INSTR_POP) {
+			vm_push(vm, n->var);
+		}
+		else { 
+			code[vm->pc] = INSTR_NIL;
+			code[vm->pc-1] |= INSTR_OPT_CACHE;
+		}
+	}
+	else { //skip the nil if cached
+		vm->pc++;
+	}
+}
+
+#ifdef MARIO_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Woverride-init" //[0 ... 255] defaults in dispatch
+#define CASE(op) case op: L_##op
+/*hot handlers jump straight to the next handler*/
+#define NEXT() \
+	if(vm->pc < code_size) { \
+		ins = code[vm->pc++]; \
+		instr = OP(ins); \
+		offset = OFF(ins); \
+		STAT(vm, ops[instr]++); \
+		goto *dispatch[instr]; \
+	} \
+	break
+#else
+#define CASE(op) case op
+#define NEXT() break
+#endif
+
 bool vm_run(vm_t* vm) {
 	//int32_t scDeep = vm->scopes.size;
 	register PC code_size = vm->bc.cindex;
 	register PC* code = vm->bc.code_buf;
+	if(vm->icache_size < code_size)
+		vm_icache_grow(vm);
+#ifdef MARIO_COMPUTED_GOTO
+	static const void* dispatch[256] = {
+		[0 ... 255] = &&L_NOOP,
+		[INSTR_END] = &&L_END,
+		[INSTR_JMP] = &&L_INSTR_JMP,
+		[INSTR_JMPB] = &&L_INSTR_JMPB,
+		[INSTR_NJMP] = &&L_INSTR_NJMP,
+		[INSTR_NJMPB] = &&L_INSTR_NJMPB,
+		[INSTR_LOAD] = &&L_INSTR_LOAD,
+		[INSTR_LOADO] = &&L_INSTR_LOADO,
+		[INSTR_LOAD_LOCAL] = &&L_INSTR_LOAD_LOCAL,
+		[INSTR_LOAD_UPVAL] = &&L_INSTR_LOAD_UPVAL,
+		[INSTR_LOAD_LOCAL2] = &&L_INSTR_LOAD_LOCAL2,
+		[INSTR_STORE] = &&L_INSTR_STORE,
+		[INSTR_STORE_LOCAL] = &&L_INSTR_STORE_LOCAL,
+		[INSTR_SLOTS] = &&L_INSTR_SLOTS,
+		[INSTR_LOCAL] = &&L_INSTR_LOCAL,
+		[INSTR_UPVAL] = &&L_INSTR_UPVAL,
+		[INSTR_LES] = &&L_INSTR_LES,
+		[INSTR_EQ] = &&L_INSTR_EQ,
+		[INSTR_NEQ] = &&L_INSTR_NEQ,
+		[INSTR_TEQ] = &&L_INSTR_TEQ,
+		[INSTR_NTEQ] = &&L_INSTR_NTEQ,
+		[INSTR_GRT] = &&L_INSTR_GRT,
+		[INSTR_LEQ] = &&L_INSTR_LEQ,
+		[INSTR_GEQ] = &&L_INSTR_GEQ,
+		[INSTR_LT_INT] = &&L_INSTR_LT_INT,
+		[INSTR_NJMP_LT] = &&L_INSTR_NJMP_LT,
+		[INSTR_NIL] = &&L_INSTR_NIL,
+		[INSTR_BLOCK] = &&L_INSTR_BLOCK,
+		[INSTR_LOOP] = &&L_INSTR_LOOP,
+		[INSTR_TRY] = &&L_INSTR_TRY,
+		[INSTR_BLOCK_END] = &&L_INSTR_BLOCK_END,
+		[INSTR_LOOP_END] = &&L_INSTR_LOOP_END,
+		[INSTR_TRY_END] = &&L_INSTR_TRY_END,
+		[INSTR_BREAK] = &&L_INSTR_BREAK,
+		[INSTR_CONTINUE] = &&L_INSTR_CONTINUE,
+#ifdef MARIO_CACHE
+		[INSTR_CACHE] = &&L_INSTR_CACHE,
+#endif
+		[INSTR_TRUE] = &&L_INSTR_TRUE,
+		[INSTR_FALSE] = &&L_INSTR_FALSE,
+		[INSTR_NULL] = &&L_INSTR_NULL,
+		[INSTR_UNDEF] = &&L_INSTR_UNDEF,
+		[INSTR_POP] = &&L_INSTR_POP,
+		[INSTR_NEG] = &&L_INSTR_NEG,
+		[INSTR_NOT] = &&L_INSTR_NOT,
+		[INSTR_AAND] = &&L_INSTR_AAND,
+		[INSTR_OOR] = &&L_INSTR_OOR,
+		[INSTR_PLUS] = &&L_INSTR_PLUS,
+		[INSTR_RSHIFT] = &&L_INSTR_RSHIFT,
+		[INSTR_LSHIFT] = &&L_INSTR_LSHIFT,
+		[INSTR_AND] = &&L_INSTR_AND,
+		[INSTR_OR] = &&L_INSTR_OR,
+		[INSTR_PLUSEQ] = &&L_INSTR_PLUSEQ,
+		[INSTR_MULTIEQ] = &&L_INSTR_MULTIEQ,
+		[INSTR_DIVEQ] = &&L_INSTR_DIVEQ,
+		[INSTR_MODEQ] = &&L_INSTR_MODEQ,
+		[INSTR_MINUS] = &&L_INSTR_MINUS,
+		[INSTR_MINUSEQ] = &&L_INSTR_MINUSEQ,
+		[INSTR_DIV] = &&L_INSTR_DIV,
+		[INSTR_MULTI] = &&L_INSTR_MULTI,
+		[INSTR_MOD] = &&L_INSTR_MOD,
+		[INSTR_ADD_INT] = &&L_INSTR_ADD_INT,
+		[INSTR_SUB_INT] = &&L_INSTR_SUB_INT,
+		[INSTR_MMINUS_PRE] = &&L_INSTR_MMINUS_PRE,
+		[INSTR_MMINUS] = &&L_INSTR_MMINUS,
+		[INSTR_PPLUS_PRE] = &&L_INSTR_PPLUS_PRE,
+		[INSTR_PPLUS] = &&L_INSTR_PPLUS,
+		[INSTR_RETURN] = &&L_INSTR_RETURN,
+		[INSTR_RETURNV] = &&L_INSTR_RETURNV,
+		[INSTR_VAR] = &&L_INSTR_VAR,
+		[INSTR_LET] = &&L_INSTR_LET,
+		[INSTR_CONST] = &&L_INSTR_CONST,
+		[INSTR_INT] = &&L_INSTR_INT,
+		[INSTR_INT_S] = &&L_INSTR_INT_S,
+		[INSTR_FLOAT] = &&L_INSTR_FLOAT,
+		[INSTR_STR] = &&L_INSTR_STR,
+		[INSTR_ASIGN] = &&L_INSTR_ASIGN,
+		[INSTR_GET] = &&L_INSTR_GET,
+		[INSTR_NEW] = &&L_INSTR_NEW,
+		[INSTR_CALL] = &&L_INSTR_CALL,
+		[INSTR_CALLO] = &&L_INSTR_CALLO,
+		[INSTR_MEMBER] = &&L_INSTR_MEMBER,
+		[INSTR_MEMBERN] = &&L_INSTR_MEMBERN,
+		[INSTR_FUNC] = &&L_INSTR_FUNC,
+		[INSTR_FUNC_STC] = &&L_INSTR_FUNC_STC,
+		[INSTR_FUNC_GET] = &&L_INSTR_FUNC_GET,
+		[INSTR_FUNC_SET] = &&L_INSTR_FUNC_SET,
+		[INSTR_OBJ] = &&L_INSTR_OBJ,
+		[INSTR_ARRAY] = &&L_INSTR_ARRAY,
+		[INSTR_ARRAY_END] = &&L_INSTR_ARRAY_END,
+		[INSTR_OBJ_END] = &&L_INSTR_OBJ_END,
+		[INSTR_ARRAY_AT] = &&L_INSTR_ARRAY_AT,
+		[INSTR_CLASS] = &&L_INSTR_CLASS,
+		[INSTR_CLASS_END] = &&L_INSTR_CLASS_END,
+		[INSTR_INSTOF] = &&L_INSTR_INSTOF,
+		[INSTR_TYPEOF] = &&L_INSTR_TYPEOF,
+		[INSTR_INCLUDE] = &&L_INSTR_INCLUDE,
+		[INSTR_THROW] = &&L_INSTR_THROW,
+		[INSTR_CATCH] = &&L_INSTR_CATCH,
+	};
+#endif
 
 	do {
 		register PC ins = code[vm->pc++];
 		register opr_code_t instr = OP(ins);
 		register uint32_t offset = OFF(ins);
+		STAT(vm, ops[instr]++);
 
+#ifdef MARIO_COMPUTED_GOTO
+		goto *dispatch[instr];
+#else
 		if(instr == INSTR_END)
 			break;
+#endif
 		
 		switch(instr) {
-			case INSTR_JMP: 
+			CASE(INSTR_JMP): 
 			{
 				vm->pc = vm->pc + offset - 1;
-				break;
+				NEXT();
 			}
-			case INSTR_JMPB: 
+			CASE(INSTR_JMPB): 
 			{
 				vm->pc = vm->pc - offset - 1;
-				break;
+				NEXT();
 			}
-			case INSTR_NJMP: 
-			case INSTR_NJMPB: 
+			CASE(INSTR_NJMP): 
+			CASE(INSTR_NJMPB): 
 			{
 				var_t* v = vm_pop2(vm);
 				if(v->type == V_UNDEF ||
@@ -2215,10 +2938,10 @@ bool vm_run(vm_t* vm) {
 						vm->pc = vm->pc - offset - 1;
 				}
 				var_unref(v);
-				break;
+				NEXT();
 			}
-			case INSTR_LOAD: 
-			case INSTR_LOADO: 
+			CASE(INSTR_LOAD): 
+			CASE(INSTR_LOADO): 
 			{
 				bool loaded = false;
 				if(offset == vm->this_strIndex) {
@@ -2229,47 +2952,111 @@ bool vm_run(vm_t* vm) {
 					}
 				}
 				if(!loaded) {
-					const char* s = bc_getstr(&vm->bc, offset);
-					node_t* n = NULL;
-					if(instr == INSTR_LOAD) {
-						n = vm_load_node(vm, s, true); //load variable, create if not exist.
-						vm_push_node(vm, n);
-					}
-					else { // LOAD obj
-						n = vm_load_node(vm, s, true); //load variable, warning if not exist.
-						vm_push_node(vm, n);
-						if(n->var->type != V_OBJECT) {
-							//_debug("Warning: object or class '");
-							//_debug(s);
-							//_debug("' undefined, object created.\n");
-						}
-					}
+					const char* s = vm_bc_name(vm, offset);
+					vm_push_node(vm, vm_load_cached(vm, s, &vm->icache[vm->pc-1]));
 				}
 				break;
 			}
-			case INSTR_LES: 
-			case INSTR_EQ: 
-			case INSTR_NEQ: 
-			case INSTR_TEQ:
-			case INSTR_NTEQ:
-			case INSTR_GRT: 
-			case INSTR_LEQ: 
-			case INSTR_GEQ: 
+			CASE(INSTR_LOAD_LOCAL): 
+			CASE(INSTR_LOAD_UPVAL): 
+			{
+				vm_push_node(vm, vm_slot(vm, offset, instr == INSTR_LOAD_UPVAL));
+				NEXT();
+			}
+			CASE(INSTR_LOAD_LOCAL2): 
+			{
+				vm_push_node(vm, vm_slot(vm, offset & 0x3FF, false));
+				vm_push_node(vm, vm_slot(vm, offset >> 10, false));
+				vm->pc++; //the LOAD_LOCAL b kept for jumps into it
+				NEXT();
+			}
+			CASE(INSTR_STORE): 
+			CASE(INSTR_STORE_LOCAL): 
+			{
+				var_t* v = vm_pop2(vm);
+				node_t* n;
+				if(instr == INSTR_STORE_LOCAL)
+					n = vm_slot(vm, offset, false);
+				else
+					n = vm_load_cached(vm, vm_bc_name(vm, offset), &vm->icache[vm->pc-1]);
+				vm_assign(vm, n, v, node_modifiable(n), ins);
+				var_unref(v);
+				NEXT();
+			}
+			CASE(INSTR_SLOTS): 
+			{
+				scope_t* sc = vm_get_scope(vm);
+				sc->slots = (node_t**)malloc(offset * sizeof(node_t*));
+				memset(sc->slots, 0, offset * sizeof(node_t*));
+				sc->slots_pc = vm->pc;
+				break;
+			}
+			CASE(INSTR_LOCAL): 
+			{
+				scope_t* sc = vm_get_scope(vm);
+				sc->slots[vm->pc - 1 - sc->slots_pc] = var_add_name(sc->var, vm_bc_name(vm, offset), NULL);
+				break;
+			}
+			CASE(INSTR_UPVAL): 
+			{
+				break; //bound on first use
+			}
+			CASE(INSTR_LES): 
+			CASE(INSTR_EQ): 
+			CASE(INSTR_NEQ): 
+			CASE(INSTR_TEQ):
+			CASE(INSTR_NTEQ):
+			CASE(INSTR_GRT): 
+			CASE(INSTR_LEQ): 
+			CASE(INSTR_GEQ): 
 			{
 				var_t* v2 = vm_pop2(vm);
 				var_t* v1 = vm_pop2(vm);
+				if(instr == INSTR_LES && v1->type == V_INT && v2->type == V_INT)
+					code[vm->pc-1] = INS(INSTR_LT_INT, offset);
 				compare(vm, instr, v1, v2);
 				var_unref(v1);
 				var_unref(v2);
 				break;
 			}
-			case INSTR_NIL: 
+			CASE(INSTR_LT_INT): 
+			CASE(INSTR_NJMP_LT): 
+			{
+				var_t* v2 = vm_pop2(vm);
+				var_t* v1 = vm_pop2(vm);
+				if(v1->type != V_INT || v2->type != V_INT) {
+					compare(vm, INSTR_LES, v1, v2); //the NJMP after NJMP_LT takes it.
+				}
+				else {
+					bool lt = v1->num.i < v2->num.i;
+					PC next = code[vm->pc];
+					opr_code_t jmp = OP(next);
+					if(jmp == INSTR_NJMP || jmp == INSTR_NJMPB) {
+						if(instr == INSTR_LT_INT)
+							code[vm->pc-1] = INS(INSTR_NJMP_LT, offset);
+						vm->pc++;
+						if(!lt) {
+							if(jmp == INSTR_NJMP) 
+								vm->pc = vm->pc + OFF(next) - 1;
+							else
+								vm->pc = vm->pc - OFF(next) - 1;
+						}
+					}
+					else {
+						vm_push(vm, lt ? vm->var_true : vm->var_false);
+					}
+				}
+				var_unref(v1);
+				var_unref(v2);
+				NEXT();
+			}
+			CASE(INSTR_NIL): 
 			{	
-				break; 
+				NEXT(); 
 			}
-			case INSTR_BLOCK: 
-			case INSTR_LOOP: 
-			case INSTR_TRY: 
+			CASE(INSTR_BLOCK): 
+			CASE(INSTR_LOOP): 
+			CASE(INSTR_TRY): 
 			{
 				scope_t* sc = NULL;
 				sc = scope_new(var_new_block(vm));
@@ -2286,14 +3073,14 @@ bool vm_run(vm_t* vm) {
 				vm_push_scope(vm, sc);
 				break;
 			}
-			case INSTR_BLOCK_END: 
-			case INSTR_LOOP_END: 
-			case INSTR_TRY_END: 
+			CASE(INSTR_BLOCK_END): 
+			CASE(INSTR_LOOP_END): 
+			CASE(INSTR_TRY_END): 
 			{
 				vm_pop_scope(vm);
 				break;
 			}
-			case INSTR_BREAK: 
+			CASE(INSTR_BREAK): 
 			{
 				while(true) {
 					scope_t* sc = vm_get_scope(vm);
@@ -2310,7 +3097,7 @@ bool vm_run(vm_t* vm) {
 				}
 				break;
 			}
-			case INSTR_CONTINUE:
+			CASE(INSTR_CONTINUE):
 			{
 				while(true) {
 					scope_t* sc = vm_get_scope(vm);
@@ -2328,46 +3115,46 @@ bool vm_run(vm_t* vm) {
 				break;
 			}
 			#ifdef MARIO_CACHE
-			case INSTR_CACHE: 
+			CASE(INSTR_CACHE): 
 			{	
 				var_t* v = vm->var_cache[offset];
 				vm_push(vm, v);
 				break;
 			}
 			#endif
-			case INSTR_TRUE: 
+			CASE(INSTR_TRUE): 
 			{
 				vm_push(vm, vm->var_true);
 				break;
 			}
-			case INSTR_FALSE: 
+			CASE(INSTR_FALSE): 
 			{
 				vm_push(vm, vm->var_false);
 				break;
 			}
-			case INSTR_NULL: 
+			CASE(INSTR_NULL): 
 			{
 				vm_push(vm, vm->var_null);
 				break;
 			}
-			case INSTR_UNDEF: 
+			CASE(INSTR_UNDEF): 
 			{
 				var_t* v = var_new(vm);	
 				vm_push(vm, v);
 				break;
 			}
-			case INSTR_POP: 
+			CASE(INSTR_POP): 
 			{
 				vm_pop(vm);
-				break;
+				NEXT();
 			}
-			case INSTR_NEG: 
+			CASE(INSTR_NEG): 
 			{
 				var_t* v = vm_pop2(vm);
 				if(v->type == V_INT) {
 					int n = *(int*)v->value;
 					n = -n;
-					vm_push(vm, var_new_int(vm, n));
+					vm_push(vm, vm_int(vm, n));
 				}
 				else if(v->type == V_FLOAT) {
 					float n = *(float*)v->value;
@@ -2377,7 +3164,7 @@ bool vm_run(vm_t* vm) {
 				var_unref(v);
 				break;
 			}
-			case INSTR_NOT: 
+			CASE(INSTR_NOT): 
 			{
 				var_t* v = vm_pop2(vm);
 				bool i = false;
@@ -2387,8 +3174,8 @@ bool vm_run(vm_t* vm) {
 				vm_push(vm, i ? vm->var_true:vm->var_false);
 				break;
 			}
-			case INSTR_AAND: 
-			case INSTR_OOR: 
+			CASE(INSTR_AAND): 
+			CASE(INSTR_OOR): 
 			{
 				var_t* v2 = vm_pop2(vm);
 				var_t* v1 = vm_pop2(vm);
@@ -2406,32 +3193,52 @@ bool vm_run(vm_t* vm) {
 				var_unref(v2);
 				break;
 			}
-			case INSTR_PLUS: 
-			case INSTR_RSHIFT: 
-			case INSTR_LSHIFT: 
-			case INSTR_AND: 
-			case INSTR_OR: 
-			case INSTR_PLUSEQ: 
-			case INSTR_MULTIEQ: 
-			case INSTR_DIVEQ: 
-			case INSTR_MODEQ: 
-			case INSTR_MINUS: 
-			case INSTR_MINUSEQ: 
-			case INSTR_DIV: 
-			case INSTR_MULTI: 
-			case INSTR_MOD:
+			CASE(INSTR_PLUS): 
+			CASE(INSTR_RSHIFT): 
+			CASE(INSTR_LSHIFT): 
+			CASE(INSTR_AND): 
+			CASE(INSTR_OR): 
+			CASE(INSTR_PLUSEQ): 
+			CASE(INSTR_MULTIEQ): 
+			CASE(INSTR_DIVEQ): 
+			CASE(INSTR_MODEQ): 
+			CASE(INSTR_MINUS): 
+			CASE(INSTR_MINUSEQ): 
+			CASE(INSTR_DIV): 
+			CASE(INSTR_MULTI): 
+			CASE(INSTR_MOD):
 			{
 				var_t* v2 = vm_pop2(vm);
 				var_t* v1 = vm_pop2(vm);
+				if((instr == INSTR_PLUS || instr == INSTR_MINUS) && v1->type == V_INT && v2->type == V_INT)
+					code[vm->pc-1] = INS(instr == INSTR_PLUS ? INSTR_ADD_INT : INSTR_SUB_INT, offset);
 				math_op(vm, instr, v1, v2);
 				var_unref(v1);
 				var_unref(v2);
 				break;
 			}
-			case INSTR_MMINUS_PRE: 
+			CASE(INSTR_ADD_INT): 
+			CASE(INSTR_SUB_INT): 
+			{
+				var_t* v2 = vm_pop2(vm);
+				var_t* v1 = vm_pop2(vm);
+				if(v1->type == V_INT && v2->type == V_INT) {
+					//wraps in uint32_t, overflowing int is undefined.
+					uint32_t a = (uint32_t)v1->num.i, b = (uint32_t)v2->num.i;
+					int r = (int)((instr == INSTR_ADD_INT) ? (a + b) : (a - b));
+					vm_push(vm, vm_int_result(vm, v1, v2, r, false));
+				}
+				else {
+					math_op(vm, instr == INSTR_ADD_INT ? INSTR_PLUS : INSTR_MINUS, v1, v2);
+				}
+				var_unref(v1);
+				var_unref(v2);
+				NEXT();
+			}
+			CASE(INSTR_MMINUS_PRE): 
 			{
 				var_t* v = vm_pop2(vm);
-				int *i = (int*)v->value;
+				int *i = v->is_imm ? NULL : (int*)v->value;
 				if(i != NULL) {
 					(*i)--;
 					if((ins & INSTR_OPT_CACHE) == 0) {
@@ -2453,13 +3260,13 @@ bool vm_run(vm_t* vm) {
 				var_unref(v);
 				break;
 			}
-			case INSTR_MMINUS: 
+			CASE(INSTR_MMINUS): 
 			{
 				var_t* v = vm_pop2(vm);
-				int *i = (int*)v->value;
+				int *i = v->is_imm ? NULL : (int*)v->value;
 				if(i != NULL) {
 					if((ins & INSTR_OPT_CACHE) == 0) {
-						var_t* v2 = var_new_int(vm, *i);
+						var_t* v2 = vm_int(vm, *i);
 						if(OP(code[vm->pc]) != INSTR_POP) {
 							vm_push(vm, v2);
 						}
@@ -2480,10 +3287,10 @@ bool vm_run(vm_t* vm) {
 				var_unref(v);
 				break;
 			}
-			case INSTR_PPLUS_PRE: 
+			CASE(INSTR_PPLUS_PRE): 
 			{
 				var_t* v = vm_pop2(vm);
-				int *i = (int*)v->value;
+				int *i = v->is_imm ? NULL : (int*)v->value;
 				if(i != NULL) {
 					(*i)++;
 					if((ins & INSTR_OPT_CACHE) == 0) {
@@ -2505,13 +3312,13 @@ bool vm_run(vm_t* vm) {
 				var_unref(v);
 				break;
 			}
-			case INSTR_PPLUS: 
+			CASE(INSTR_PPLUS): 
 			{
 				var_t* v = vm_pop2(vm);
-				int *i = (int*)v->value;
+				int *i = v->is_imm ? NULL : (int*)v->value;
 				if(i != NULL) {
 					if((ins & INSTR_OPT_CACHE) == 0) {
-						var_t* v2 = var_new_int(vm, *i);
+						var_t* v2 = vm_int(vm, *i);
 						if(OP(code[vm->pc]) != INSTR_POP) {
 							vm_push(vm, v2);
 						}
@@ -2532,8 +3339,8 @@ bool vm_run(vm_t* vm) {
 				var_unref(v);
 				break;
 			}
-			case INSTR_RETURN:  //return without value
-			case INSTR_RETURNV: 
+			CASE(INSTR_RETURN):  //return without value
+			CASE(INSTR_RETURNV): 
 			{ //return with value
 				if(instr == INSTR_RETURN) {//return without value, push "this" to stack
 					var_t* thisV = vm_this_in_scopes(vm);
@@ -2560,10 +3367,10 @@ bool vm_run(vm_t* vm) {
 				}
 				return true;
 			}
-			case INSTR_VAR:
+			CASE(INSTR_VAR):
 			{
-				const char* s = bc_getstr(&vm->bc, offset);
-				node_t *node = vm_find(vm, s);
+				const char* s = vm_bc_name(vm, offset);
+				node_t *node = var_find_name(vm_get_scope_var(vm), s);
 				if(node != NULL) { //find just in current scope
 					//_err("Warning: '");
 					//_err(s);
@@ -2572,17 +3379,17 @@ bool vm_run(vm_t* vm) {
 				else {
 					var_t* v = vm_get_scope_var(vm);
 					if(v != NULL) {
-						node = var_add(v, s, NULL);
+						node = var_add_name(v, s, NULL);
 					}
 				}
 				break;
 			}
-			case INSTR_LET:
-			case INSTR_CONST: 
+			CASE(INSTR_LET):
+			CASE(INSTR_CONST): 
 			{
-				const char* s = bc_getstr(&vm->bc, offset);
+				const char* s = vm_bc_name(vm, offset);
 				var_t* v = vm_get_scope_var(vm);
-				node_t *node = var_find(v, s);
+				node_t *node = var_find_name(v, s);
 				if(node != NULL) { //find just in current scope
 					//_err("Error: let '");
 					//_err(s);
@@ -2590,15 +3397,15 @@ bool vm_run(vm_t* vm) {
 					vm_terminate(vm);
 				}
 				else {
-					node = var_add(v, s, NULL);
+					node = var_add_name(v, s, NULL);
 					if(node != NULL && instr == INSTR_CONST)
 						node->be_const = true;
 				}
 				break;
 			}
-			case INSTR_INT:
+			CASE(INSTR_INT):
 			{
-				var_t* v = var_new_int(vm, (int)code[vm->pc++]);
+				var_t* v = vm_int(vm, (int)code[vm->pc++]);
 				/*#ifdef MARIO_CACHE
 				if(try_cache(vm, &code[vm->pc-2], v))
 					code[vm->pc-1] = INSTR_NIL;
@@ -2607,17 +3414,17 @@ bool vm_run(vm_t* vm) {
 				vm_push(vm, v);
 				break;
 			}
-			case INSTR_INT_S:
+			CASE(INSTR_INT_S):
 			{
-				var_t* v = var_new_int(vm, offset);
+				var_t* v = vm_int(vm, offset);
 				/*#ifdef MARIO_CACHE
 				try_cache(vm, &code[vm->pc-1], v);
 				#endif
 				*/
 				vm_push(vm, v);
-				break;
+				NEXT();
 			}
-			case INSTR_FLOAT: 
+			CASE(INSTR_FLOAT): 
 			{
 				var_t* v = var_new_float(vm, *(float*)(&code[vm->pc++]));
 				/*#ifdef MARIO_CACHE
@@ -2628,7 +3435,7 @@ bool vm_run(vm_t* vm) {
 				vm_push(vm, v);
 				break;
 			}
-			case INSTR_STR: 
+			CASE(INSTR_STR): 
 			{
 				const char* s = bc_getstr(&vm->bc, offset);
 				var_t* v = var_new_str(vm, s);
@@ -2640,53 +3447,34 @@ bool vm_run(vm_t* vm) {
 				vm_push(vm, v);
 				break;
 			}
-			case INSTR_ASIGN: 
+			CASE(INSTR_ASIGN): 
 			{
 				var_t* v = vm_pop2(vm);
 				node_t* n = vm_pop2node(vm);
-				bool modi = (!n->be_const || n->var->type == V_UNDEF);
+				bool modi = node_modifiable(n);
 				var_unref(n->var);
-				if(modi) 
-					node_replace(n, v);
-				else {
-					//_err("Can not change a const variable: '");
-					//_err(n->name);
-					//_err("'!\n");
-				}
-
-				if((ins & INSTR_OPT_CACHE) == 0) {
-					if(OP(code[vm->pc]) != INSTR_POP) {
-						vm_push(vm, n->var);
-					}
-					else { 
-						code[vm->pc] = INSTR_NIL;
-						code[vm->pc-1] |= INSTR_OPT_CACHE;
-					}
-				}
-				else { //skip the nil if cached
-					vm->pc++;
-				}
+				vm_assign(vm, n, v, modi, ins);
 				var_unref(v);
 				break;
 			}
-			case INSTR_GET: 
+			CASE(INSTR_GET): 
 			{
-				const char* s = bc_getstr(&vm->bc, offset);
+				const char* s = vm_bc_name(vm, offset);
 				var_t* v = vm_pop2(vm);
 				var_build_basic_prototype(vm, v);
-				do_get(vm, v, s);
+				do_get(vm, v, s, &vm->icache[vm->pc-1]);
 				var_unref(v);
 				break;
 			}
-			case INSTR_NEW: 
+			CASE(INSTR_NEW): 
 			{
 				const char* s = bc_getstr(&vm->bc, offset);
 				if(!do_new(vm, s)) 
 					vm_terminate(vm);
 				break;
 			}
-			case INSTR_CALL: 
-			case INSTR_CALLO: 
+			CASE(INSTR_CALL): 
+			CASE(INSTR_CALLO): 
 			{
 				var_t* func = NULL;
 				var_t* obj = NULL;
@@ -2747,10 +3535,10 @@ bool vm_run(vm_t* vm) {
 				#endif
 				break;
 			}
-			case INSTR_MEMBER: 
-			case INSTR_MEMBERN: 
+			CASE(INSTR_MEMBER): 
+			CASE(INSTR_MEMBERN): 
 			{
-				const char* s = (instr == INSTR_MEMBER ? "" :  bc_getstr(&vm->bc, offset));
+				const char* s = (instr == INSTR_MEMBER ? "" :  vm_bc_name(vm, offset));
 				var_t* v = vm_pop2(vm);
 				if(v == NULL) 
 					v = var_new(vm);
@@ -2764,15 +3552,15 @@ bool vm_run(vm_t* vm) {
 						func_t* func = (func_t*)v->value;
 						func->owner = var;
 					}
-					var_add(var, s, v);
+					var_add_name(var, s, v);
 				}
 				var_unref(v);
 				break;
 			}
-			case INSTR_FUNC: 
-			case INSTR_FUNC_STC: 
-			case INSTR_FUNC_GET: 
-			case INSTR_FUNC_SET: 
+			CASE(INSTR_FUNC): 
+			CASE(INSTR_FUNC_STC): 
+			CASE(INSTR_FUNC_GET): 
+			CASE(INSTR_FUNC_SET): 
 			{
 				var_t* v = func_def(vm, 
 						(instr == INSTR_FUNC ? true:false),
@@ -2783,8 +3571,8 @@ bool vm_run(vm_t* vm) {
 				}
 				break;
 			}
-			case INSTR_OBJ:
-			case INSTR_ARRAY: 
+			CASE(INSTR_OBJ):
+			CASE(INSTR_ARRAY): 
 			{
 				var_t* obj;
 				if(instr == INSTR_OBJ) {
@@ -2797,19 +3585,29 @@ bool vm_run(vm_t* vm) {
 				vm_push_scope(vm, sc);
 				break;
 			}
-			case INSTR_ARRAY_END: 
-			case INSTR_OBJ_END: 
+			CASE(INSTR_ARRAY_END): 
+			CASE(INSTR_OBJ_END): 
 			{
 				var_t* obj = vm_get_scope_var(vm);
 				vm_push(vm, obj); //that actually means currentObj->ref() for push and unref for unasign.
 				vm_pop_scope(vm);
 				break;
 			}
-			case INSTR_ARRAY_AT: 
+			CASE(INSTR_ARRAY_AT): 
 			{
 				var_t* v2 = vm_pop2(vm);
 				var_t* v1 = vm_pop2(vm);
 				node_t* n = NULL;
+				if(v1->is_bytes && v2->type != V_STRING) { //read only, written by set()
+					uint32_t at = (uint32_t)var_get_int(v2);
+					if(at < v1->size)
+						vm_push(vm, vm_int(vm, ((uint8_t*)v1->value)[at]));
+					else
+						vm_push(vm, var_new(vm));
+					var_unref(v1);
+					var_unref(v2);
+					break;
+				}
 				if(v2->type == V_STRING) {
 					const char* s = var_get_str(v2);
 					n = var_find(v1, s);
@@ -2826,7 +3624,7 @@ bool vm_run(vm_t* vm) {
 				var_unref(v2);
 				break;
 			}
-			case INSTR_CLASS: 
+			CASE(INSTR_CLASS): 
 			{
 				const char* s =  bc_getstr(&vm->bc, offset);
 				var_t* cls_var = vm_new_class(vm, s);
@@ -2845,14 +3643,14 @@ bool vm_run(vm_t* vm) {
 				vm_push_scope(vm, sc);
 				break;
 			}
-			case INSTR_CLASS_END: 
+			CASE(INSTR_CLASS_END): 
 			{
 				var_t* var = vm_get_scope_var(vm);
 				vm_push(vm, var);
 				vm_pop_scope(vm);
 				break;
 			}
-			case INSTR_INSTOF: 
+			CASE(INSTR_INSTOF): 
 			{
 				var_t* v2 = vm_pop2(vm);
 				var_t* v1 = vm_pop2(vm);
@@ -2862,21 +3660,21 @@ bool vm_run(vm_t* vm) {
 				vm_push(vm, var_new_bool(vm, res));
 				break;
 			}
-			case INSTR_TYPEOF: 
+			CASE(INSTR_TYPEOF): 
 			{
 				var_t* var = vm_pop2(vm);
 				var_t* v = var_new_str(vm, get_typeof(var));
 				vm_push(vm, v);
 				break;
 			}
-			case INSTR_INCLUDE: 
+			CASE(INSTR_INCLUDE): 
 			{
 				var_t* v = vm_pop2(vm);
 				do_include(vm, var_get_str(v));
 				var_unref(v);
 				break;
 			}
-			case INSTR_THROW: 
+			CASE(INSTR_THROW): 
 			{
 				while(true) {
 					scope_t* sc = vm_get_scope(vm);
@@ -2893,7 +3691,7 @@ bool vm_run(vm_t* vm) {
 				}
 				break;
 			}
-			case INSTR_CATCH: 
+			CASE(INSTR_CATCH): 
 			{
 				const char* s = bc_getstr(&vm->bc, offset);
 				var_t* v = vm_pop2(vm);
@@ -2902,13 +3700,26 @@ bool vm_run(vm_t* vm) {
 				var_unref(v);
 				break;
 			}
+#ifdef MARIO_COMPUTED_GOTO
+			L_NOOP: //opcodes without handler
+				break;
+#endif
 		}
 		//gc(vm);
 	}
 	while(vm->pc < code_size && !vm->terminated);
+#ifdef MARIO_COMPUTED_GOTO
+L_END:
+#endif
 	return false;
 }
 
+#ifdef MARIO_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+#undef CASE
+#undef NEXT
+
 bool vm_load(vm_t* vm, const char* s) {
 	if(vm->compiler == NULL)
 		return false;
@@ -2920,6 +3731,24 @@ bool vm_load(vm_t* vm, const char* s) {
 	return vm->compiler(&vm->bc, s);
 }
 
+/*load bytecode cached in bc_fname if compiled from the same source,
+or compile it and write the cache(may fail on read only fs, ignored).*/
+bool vm_load_bc(vm_t* vm, const char* s, const char* bc_fname) {
+	uint32_t src_hash = bc_hash(BC_HASH_INIT, s, (uint32_t)strlen(s));
+	PC base_code = vm->bc.cindex;
+	uint32_t base_strs = vm->bc.str_table.size;
+
+	if(bc_load(&vm->bc, src_hash, bc_fname)) {
+		vm->pc = base_code;
+		return true;
+	}
+
+	if(!vm_load(vm, s))
+		return false;
+	bc_save(&vm->bc, base_code, base_strs, src_hash, bc_fname);
+	return true;
+}
+
 bool vm_load_run(vm_t* vm, const char* s) {
 	bool ret = false;
 	if(vm_load(vm, s)) {
@@ -2961,15 +3790,22 @@ void vm_close(vm_t* vm) {
 	if(vm->on_close != NULL)
 		vm->on_close(vm);
 
-	int i;
+	uint32_t i;
 	for(i=0; i<vm->close_natives.size; i++) {
 		native_init_t* it = (native_init_t*)array_get(&vm->close_natives, i);
 		it->func(it->data);
 	}
 	array_clean(&vm->close_natives, NULL);
+	vm->var_true->is_imm = vm->var_false->is_imm = vm->var_null->is_imm = 0;
 	var_unref(vm->var_true);
 	var_unref(vm->var_false);
 	var_unref(vm->var_null);
+	for(i=0; i<(VM_INT_MAX - VM_INT_MIN + 1); i++) {
+		if(vm->var_ints[i] != NULL) {
+			vm->var_ints[i]->is_imm = 0;
+			var_unref(vm->var_ints[i]);
+		}
+	}
 
 
 	#ifdef MARIO_THREAD
@@ -2990,8 +3826,18 @@ void vm_close(vm_t* vm) {
 	bc_release(&vm->bc);
 	vm->stack_top = 0;
 
-	gc_vars(vm); //try gc
+	uint32_t left;
+	do { //vars freed by a cycle may leave others to the next one.
+		left = vm->gc_young.num + vm->gc_old.num;
+		gc_vars(vm);
+	} while(vm->gc_young.num + vm->gc_old.num > 0 && vm->gc_young.num + vm->gc_old.num < left);
 	gc_free_vars(vm, 0);
+	if(vm->gc_marks != NULL)
+		free(vm->gc_marks);
+
+	if(vm->icache != NULL)
+		free(vm->icache);
+	vm_names_free(vm);
 	free(vm);
 }	
 
@@ -3179,6 +4025,63 @@ var_t* native_debug(vm_t* vm, var_t* env, void* data) {
 }
 
 /**yield */
+/** Bytes, byte array for binary data.-----------------------------*/
+
+static var_t* native_bytes_constructor(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	var_t* thisv = get_obj(env, THIS);
+	int size = get_int(env, "size");
+	if(thisv != NULL && !thisv->is_bytes)
+		var_set_bytes(thisv, NULL, size < 0 ? 0 : (uint32_t)size, false);
+	return thisv;
+}
+
+static var_t* native_bytes_get(vm_t* vm, var_t* env, void* data) {
+	(void)data;
+	var_t* thisv = get_obj(env, THIS);
+	uint32_t at = (uint32_t)get_int(env, "index");
+	if(thisv == NULL || !thisv->is_bytes || at >= thisv->size)
+		return NULL;
+	return var_new_int(vm, ((uint8_t*)thisv->value)[at]);
+}
+
+static var_t* native_bytes_set(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	var_t* thisv = get_obj(env, THIS);
+	uint32_t at = (uint32_t)get_int(env, "index");
+	if(thisv != NULL && thisv->is_bytes && at < thisv->size)
+		((uint8_t*)thisv->value)[at] = (uint8_t)get_int(env, "value");
+	return NULL;
+}
+
+static var_t* native_bytes_fill(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	var_t* thisv = get_obj(env, THIS);
+	if(thisv != NULL && thisv->is_bytes && thisv->size > 0)
+		memset(thisv->value, get_int(env, "value"), thisv->size);
+	return NULL;
+}
+
+//copy(src, to, from, size): copy size bytes of src at from to this at to, clipped to both.
+static var_t* native_bytes_copy(vm_t* vm, var_t* env, void* data) {
+	(void)vm; (void)data;
+	var_t* thisv = get_obj(env, THIS);
+	var_t* src = get_obj(env, "src");
+	uint32_t to = (uint32_t)get_int(env, "to");
+	uint32_t from = (uint32_t)get_int(env, "from");
+	uint32_t size = (uint32_t)get_int(env, "size");
+	if(thisv == NULL || src == NULL || !thisv->is_bytes || !src->is_bytes ||
+			to >= thisv->size || from >= src->size)
+		return NULL;
+
+	if(size > thisv->size - to)
+		size = thisv->size - to;
+	if(size > src->size - from)
+		size = src->size - from;
+	memmove((uint8_t*)thisv->value + to, (uint8_t*)src->value + from, size);
+	return NULL;
+}
+
 var_t* native_yield(vm_t* vm, var_t* env, void* data) {
 	(void)vm; (void)data; (void)env;
 	return NULL;
@@ -3188,12 +4091,16 @@ vm_t* vm_from(vm_t* vm) {
 	vm_t* ret = vm_new(vm->compiler);
 	ret->gc_buffer_size = vm->gc_buffer_size;
 	ret->gc_free_buffer_size = vm->gc_free_buffer_size;
+	ret->gc_step_size = vm->gc_step_size;
+	ret->gc_major_cycles = vm->gc_major_cycles;
   vm_init(ret, vm->on_init, vm->on_close);
 	return ret;
 }
 
 #define GC_BUFFER 128
 #define GC_FREE_BUFFER 128
+#define GC_STEP 256
+#define GC_MAJOR_CYCLES 8
 vm_t* vm_new(bool compiler(bytecode_t *bc, const char* input)) {
 	vm_t* vm = (vm_t*)malloc(sizeof(vm_t));
 	memset(vm, 0, sizeof(vm_t));
@@ -3204,11 +4111,20 @@ vm_t* vm_new(bool compiler(bytecode_t *bc, const char* input)) {
 	vm->this_strIndex = 0;
 	vm->gc_buffer_size = GC_BUFFER;
 	vm->gc_free_buffer_size = GC_FREE_BUFFER;
+	vm->gc_step_size = GC_STEP;
+	vm->gc_major_cycles = GC_MAJOR_CYCLES;
 	vm->stack_top = 0;
 
 	bc_init(&vm->bc);
 	vm->this_strIndex = bc_getstrindex(&vm->bc, THIS);
 
+	vm->name_this = vm_name(vm, THIS, true);
+	vm->name_prototype = vm_name(vm, PROTOTYPE, true);
+	vm->name_closure = vm_name(vm, CLOSURE, true);
+	vm->name_array = vm_name(vm, "_ARRAY_", true);
+	vm->name_length = vm_name(vm, "length", true);
+	vm->ic_epoch = 1;
+
 	vm->scopes = array_new();
 
 	#ifdef MARIO_CACHE
@@ -3233,16 +4149,28 @@ vm_t* vm_new(bool compiler(bytecode_t *bc, const char* input)) {
 	vm->var_true = var_new_bool(vm, true);
 	//var_add(vm->root, "", vm->var_true);
 	var_ref(vm->var_true);
+	vm->var_true->is_imm = 1;
 	vm->var_false = var_new_bool(vm, false);
 	//var_add(vm->root, "", vm->var_false);
 	var_ref(vm->var_false);
+	vm->var_false->is_imm = 1;
 	vm->var_null = var_new_null(vm);
 	//var_add(vm->root, "", vm->var_null);
 	var_ref(vm->var_null);
+	vm->var_null->is_imm = 1;
 
 	vm->var_Object = vm_new_class(vm, "Object");
 	vm_reg_static(vm, "", "yield()", native_yield, NULL);
 	vm_reg_static(vm, "", "debug()", native_debug, NULL);
+
+	vm->var_Bytes = vm_new_class(vm, "Bytes");
+	vm_reg_native(vm, "Bytes", "constructor(size)", native_bytes_constructor, NULL);
+	vm_reg_native(vm, "Bytes", "get(index)", native_bytes_get, NULL);
+	vm_reg_native(vm, "Bytes", "set(index, value)", native_bytes_set, NULL);
+	vm_reg_native(vm, "Bytes", "fill(value)", native_bytes_fill, NULL);
+	vm_reg_native(vm, "Bytes", "copy(src, to, from, size)", native_bytes_copy, NULL);
+
+	json_reg_natives(vm);
 	return vm;
 }
 
@@ -3255,7 +4183,7 @@ void vm_init(vm_t* vm,
 	if(vm->on_init != NULL)
 		vm->on_init(vm);
 
-	int i;
+	uint32_t i;
 	for(i=0; i<vm->init_natives.size; i++) {
 		native_init_t* it = (native_init_t*)array_get(&vm->init_natives, i);
 		it->func(it->data);
@@ -6,8 +6,11 @@ enum {
 	SHM_PUBLIC
 };
 
+#define SHM_RDONLY 0x2 //flag bit: read only for processes other than the owner
+
 int   shm_alloc(unsigned int size, int flag);
 void* shm_map(int shmid);
 int   shm_unmap(int shmid);
+int   shm_id(void* addr);
 
 #endif
@@ -18,7 +18,8 @@ typedef struct {
 	int (*read_block)(int from_pid, void* buf, int size, int index, void* p);
 	int (*write_block)(int from_pid, const void* buf, int size, int index, void* p);
 	int (*dma)(int fd, int from_pid, fsinfo_t* info, int* size, void* p);
-	int (*flush)(int fd, int from_pid, fsinfo_t* info, void* p);
+	int (*flush)(int fd, int from_pid, fsinfo_t* info, const void* data, int size, void* p);
+	int (*mmap)(int fd, int from_pid, fsinfo_t* info, int prot, int* size, void* p);
 	int (*fcntl)(int fd, int from_pid, fsinfo_t* info, int cmd, proto_t* in, proto_t* out, void* p);
 	int (*mount)(fsinfo_t* mnt_point, void* p);
 	int (*umount)(fsinfo_t* mnt_point, void* p);
@@ -12,3 +12,7 @@ void* shm_map(int shmid) {
 int shm_unmap(int shmid) {
 	return syscall1(SYS_PROC_SHM_UNMAP, shmid);
 }
+
+int shm_id(void* addr) {
+	return syscall1(SYS_PROC_SHM_ID, (int)addr);
+}
@@ -214,6 +214,27 @@ static void do_dma(vdevice_t* dev, int from_pid, proto_t *in, void* p) {
 	proto_clear(&out);
 }
 
+static void do_mmap(vdevice_t* dev, int from_pid, proto_t *in, void* p) {
+	fsinfo_t info;
+	int fd = proto_read_int(in);
+	memcpy(&info, proto_read(in, NULL), sizeof(fsinfo_t));
+	int prot = proto_read_int(in);
+
+	proto_t out;
+	proto_init(&out, NULL, 0);
+
+	int id = -1;	
+	int size = 0;
+	if(dev != NULL && dev->mmap != NULL) {
+		id = dev->mmap(fd, from_pid, &info, prot, &size, p);
+	}
+	proto_add_int(&out, id);
+	proto_add_int(&out, size);
+
+	ipc_set_return(&out);
+	proto_clear(&out);
+}
+
 static void do_fcntl(vdevice_t* dev, int from_pid, proto_t *in, void* p) {
 	fsinfo_t info;
 	int fd = proto_read_int(in);
@@ -247,9 +268,11 @@ static void do_flush(vdevice_t* dev, int from_pid, proto_t *in, void* p) {
 	fsinfo_t info;
 	int fd = proto_read_int(in);
 	memcpy(&info, proto_read(in, NULL), sizeof(fsinfo_t));
+	int32_t size = 0;
+	void* data = proto_read(in, &size); //optional, device specific (e.g. dirty rects)
 
 	if(dev != NULL && dev->flush != NULL) {
-		dev->flush(fd, from_pid, &info, p);
+		dev->flush(fd, from_pid, &info, data, size, p);
 	}
 
 	proto_t out;
@@ -282,8 +305,8 @@ static void do_create(vdevice_t* dev, int from_pid, proto_t *in, void* p) {
 
 static void do_unlink(vdevice_t* dev, int from_pid, proto_t *in, void* p) {
 	(void)from_pid;
-	fsinfo_t info_to, info;
-	proto_read_to(in, &info_to, sizeof(fsinfo_t));
+	fsinfo_t info;
+	proto_read_to(in, &info, sizeof(fsinfo_t));
 	const char* fname = proto_read_str(in);
 
 	int res = 0;
@@ -367,6 +390,9 @@ static void handle(int from_pid, int cmd, void* p) {
 	case FS_CMD_FLUSH:
 		do_flush(dev, from_pid, in, p);
 		break;
+	case FS_CMD_MMAP:
+		do_mmap(dev, from_pid, in, p);
+		break;
 	case FS_CMD_CNTL:
 		do_fcntl(dev, from_pid, in, p);
 		break;
@@ -52,6 +52,12 @@ freely, subject to the following restrictions:
 #define CODE_LENGTH_BITLEN 7
 #define MAX_BIT_LENGTH 15 /* largest bitlen used by any tree type */
 
+#define FAST_BITS 9 /* codes up to this length are decoded with one table lookup */
+#define FAST_SIZE (1 << FAST_BITS)
+#define FAST_MASK (FAST_SIZE - 1)
+
+#define IDAT_PADDING 8 /* zero bytes after the compressed data so bits can be peeked a word at a time */
+
 #define DEFLATE_CODE_BUFFER_SIZE (NUM_DEFLATE_CODE_SYMBOLS * 2)
 #define DISTANCE_BUFFER_SIZE (NUM_DISTANCE_SYMBOLS * 2)
 #define CODE_LENGTH_BUFFER_SIZE (NUM_DISTANCE_SYMBOLS * 2)
@@ -82,6 +88,14 @@ typedef struct upng_source {
 	char					owning;
 } upng_source;
 
+/*row streaming: each scanline is unfiltered and converted into dst as soon as inflate has produced it*/
+typedef struct upng_sink {
+	graph_t*		dst;
+	unsigned char*	lines[2];	/*current and previous unfiltered scanline, unless dst can hold them */
+	unsigned		row;		/*next row to emit */
+	unsigned long	row_end;	/*inflated size at which that row is complete */
+} upng_sink;
+
 struct upng_t {
 	unsigned		width;
 	unsigned		height;
@@ -98,10 +112,12 @@ struct upng_t {
 
 	upng_state		state;
 	upng_source		source;
+	upng_sink		sink;
 };
 
 typedef struct huffman_tree {
 	unsigned* tree2d;
+	unsigned short* fast;	/*FAST_SIZE entries of (symbol << 4 | length) indexed by the next FAST_BITS input bits, 0 for longer codes */
 	unsigned maxbitlen;	/*maximum number of bits a single code can get */
 	unsigned numcodes;	/*number of symbols in the alphabet = number of codes */
 } huffman_tree;
@@ -129,53 +145,6 @@ static const unsigned DISTANCE_EXTRA[30] = {	/*the extra bits of backwards dista
 static const unsigned CLCL[NUM_CODE_LENGTH_CODES]	/*the order in which "code length alphabet code lengths" are stored, out of this the huffman tree of the dynamic huffman tree lengths is generated */
 = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
 
-static const unsigned FIXED_DEFLATE_CODE_TREE[NUM_DEFLATE_CODE_SYMBOLS * 2] = {
-	289, 370, 290, 307, 546, 291, 561, 292, 293, 300, 294, 297, 295, 296, 0, 1,
-	2, 3, 298, 299, 4, 5, 6, 7, 301, 304, 302, 303, 8, 9, 10, 11, 305, 306, 12,
-	13, 14, 15, 308, 339, 309, 324, 310, 317, 311, 314, 312, 313, 16, 17, 18,
-	19, 315, 316, 20, 21, 22, 23, 318, 321, 319, 320, 24, 25, 26, 27, 322, 323,
-	28, 29, 30, 31, 325, 332, 326, 329, 327, 328, 32, 33, 34, 35, 330, 331, 36,
-	37, 38, 39, 333, 336, 334, 335, 40, 41, 42, 43, 337, 338, 44, 45, 46, 47,
-	340, 355, 341, 348, 342, 345, 343, 344, 48, 49, 50, 51, 346, 347, 52, 53,
-	54, 55, 349, 352, 350, 351, 56, 57, 58, 59, 353, 354, 60, 61, 62, 63, 356,
-	363, 357, 360, 358, 359, 64, 65, 66, 67, 361, 362, 68, 69, 70, 71, 364,
-	367, 365, 366, 72, 73, 74, 75, 368, 369, 76, 77, 78, 79, 371, 434, 372,
-	403, 373, 388, 374, 381, 375, 378, 376, 377, 80, 81, 82, 83, 379, 380, 84,
-	85, 86, 87, 382, 385, 383, 384, 88, 89, 90, 91, 386, 387, 92, 93, 94, 95,
-	389, 396, 390, 393, 391, 392, 96, 97, 98, 99, 394, 395, 100, 101, 102, 103,
-	397, 400, 398, 399, 104, 105, 106, 107, 401, 402, 108, 109, 110, 111, 404,
-	419, 405, 412, 406, 409, 407, 408, 112, 113, 114, 115, 410, 411, 116, 117,
-	118, 119, 413, 416, 414, 415, 120, 121, 122, 123, 417, 418, 124, 125, 126,
-	127, 420, 427, 421, 424, 422, 423, 128, 129, 130, 131, 425, 426, 132, 133,
-	134, 135, 428, 431, 429, 430, 136, 137, 138, 139, 432, 433, 140, 141, 142,
-	143, 435, 483, 436, 452, 568, 437, 438, 445, 439, 442, 440, 441, 144, 145,
-	146, 147, 443, 444, 148, 149, 150, 151, 446, 449, 447, 448, 152, 153, 154,
-	155, 450, 451, 156, 157, 158, 159, 453, 468, 454, 461, 455, 458, 456, 457,
-	160, 161, 162, 163, 459, 460, 164, 165, 166, 167, 462, 465, 463, 464, 168,
-	169, 170, 171, 466, 467, 172, 173, 174, 175, 469, 476, 470, 473, 471, 472,
-	176, 177, 178, 179, 474, 475, 180, 181, 182, 183, 477, 480, 478, 479, 184,
-	185, 186, 187, 481, 482, 188, 189, 190, 191, 484, 515, 485, 500, 486, 493,
-	487, 490, 488, 489, 192, 193, 194, 195, 491, 492, 196, 197, 198, 199, 494,
-	497, 495, 496, 200, 201, 202, 203, 498, 499, 204, 205, 206, 207, 501, 508,
-	502, 505, 503, 504, 208, 209, 210, 211, 506, 507, 212, 213, 214, 215, 509,
-	512, 510, 511, 216, 217, 218, 219, 513, 514, 220, 221, 222, 223, 516, 531,
-	517, 524, 518, 521, 519, 520, 224, 225, 226, 227, 522, 523, 228, 229, 230,
-	231, 525, 528, 526, 527, 232, 233, 234, 235, 529, 530, 236, 237, 238, 239,
-	532, 539, 533, 536, 534, 535, 240, 241, 242, 243, 537, 538, 244, 245, 246,
-	247, 540, 543, 541, 542, 248, 249, 250, 251, 544, 545, 252, 253, 254, 255,
-	547, 554, 548, 551, 549, 550, 256, 257, 258, 259, 552, 553, 260, 261, 262,
-	263, 555, 558, 556, 557, 264, 265, 266, 267, 559, 560, 268, 269, 270, 271,
-	562, 565, 563, 564, 272, 273, 274, 275, 566, 567, 276, 277, 278, 279, 569,
-	572, 570, 571, 280, 281, 282, 283, 573, 574, 284, 285, 286, 287, 0, 0
-};
-
-static const unsigned FIXED_DISTANCE_TREE[NUM_DISTANCE_SYMBOLS * 2] = {
-	33, 48, 34, 41, 35, 38, 36, 37, 0, 1, 2, 3, 39, 40, 4, 5, 6, 7, 42, 45, 43,
-	44, 8, 9, 10, 11, 46, 47, 12, 13, 14, 15, 49, 56, 50, 53, 51, 52, 16, 17,
-	18, 19, 54, 55, 20, 21, 22, 23, 57, 60, 58, 59, 24, 25, 26, 27, 61, 62, 28,
-	29, 30, 31, 0, 0
-};
-
 static unsigned char read_bit(unsigned long *bitpointer, const unsigned char *bitstream)
 {
 	unsigned char result = (unsigned char)((bitstream[(*bitpointer) >> 3] >> ((*bitpointer) & 0x7)) & 1);
@@ -183,28 +152,56 @@ static unsigned char read_bit(unsigned long *bitpointer, const unsigned char *bi
 	return result;
 }
 
+/*next 25+ bits at the bit pointer, lsb first; the stream is padded with IDAT_PADDING bytes*/
+static inline unsigned peek_bits(unsigned long bitpointer, const unsigned char *bitstream)
+{
+	const unsigned char* p = bitstream + (bitpointer >> 3);
+	unsigned v = (unsigned)p[0] | ((unsigned)p[1] << 8) | ((unsigned)p[2] << 16) | ((unsigned)p[3] << 24);
+	return v >> (bitpointer & 0x7);
+}
+
 static unsigned read_bits(unsigned long *bitpointer, const unsigned char *bitstream, unsigned long nbits)
 {
-	unsigned result = 0, i;
-	for (i = 0; i < nbits; i++)
-		result |= ((unsigned)read_bit(bitpointer, bitstream)) << i;
+	unsigned result = peek_bits(*bitpointer, bitstream) & ((1u << nbits) - 1);
+	(*bitpointer) += nbits;
 	return result;
 }
 
-/* the buffer must be numcodes*2 in size! */
-static void huffman_tree_init(huffman_tree* tree, unsigned* buffer, unsigned numcodes, unsigned maxbitlen)
+/* the buffer must be numcodes*2 in size, fast must be FAST_SIZE or NULL! */
+static void huffman_tree_init(huffman_tree* tree, unsigned* buffer, unsigned short* fast, unsigned numcodes, unsigned maxbitlen)
 {
 	tree->tree2d = buffer;
+	tree->fast = fast;
 
 	tree->numcodes = numcodes;
 	tree->maxbitlen = maxbitlen;
 }
 
+/*fill the lookup table: deflate sends codes msb first, the table is indexed by bits read lsb first*/
+static void huffman_tree_create_fast(huffman_tree* tree, const unsigned *tree1d, const unsigned *bitlen)
+{
+	unsigned n, i;
+	memset(tree->fast, 0, FAST_SIZE * sizeof(unsigned short));
+	for (n = 0; n < tree->numcodes; n++) {
+		unsigned len = bitlen[n];
+		unsigned rev = 0;
+		if (len == 0 || len > FAST_BITS) {
+			continue;
+		}
+		for (i = 0; i < len; i++) {
+			rev |= ((tree1d[n] >> i) & 1) << (len - i - 1);
+		}
+		for (i = rev; i < FAST_SIZE; i += (1u << len)) {
+			tree->fast[i] = (unsigned short)((n << 4) | len);
+		}
+	}
+}
+
 /*given the code lengths (as stored in the PNG file), generate the tree as defined by Deflate. maxbitlen is the maximum bits that a code in the tree can have. return value is error.*/
 static void huffman_tree_create_lengths(upng_t* upng, huffman_tree* tree, const unsigned *bitlen)
 {
 	unsigned tree1d[MAX_SYMBOLS];
-	unsigned blcount[MAX_BIT_LENGTH];
+	unsigned blcount[MAX_BIT_LENGTH+1];
 	unsigned nextcode[MAX_BIT_LENGTH+1];
 	unsigned bits, n, i;
 	unsigned nodefilled = 0;	/*up to which node it is filled */
@@ -216,8 +213,13 @@ static void huffman_tree_create_lengths(upng_t* upng, huffman_tree* tree, const
 
 	/*step 1: count number of instances of each code length */
 	for (bits = 0; bits < tree->numcodes; bits++) {
+		if (bitlen[bits] > tree->maxbitlen) {
+			SET_ERROR(upng, UPNG_EMALFORMED);
+			return;
+		}
 		blcount[bitlen[bits]]++;
 	}
+	blcount[0] = 0;
 
 	/*step 2: generate the nextcode values */
 	for (bits = 1; bits <= tree->maxbitlen; bits++) {
@@ -266,12 +268,26 @@ static void huffman_tree_create_lengths(upng_t* upng, huffman_tree* tree, const
 			tree->tree2d[n] = 0;	/*remove possible remaining 32767's */
 		}
 	}
+
+	if (tree->fast != NULL) {
+		huffman_tree_create_fast(tree, tree1d, bitlen);
+	}
 }
 
 static unsigned huffman_decode_symbol(upng_t *upng, const unsigned char *in, unsigned long *bp, const huffman_tree* codetree, unsigned long inlength)
 {
 	unsigned treepos = 0, ct;
 	unsigned char bit;
+
+	if (codetree->fast != NULL && ((*bp) >> 3) < inlength) {
+		unsigned e = codetree->fast[peek_bits(*bp, in) & FAST_MASK];
+		if (e != 0) {
+			(*bp) += e & 0xf;
+			return e >> 4;
+		}
+	}
+
+	/*long code, walk the tree bit by bit */
 	for (;;) {
 		/* error: end of input memory reached without endcode */
 		if (((*bp) & 0x07) == 0 && ((*bp) >> 3) > inlength) {
@@ -449,11 +465,48 @@ static void get_tree_inflate_dynamic(upng_t* upng, huffman_tree* codetree, huffm
 	}
 }
 
+static unsigned fixed_tree_buffer[DEFLATE_CODE_BUFFER_SIZE];
+static unsigned fixed_treeD_buffer[DISTANCE_BUFFER_SIZE];
+static unsigned short fixed_fast[FAST_SIZE];
+static unsigned short fixed_fastD[FAST_SIZE];
+static int fixed_trees_built = 0;
+
+/*the fixed trees of btype 1, generated from their code lengths once*/
+static void get_tree_inflate_fixed(upng_t* upng, huffman_tree* codetree, huffman_tree* codetreeD)
+{
+	unsigned bitlen[NUM_DEFLATE_CODE_SYMBOLS];
+	unsigned bitlenD[NUM_DISTANCE_SYMBOLS];
+	unsigned i;
+
+	huffman_tree_init(codetree, fixed_tree_buffer, fixed_fast, NUM_DEFLATE_CODE_SYMBOLS, DEFLATE_CODE_BITLEN);
+	huffman_tree_init(codetreeD, fixed_treeD_buffer, fixed_fastD, NUM_DISTANCE_SYMBOLS, DISTANCE_BITLEN);
+	if (fixed_trees_built != 0) {
+		return;
+	}
+
+	for (i = 0; i < NUM_DEFLATE_CODE_SYMBOLS; i++) {
+		bitlen[i] = i <= 143 ? 8 : (i <= 255 ? 9 : (i <= 279 ? 7 : 8));
+	}
+	for (i = 0; i < NUM_DISTANCE_SYMBOLS; i++) {
+		bitlenD[i] = 5;
+	}
+	huffman_tree_create_lengths(upng, codetree, bitlen);
+	huffman_tree_create_lengths(upng, codetreeD, bitlenD);
+	if (upng->error == UPNG_EOK) {
+		fixed_trees_built = 1;
+	}
+}
+
+/*emit the scanlines inflate has completed up to pos*/
+static void upng_sink_rows(upng_t* upng, const unsigned char* out, unsigned long pos);
+
 /*inflate a block with dynamic of fixed Huffman tree*/
 static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outsize, const unsigned char *in, unsigned long *bp, unsigned long *pos, unsigned long inlength, unsigned btype)
 {
 	unsigned codetree_buffer[DEFLATE_CODE_BUFFER_SIZE];
 	unsigned codetreeD_buffer[DISTANCE_BUFFER_SIZE];
+	unsigned short fast[FAST_SIZE];
+	unsigned short fastD[FAST_SIZE];
 	unsigned done = 0;
 
 	huffman_tree codetree;
@@ -461,18 +514,21 @@ static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outs
 
 	if (btype == 1) {
 		/* fixed trees */
-		huffman_tree_init(&codetree, (unsigned*)FIXED_DEFLATE_CODE_TREE, NUM_DEFLATE_CODE_SYMBOLS, DEFLATE_CODE_BITLEN);
-		huffman_tree_init(&codetreeD, (unsigned*)FIXED_DISTANCE_TREE, NUM_DISTANCE_SYMBOLS, DISTANCE_BITLEN);
+		get_tree_inflate_fixed(upng, &codetree, &codetreeD);
 	} else if (btype == 2) {
 		/* dynamic trees */
 		unsigned codelengthcodetree_buffer[CODE_LENGTH_BUFFER_SIZE];
+		unsigned short fastCL[FAST_SIZE];
 		huffman_tree codelengthcodetree;
 
-		huffman_tree_init(&codetree, codetree_buffer, NUM_DEFLATE_CODE_SYMBOLS, DEFLATE_CODE_BITLEN);
-		huffman_tree_init(&codetreeD, codetreeD_buffer, NUM_DISTANCE_SYMBOLS, DISTANCE_BITLEN);
-		huffman_tree_init(&codelengthcodetree, codelengthcodetree_buffer, NUM_CODE_LENGTH_CODES, CODE_LENGTH_BITLEN);
+		huffman_tree_init(&codetree, codetree_buffer, fast, NUM_DEFLATE_CODE_SYMBOLS, DEFLATE_CODE_BITLEN);
+		huffman_tree_init(&codetreeD, codetreeD_buffer, fastD, NUM_DISTANCE_SYMBOLS, DISTANCE_BITLEN);
+		huffman_tree_init(&codelengthcodetree, codelengthcodetree_buffer, fastCL, NUM_CODE_LENGTH_CODES, CODE_LENGTH_BITLEN);
 		get_tree_inflate_dynamic(upng, &codetree, &codetreeD, &codelengthcodetree, in, bp, inlength);
 	}
+	if (upng->error != UPNG_EOK) {
+		return;
+	}
 
 	while (done == 0) {
 		unsigned code = huffman_decode_symbol(upng, in, bp, &codetree, inlength);
@@ -492,11 +548,16 @@ static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outs
 
 			/* store output */
 			out[(*pos)++] = (unsigned char)(code);
+			if ((*pos) >= upng->sink.row_end) {
+				upng_sink_rows(upng, out, *pos);
+			}
 		} else if (code >= FIRST_LENGTH_CODE_INDEX && code <= LAST_LENGTH_CODE_INDEX) {	/*length code */
 			/* part 1: get length base */
 			unsigned long length = LENGTH_BASE[code - FIRST_LENGTH_CODE_INDEX];
 			unsigned codeD, distance, numextrabitsD;
-			unsigned long start, forward, backward, numextrabits;
+			unsigned long forward, numextrabits;
+			unsigned char* dst;
+			const unsigned char* src;
 
 			/* part 2: get extra bits and add the value of that to length */
 			numextrabits = LENGTH_EXTRA[code - FIRST_LENGTH_CODE_INDEX];
@@ -534,22 +595,25 @@ static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outs
 			distance += read_bits(bp, in, numextrabitsD);
 
 			/*part 5: fill in all the out[n] values based on the length and dist */
-			start = (*pos);
-			backward = start - distance;
-
-			if ((*pos) + length >= outsize) {
+			if ((*pos) + length >= outsize || distance > (*pos)) {
 				SET_ERROR(upng, UPNG_EMALFORMED);
 				return;
 			}
 
-			for (forward = 0; forward < length; forward++) {
-				out[(*pos)++] = out[backward];
-				backward++;
-
-				if (backward >= start) {
-					backward = start - distance;
+			dst = out + (*pos);
+			src = dst - distance;
+			if (distance >= length) {
+				memcpy(dst, src, length);
+			} else {
+				/*overlapping: byte order repeats the last distance bytes */
+				for (forward = 0; forward < length; forward++) {
+					dst[forward] = src[forward];
 				}
 			}
+			(*pos) += length;
+			if ((*pos) >= upng->sink.row_end) {
+				upng_sink_rows(upng, out, *pos);
+			}
 		}
 	}
 }
@@ -557,7 +621,7 @@ static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outs
 static void inflate_uncompressed(upng_t* upng, unsigned char* out, unsigned long outsize, const unsigned char *in, unsigned long *bp, unsigned long *pos, unsigned long inlength)
 {
 	unsigned long p;
-	unsigned len, nlen, n;
+	unsigned len, nlen;
 
 	/* go to first boundary of byte */
 	while (((*bp) & 0x7) != 0) {
@@ -593,8 +657,11 @@ static void inflate_uncompressed(upng_t* upng, unsigned char* out, unsigned long
 		return;
 	}
 
-	for (n = 0; n < len; n++) {
-		out[(*pos)++] = in[p++];
+	memcpy(out + (*pos), in + p, len);
+	(*pos) += len;
+	p += len;
+	if ((*pos) >= upng->sink.row_end) {
+		upng_sink_rows(upng, out, *pos);
 	}
 
 	(*bp) = p * 8;
@@ -619,7 +686,7 @@ static upng_error uz_inflate_data(upng_t* upng, unsigned char* out, unsigned lon
 
 		/* read block control bits */
 		done = read_bit(&bp, &in[inpos]);
-		btype = read_bit(&bp, &in[inpos]) | (read_bit(&bp, &in[inpos]) << 1);
+		btype = read_bits(&bp, &in[inpos], 2);	/*two reads in one expression would be unsequenced */
 
 		/* process control type appropriateyly */
 		if (btype == 3) {
@@ -830,6 +897,64 @@ static void post_process_scanlines(upng_t* upng, unsigned char *out, unsigned ch
 	}
 }
 
+/*expand one unfiltered scanline to graph pixels*/
+static void convert_row(upng_t* upng, uint32_t* dst, const unsigned char* line)
+{
+	unsigned x;
+	switch (upng->format) {
+	case UPNG_RGB8:
+		for (x = 0; x < upng->width; x++, line += 3)
+			dst[x] = argb(0xff, line[0], line[1], line[2]);
+		break;
+	case UPNG_LUMINANCE8:
+		for (x = 0; x < upng->width; x++)
+			dst[x] = argb(0xff, line[x], line[x], line[x]);
+		break;
+	case UPNG_LUMINANCE_ALPHA8:
+		for (x = 0; x < upng->width; x++, line += 2)
+			dst[x] = argb(line[1], line[0], line[0], line[0]);
+		break;
+	default:
+		break;
+	}
+}
+
+static void upng_sink_rows(upng_t* upng, const unsigned char* out, unsigned long pos)
+{
+	upng_sink* sink = &upng->sink;
+	unsigned bpp = upng_get_bpp(upng);
+	unsigned long bytewidth = (bpp + 7) / 8;
+	unsigned long linebytes = (upng->width * bpp + 7) / 8;
+
+	while (pos >= sink->row_end) {
+		const unsigned char* scanline = out + sink->row_end - linebytes - 1;
+		uint32_t* dst = sink->dst->buffer + sink->row * upng->width;
+		unsigned char* recon;
+		const unsigned char* precon;
+
+		if (upng->format == UPNG_RGBA8) {
+			/*same byte order as the graph buffer, unfilter straight into it */
+			recon = (unsigned char*)dst;
+			precon = sink->row > 0 ? recon - upng->width * 4 : NULL;
+		} else {
+			recon = sink->lines[sink->row & 1];
+			precon = sink->row > 0 ? sink->lines[(sink->row + 1) & 1] : NULL;
+		}
+
+		unfilter_scanline(upng, recon, scanline + 1, precon, bytewidth, scanline[0], linebytes);
+		if (upng->error != UPNG_EOK) {
+			sink->row_end = ULONG_MAX;
+			return;
+		}
+		if (upng->format != UPNG_RGBA8) {
+			convert_row(upng, dst, recon);
+		}
+
+		sink->row++;
+		sink->row_end = (sink->row < upng->height) ? sink->row_end + linebytes + 1 : ULONG_MAX;
+	}
+}
+
 static upng_format determine_format(upng_t* upng) {
 	switch (upng->color_type) {
 	case UPNG_LUM:
@@ -960,38 +1085,12 @@ upng_error upng_header(upng_t* upng)
 	return upng->error;
 }
 
-/*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-upng_error upng_decode(upng_t* upng)
+/*concatenate the payload of all IDAT chunks, followed by IDAT_PADDING zero bytes*/
+static unsigned char* upng_read_idat(upng_t* upng, unsigned long* size)
 {
 	const unsigned char *chunk;
 	unsigned char* compressed;
-	unsigned char* inflated;
 	unsigned long compressed_size = 0, compressed_index = 0;
-	unsigned long inflated_size;
-	upng_error error;
-
-	/* if we have an error state, bail now */
-	if (upng->error != UPNG_EOK) {
-		return upng->error;
-	}
-
-	/* parse the main header, if necessary */
-	upng_header(upng);
-	if (upng->error != UPNG_EOK) {
-		return upng->error;
-	}
-
-	/* if the state is not HEADER (meaning we are ready to decode the image), stop now */
-	if (upng->state != UPNG_HEADER) {
-		return upng->error;
-	}
-
-	/* release old result, if any */
-	if (upng->buffer != 0) {
-		free(upng->buffer);
-		upng->buffer = 0;
-		upng->size = 0;
-	}
 
 	/* first byte of the first chunk after the header */
 	chunk = upng->source.buffer + 33;
@@ -1000,30 +1099,26 @@ upng_error upng_decode(upng_t* upng)
 	 * verify general well-formed-ness */
 	while (chunk < upng->source.buffer + upng->source.size) {
 		unsigned long length;
-		//const unsigned char *data;	/*the data in the chunk */
 
 		/* make sure chunk header is not larger than the total compressed */
 		if ((unsigned long)(chunk - upng->source.buffer + 12) > upng->source.size) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
-			return upng->error;
+			return NULL;
 		}
 
 		/* get length; sanity check it */
 		length = upng_chunk_length(chunk);
 		if (length > INT_MAX) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
-			return upng->error;
+			return NULL;
 		}
 
 		/* make sure chunk header+paylaod is not larger than the total compressed */
 		if ((unsigned long)(chunk - upng->source.buffer + length + 12) > upng->source.size) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
-			return upng->error;
+			return NULL;
 		}
 
-		/* get pointer to payload */
-		//data = chunk + 8;
-
 		/* parse chunks */
 		if (upng_chunk_type(chunk) == CHUNK_IDAT) {
 			compressed_size += length;
@@ -1031,17 +1126,17 @@ upng_error upng_decode(upng_t* upng)
 			break;
 		} else if (upng_chunk_critical(chunk)) {
 			SET_ERROR(upng, UPNG_EUNSUPPORTED);
-			return upng->error;
+			return NULL;
 		}
 
 		chunk += upng_chunk_length(chunk) + 12;
 	}
 
 	/* allocate enough space for the (compressed and filtered) image data */
-	compressed = (unsigned char*)malloc(compressed_size);
+	compressed = (unsigned char*)malloc(compressed_size + IDAT_PADDING);
 	if (compressed == NULL) {
 		SET_ERROR(upng, UPNG_ENOMEM);
-		return upng->error;
+		return NULL;
 	}
 
 	/* scan through the chunks again, this time copying the values into
@@ -1064,6 +1159,48 @@ upng_error upng_decode(upng_t* upng)
 
 		chunk += upng_chunk_length(chunk) + 12;
 	}
+	memset(compressed + compressed_size, 0, IDAT_PADDING);
+
+	*size = compressed_size;
+	return compressed;
+}
+
+/*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
+upng_error upng_decode(upng_t* upng)
+{
+	unsigned char* compressed;
+	unsigned char* inflated;
+	unsigned long compressed_size = 0;
+	unsigned long inflated_size;
+	upng_error error;
+
+	/* if we have an error state, bail now */
+	if (upng->error != UPNG_EOK) {
+		return upng->error;
+	}
+
+	/* parse the main header, if necessary */
+	upng_header(upng);
+	if (upng->error != UPNG_EOK) {
+		return upng->error;
+	}
+
+	/* if the state is not HEADER (meaning we are ready to decode the image), stop now */
+	if (upng->state != UPNG_HEADER) {
+		return upng->error;
+	}
+
+	/* release old result, if any */
+	if (upng->buffer != 0) {
+		free(upng->buffer);
+		upng->buffer = 0;
+		upng->size = 0;
+	}
+
+	compressed = upng_read_idat(upng, &compressed_size);
+	if (compressed == NULL) {
+		return upng->error;
+	}
 
 	/* allocate space to store inflated (but still filtered) data */
 	inflated_size = ((upng->width * (upng->height * upng_get_bpp(upng) + 7)) / 8) + upng->height;
@@ -1113,6 +1250,75 @@ upng_error upng_decode(upng_t* upng)
 	return upng->error;
 }
 
+/*decode straight into a new graph: scanlines are unfiltered and converted
+while inflating, no intermediate image buffer. 8 bit formats only.*/
+graph_t* upng_decode_graph(upng_t* upng)
+{
+	unsigned char* compressed;
+	unsigned char* inflated;
+	unsigned long compressed_size = 0;
+	unsigned long inflated_size, linebytes;
+	graph_t* img;
+
+	upng_header(upng);
+	if (upng->error != UPNG_EOK || upng->state != UPNG_HEADER) {
+		return NULL;
+	}
+
+	if (upng->format != UPNG_RGBA8 && upng->format != UPNG_RGB8 &&
+			upng->format != UPNG_LUMINANCE8 && upng->format != UPNG_LUMINANCE_ALPHA8) {
+		SET_ERROR(upng, UPNG_EUNFORMAT);
+		return NULL;
+	}
+
+	if (upng->width == 0 || upng->height == 0) {
+		SET_ERROR(upng, UPNG_EMALFORMED);
+		return NULL;
+	}
+
+	compressed = upng_read_idat(upng, &compressed_size);
+	if (compressed == NULL) {
+		return NULL;
+	}
+
+	linebytes = (upng->width * upng_get_bpp(upng) + 7) / 8;
+	inflated_size = (linebytes + 1) * upng->height + 1;
+	inflated = (unsigned char*)malloc(inflated_size);
+	img = graph_new(NULL, upng->width, upng->height);
+	if (upng->format != UPNG_RGBA8) {
+		upng->sink.lines[0] = (unsigned char*)malloc(linebytes * 2);
+		upng->sink.lines[1] = upng->sink.lines[0] + linebytes;
+	}
+
+	if (inflated == NULL || img == NULL || img->buffer == NULL ||
+			(upng->format != UPNG_RGBA8 && upng->sink.lines[0] == NULL)) {
+		SET_ERROR(upng, UPNG_ENOMEM);
+	} else {
+		upng->sink.dst = img;
+		upng->sink.row = 0;
+		upng->sink.row_end = linebytes + 1;
+		uz_inflate(upng, inflated, inflated_size, compressed, compressed_size);
+		if (upng->error == UPNG_EOK && upng->sink.row != upng->height) {
+			SET_ERROR(upng, UPNG_EMALFORMED);
+		}
+	}
+
+	free(compressed);
+	free(inflated);
+	free(upng->sink.lines[0]);
+	memset(&upng->sink, 0, sizeof(upng_sink));
+	upng->sink.row_end = ULONG_MAX;
+
+	if (upng->error != UPNG_EOK) {
+		graph_free(img);
+		return NULL;
+	}
+
+	upng->state = UPNG_DECODED;
+	upng_free_source(upng);
+	return img;
+}
+
 static upng_t* upng_new(void)
 {
 	upng_t* upng;
@@ -1140,6 +1346,9 @@ static upng_t* upng_new(void)
 	upng->source.size = 0;
 	upng->source.owning = 0;
 
+	memset(&upng->sink, 0, sizeof(upng_sink));
+	upng->sink.row_end = ULONG_MAX;
+
 	return upng;
 }
 
@@ -1285,28 +1494,7 @@ graph_t* png_image_new(const char* filename) {
 	if(png == NULL)  {
 		return NULL;
 	}
-	upng_header(png);
-	if(png->color_type != UPNG_RGBA) {
-		upng_free(png);
-		return NULL;
-	}
-	upng_decode(png);
-	uint32_t* buffer = (uint32_t*)upng_get_buffer(png);
-	uint32_t w = upng_get_width(png);
-	uint32_t h = upng_get_height(png);
-
-	uint32_t i = 0;
-	while(i < w * h) {
-		uint32_t oc = buffer[i];
-		uint8_t oa = ((oc >> 24) & 0xff);
-		uint8_t or = oc & 0xff;
-		uint8_t og = ((oc >> 8)  & 0xff);
-		uint8_t ob = ((oc >> 16) & 0xff);
-		buffer[i] = argb(oa, or, og, ob);
-		i++;
-	}
-
-	graph_t* img = graph_new(buffer, w, h);
+	graph_t* img = upng_decode_graph(png);
 	upng_free(png);
 	return img;
 }
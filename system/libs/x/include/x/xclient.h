@@ -10,6 +10,12 @@ typedef struct st_x {
 	xinfo_t xinfo_prev; //for backup the state before fullscreen/min/max.
 	bool closed;
 
+	graph_t* g;     //back buffer, mapped once and kept till resizing
+	uint32_t* shm;  //front and back buffers
+	int shm_id;
+	int back;
+	bool remap;
+
 	void (*on_close)(struct st_x* x, void* p);
 	void (*on_min)(struct st_x* x, void* p);
 	void (*on_resize)(struct st_x* x, void* p);
@@ -21,6 +27,8 @@ x_t*     x_open(int x, int y, int w, int h, const char* title, int style);
 graph_t* x_get_graph(x_t* x);
 void     x_release_graph(x_t* x, graph_t* g);
 int      x_update(x_t* x);
+int      x_update_rects(x_t* x, const grect_t* rs, int num);
+int      x_swap(x_t* x, const grect_t* rs, int num);
 int      x_update_info(x_t* x, xinfo_t* xinfo);
 int      x_get_info(x_t* x, xinfo_t* xinfo);
 void     x_close(x_t* x);
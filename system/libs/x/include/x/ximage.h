@@ -0,0 +1,20 @@
+#ifndef XIMAGE_H
+#define XIMAGE_H
+
+#include <graph/graph.h>
+
+enum {
+	IMG_CNTL_NONE = 0,
+	IMG_CNTL_GET
+};
+
+/*get a decoded image from the image cache (/dev/img).
+the buffer is shared read-only, copy it before drawing on it.
+returns NULL if the cache is not running or can't decode the file,
+callers fall back to decoding it by themselves then.*/
+graph_t* x_image_get(const char* fname);
+
+/*release an image got from x_image_get (or a private one from a decoder).*/
+void     x_image_release(graph_t* img);
+
+#endif
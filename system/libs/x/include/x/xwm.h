@@ -12,7 +12,8 @@ enum {
 	XWM_CNTL_DRAW_FRAME = 0,
 	XWM_CNTL_DRAW_DESKTOP,
 	XWM_CNTL_GET_WORKSPACE,
-	XWM_CNTL_GET_POS
+	XWM_CNTL_GET_POS,
+	XWM_CNTL_GET_FRAME
 };
 
 #endif
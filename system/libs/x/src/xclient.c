@@ -6,17 +6,82 @@
 #include <fcntl.h>
 #include <string.h>
 
-int x_update(x_t* x) {
-	int ret = fcntl_raw(x->fd, X_CNTL_UPDATE, NULL, NULL);
+static int x_map_buffers(x_t* x);
+
+/*commit the back buffer, server latches it as front and the old front
+becomes the new back one. rects (in window coordinates) are optional.*/
+int x_swap(x_t* x, const grect_t* rs, int num) {
+	proto_t in, out;
+	proto_init(&in, NULL, 0);
+	proto_init(&out, NULL, 0);
+	if(rs != NULL && num > 0)
+		proto_add(&in, rs, num*sizeof(grect_t));
+
+	int ret = fcntl_raw(x->fd, X_CNTL_UPDATE, &in, &out);
+	if(ret == 0) {
+		//always follow the server, clients keeping the graph get it remapped here.
+		x->back = (proto_read_int(&out) == 0) ? 1 : 0;
+		if(x->g != NULL && x->remap)
+			x_map_buffers(x);
+		else if(x->g != NULL)
+			x->g->buffer = x->shm + x->back * x->g->w * x->g->h;
+	}
+	proto_clear(&in);
+	proto_clear(&out);
+	return ret;
+}
+
+/*copy damaged rects from the new front to the new back buffer*/
+static void x_keep_back(x_t* x, const grect_t* rs, int num) {
+	graph_t* g = x->g;
+	uint32_t sz = g->w * g->h;
+	uint32_t* front = x->shm + (x->back == 0 ? sz : 0);
+	for(int i=0; i<num; i++) {
+		grect_t r = rs[i];
+		if(r.x < 0) {
+			r.w += r.x;
+			r.x = 0;
+		}
+		if(r.y < 0) {
+			r.h += r.y;
+			r.y = 0;
+		}
+		if(r.x + r.w > (int32_t)g->w)
+			r.w = g->w - r.x;
+		if(r.y + r.h > (int32_t)g->h)
+			r.h = g->h - r.y;
+		if(r.w <= 0 || r.h <= 0)
+			continue;
+
+		uint32_t off = r.y * g->w + r.x;
+		for(int32_t y=0; y<r.h; y++) {
+			memcpy(g->buffer + off, front + off, r.w * 4);
+			off += g->w;
+		}
+	}
+}
+
+/*only rects (in window coordinates) changed since last update,
+the back buffer keeps the committed frame for incremental drawing*/
+int x_update_rects(x_t* x, const grect_t* rs, int num) {
+	int ret = x_swap(x, rs, num);
+	if(ret == 0 && x->g != NULL && !x->remap && rs != NULL && num > 0)
+		x_keep_back(x, rs, num);
 	return ret;
 }
 
+/*whole view redrawn, nothing copied to the new back buffer*/
+int x_update(x_t* x) {
+	return x_swap(x, NULL, 0);
+}
+
 int x_update_info(x_t* x, xinfo_t* info) {
 	proto_t in;
 	proto_init(&in, NULL, 0);
 	proto_add(&in, info, sizeof(xinfo_t));
 	int ret = fcntl_raw(x->fd, X_CNTL_UPDATE_INFO, &in, NULL);
 	proto_clear(&in);
+	x->remap = true; //buffers may be reallocated by resizing
 	return ret;
 }
 
@@ -65,43 +130,75 @@ x_t* x_open(int x, int y, int w, int h, const char* title, int style) {
 	return ret;
 }
 
-int x_get_info(x_t* x, xinfo_t* info) {
-	if(x == NULL || info == NULL)
-		return -1;
-	
+/*server replies the info with the index of the front buffer after it*/
+static int x_query_info(x_t* x, xinfo_t* info, int* front) {
 	proto_t out;
 	proto_init(&out, NULL, 0);
-	if(fcntl_raw(x->fd, X_CNTL_GET_INFO, NULL, &out) != 0)
+	if(fcntl_raw(x->fd, X_CNTL_GET_INFO, NULL, &out) != 0) {
+		proto_clear(&out);
 		return -1;
+	}
 	proto_read_to(&out, info, sizeof(xinfo_t));
+	if(front != NULL)
+		*front = proto_read_int(&out);
 	proto_clear(&out);
 	return 0;
 }
 
+int x_get_info(x_t* x, xinfo_t* info) {
+	if(x == NULL || info == NULL)
+		return -1;
+	return x_query_info(x, info, NULL);
+}
+
+static int x_map_buffers(x_t* x) {
+	xinfo_t info;
+	int front;
+	if(x_query_info(x, &info, &front) != 0)
+		return -1;
+
+	if(info.shm_id != x->shm_id) {
+		if(x->shm != NULL)
+			shm_unmap(x->shm_id);
+		x->shm_id = 0;
+		x->shm = (uint32_t*)shm_map(info.shm_id);
+		if(x->shm == NULL)
+			return -1;
+		x->shm_id = info.shm_id;
+	}
+	x->back = (front == 0) ? 1 : 0;
+
+	if(x->g == NULL)
+		x->g = graph_new(x->shm, info.r.w, info.r.h);
+	x->g->w = info.r.w;
+	x->g->h = info.r.h;
+	x->g->buffer = x->shm + x->back * info.r.w * info.r.h;
+	x->remap = false;
+	return 0;
+}
+
+/*the graph is owned by x and stays the same object across swaps and resizing*/
 graph_t* x_get_graph(x_t* x) {
 	if(x == NULL)
 		return NULL;
 
-	xinfo_t info;
-	if(x_get_info(x, &info) != 0)
-		return NULL;
-	void* gbuf = shm_map(info.shm_id);
-	if(gbuf == NULL)
+	if((x->g == NULL || x->remap) && x_map_buffers(x) != 0)
 		return NULL;
-	return graph_new(gbuf, info.r.w, info.r.h);
+	return x->g;
 }
 
 void  x_release_graph(x_t* x, graph_t* g) {
-	xinfo_t info;
-	if(x_get_info(x, &info) != 0)
-		return;
-	graph_free(g);
-	shm_unmap(info.shm_id);
+	(void)x;
+	(void)g;
 }
 
 void x_close(x_t* x) {
 	if(x == NULL)
 		return;
+	if(x->g != NULL)
+		graph_free(x->g);
+	if(x->shm != NULL)
+		shm_unmap(x->shm_id);
 	close(x->fd);
 	free(x);
 }
@@ -0,0 +1,55 @@
+#include <x/ximage.h>
+#include <sys/shm.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <fsinfo.h>
+#include <vprintf.h>
+
+graph_t* x_image_get(const char* fname) {
+	char full[FS_FULL_NAME_MAX];
+	if(fname[0] == '/') {
+		strncpy(full, fname, FS_FULL_NAME_MAX-1);
+		full[FS_FULL_NAME_MAX-1] = 0;
+	}
+	else {
+		char cwd[FS_FULL_NAME_MAX];
+		getcwd(cwd, FS_FULL_NAME_MAX);
+		snprintf(full, FS_FULL_NAME_MAX, "%s/%s",
+				strcmp(cwd, "/") == 0 ? "" : cwd, fname);
+	}
+
+	int fd = open("/dev/img", O_RDONLY);
+	if(fd < 0)
+		return NULL;
+
+	proto_t in, out;
+	proto_init(&in, NULL, 0);
+	proto_init(&out, NULL, 0);
+	proto_add_str(&in, full);
+
+	graph_t* img = NULL;
+	if(fcntl_raw(fd, IMG_CNTL_GET, &in, &out) == 0) {
+		int id = proto_read_int(&out);
+		uint32_t w = (uint32_t)proto_read_int(&out);
+		uint32_t h = (uint32_t)proto_read_int(&out);
+		uint32_t* buf = (uint32_t*)shm_map(id);
+		if(buf != NULL)
+			img = graph_new(buf, w, h);
+	}
+	proto_clear(&in);
+	proto_clear(&out);
+	close(fd);
+	return img;
+}
+
+void x_image_release(graph_t* img) {
+	if(img == NULL)
+		return;
+	int id = -1;
+	if(img->need_free == 0 && img->buffer != NULL)
+		id = shm_id(img->buffer);
+	graph_free(img);
+	if(id > 0)
+		shm_unmap(id);
+}
@@ -303,42 +303,81 @@ typedef struct {
 
 static int _gpio_fd = -1;
 
-static void  do_flush(const void* buf, uint32_t size) {
-	if(size < LCD_WIDTH * LCD_HEIGHT* 4)
+/*set panel window to rect and push its pixels only*/
+static void do_flush_rect(const void* buf, uint32_t size, const grect_t* rect) {
+	//rect must be inside buf, as do_flush checks the whole frame
+	uint32_t end = (uint32_t)(rect->y + rect->h - 1) * LCD_WIDTH + rect->x + rect->w;
+	if(end * 4 > size)
 		return;
 
 	critical_enter();
+	LCD_1in3_SetWindows(rect->x, rect->y, rect->x + rect->w, rect->y + rect->h);
 
 	LCD_DC_1;
 	spi_arch_activate(1);
 
-	uint32_t *src = (uint32_t*)buf;
-	uint32_t sz = LCD_HEIGHT*LCD_WIDTH;
-	UWORD i;
-
-	for (i = 0; i < sz; i++) {
-		register uint32_t s = src[i];
-		register uint8_t b = (s >> 16) & 0xff;
-		register uint8_t g = (s >> 8)  & 0xff;
-		register uint8_t r = s & 0xff;
-		UWORD color = ((r >> 3) <<11) | ((g >> 3) << 6) | (b >> 3);
-		//color = ((color<<8)&0xff00)|(color>>8);
-		uint8_t* p = (uint8_t*)&color;
-		spi_arch_transfer(p[1]);
-		spi_arch_transfer(p[0]);
+	const uint32_t *src = (const uint32_t*)buf;
+	int32_t ex = rect->x + rect->w;
+	int32_t ey = rect->y + rect->h;
+
+	for (int32_t y = rect->y; y < ey; y++) {
+		const uint32_t* line = src + y*LCD_WIDTH;
+		for (int32_t x = rect->x; x < ex; x++) {
+			register uint32_t s = line[x];
+			register uint8_t b = (s >> 16) & 0xff;
+			register uint8_t g = (s >> 8)  & 0xff;
+			register uint8_t r = s & 0xff;
+			UWORD color = ((r >> 3) <<11) | ((g >> 3) << 6) | (b >> 3);
+			//color = ((color<<8)&0xff00)|(color>>8);
+			uint8_t* p = (uint8_t*)&color;
+			spi_arch_transfer(p[1]);
+			spi_arch_transfer(p[0]);
+		}
 	}
 
 	spi_arch_activate(0);
 	critical_quit();
 }
 
-static int lcd_flush(int fd, int from_pid, fsinfo_t* info, void* p) {
+static void  do_flush(const void* buf, uint32_t size) {
+	if(size < LCD_WIDTH * LCD_HEIGHT* 4)
+		return;
+	grect_t r = {0, 0, LCD_WIDTH, LCD_HEIGHT};
+	do_flush_rect(buf, size, &r);
+}
+
+static int lcd_flush(int fd, int from_pid, fsinfo_t* info, const void* data, int size, void* p) {
 	(void)fd;
 	(void)from_pid;
 	(void)info;
 	fb_dma_t* dma = (fb_dma_t*)p;
 
-	do_flush(dma->data, dma->size);
+	const grect_t* rs = (const grect_t*)data;
+	int32_t num = size / sizeof(grect_t);
+	if(rs == NULL || num == 0) {
+		do_flush(dma->data, dma->size);
+		return 0;
+	}
+
+	for(int32_t i=0; i<num; i++) { //dirty rects only
+		grect_t r = rs[i];
+		if(r.x < 0) {
+			r.w += r.x;
+			r.x = 0;
+		}
+		if(r.y < 0) {
+			r.h += r.y;
+			r.y = 0;
+		}
+		if(r.x >= LCD_WIDTH || r.y >= LCD_HEIGHT)
+			continue;
+		if(r.w > LCD_WIDTH - r.x) //no r.x + r.w, it may overflow
+			r.w = LCD_WIDTH - r.x;
+		if(r.h > LCD_HEIGHT - r.y)
+			r.h = LCD_HEIGHT - r.y;
+		if(r.w > 0 && r.h > 0)
+			do_flush_rect(dma->data, dma->size, &r);
+	}
 	return 0;
 }
 
@@ -67,12 +67,55 @@ static int fb_fcntl(int fd,
 	return 0;
 }
 
-static int fb_flush(int fd, int from_pid, fsinfo_t* info, void* p) {
+/*clip r to screen, return 0 if nothing left*/
+static int fb_clip(grect_t* r) {
+	if(r->x < 0) {
+		r->w += r->x;
+		r->x = 0;
+	}
+	if(r->y < 0) {
+		r->h += r->y;
+		r->y = 0;
+	}
+	if(r->x + r->w > (int32_t)_fbinfo.width)
+		r->w = _fbinfo.width - r->x;
+	if(r->y + r->h > (int32_t)_fbinfo.height)
+		r->h = _fbinfo.height - r->y;
+	return (r->w > 0 && r->h > 0);
+}
+
+/*copy/convert only the scanline spans of r*/
+static void fb_flush_rect(fb_dma_t* dma, grect_t* r) {
+	uint32_t* src = (uint32_t*)dma->data;
+	int32_t ey = r->y + r->h;
+	for(int32_t y=r->y; y<ey; y++) {
+		uint32_t off = y * _fbinfo.width + r->x;
+		if(_fbinfo.depth == 32) 
+			memcpy(((uint32_t*)_fbinfo.pointer) + off, src + off, r->w*4);
+		else if(_fbinfo.depth == 16) 
+			dup16(((uint16_t*)_fbinfo.pointer) + off, src + off, r->w, 1);
+	}
+}
+
+static int fb_flush(int fd, int from_pid, fsinfo_t* info, const void* data, int size_rs, void* p) {
 	(void)fd;
 	(void)from_pid;
 	(void)info;
 	fb_dma_t* dma = (fb_dma_t*)p;
 
+	const grect_t* rs = (const grect_t*)data;
+	int32_t num = size_rs / sizeof(grect_t);
+	if(rs != NULL && num > 0) { //dirty rects only
+		critical_enter();
+		for(int32_t i=0; i<num; i++) {
+			grect_t r = rs[i];
+			if(fb_clip(&r))
+				fb_flush_rect(dma, &r);
+		}
+		critical_quit();
+		return 0;
+	}
+
 	uint32_t size = dma->size;
 	uint32_t sz = (_fbinfo.depth/8) * _fbinfo.width * _fbinfo.height;
 	if(size > sz)
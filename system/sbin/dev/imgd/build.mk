@@ -0,0 +1,9 @@
+IMGD_OBJS = $(ROOT_DIR)/sbin/dev/imgd/imgd.o
+
+IMGD = $(TARGET_DIR)/$(ROOT_DIR)/sbin/dev/imgd
+
+PROGS += $(IMGD)
+CLEAN += $(IMGD_OBJS)
+
+$(IMGD): $(IMGD_OBJS) $(LIB_OBJS)
+	$(LD) -Ttext=100 $(IMGD_OBJS) -o $(IMGD) $(LDFLAGS) -lupng -ltga -lgraph -lewokc -lc
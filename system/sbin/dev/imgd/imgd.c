@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/vfs.h>
+#include <sys/shm.h>
+#include <sys/vdevice.h>
+#include <dev/device.h>
+#include <x/ximage.h>
+#include <upng/upng.h>
+#include <tga/tga.h>
+
+/*decoded images shared read-only with the clients, so every asset is
+decoded once. entries are keyed by path plus the node and size of the file
+(vfs keeps no mtime), and the least recently used ones are dropped once
+the cache grows over the byte budget. clients still mapping a dropped
+image keep it alive until they unmap it.*/
+
+#define IMG_MAX    32
+#define IMG_BUDGET (4*1024*1024)
+
+typedef struct {
+	char fname[FS_FULL_NAME_MAX];
+	uint32_t node;
+	uint32_t fsize;
+	int shm_id;
+	uint32_t w;
+	uint32_t h;
+	uint32_t used;
+} img_t;
+
+static img_t _imgs[IMG_MAX];
+static uint32_t _bytes = 0;
+static uint32_t _tick = 0;
+
+static inline uint32_t img_bytes(img_t* img) {
+	return img->w * img->h * 4;
+}
+
+static void img_drop(img_t* img) {
+	if(img == NULL || img->shm_id <= 0)
+		return;
+	shm_unmap(img->shm_id);
+	_bytes -= img_bytes(img);
+	memset(img, 0, sizeof(img_t));
+}
+
+static img_t* img_lru(void) {
+	img_t* ret = NULL;
+	int i;
+	for(i=0; i<IMG_MAX; i++) {
+		img_t* img = &_imgs[i];
+		if(img->shm_id > 0 && (ret == NULL || img->used < ret->used))
+			ret = img;
+	}
+	return ret;
+}
+
+static img_t* img_find(const char* fname) {
+	int i;
+	for(i=0; i<IMG_MAX; i++) {
+		if(_imgs[i].shm_id > 0 && strcmp(_imgs[i].fname, fname) == 0)
+			return &_imgs[i];
+	}
+	return NULL;
+}
+
+static graph_t* img_decode(const char* fname) {
+	const char* ext = strrchr(fname, '.');
+	if(ext == NULL)
+		return NULL;
+	if(strcmp(ext, ".png") == 0)
+		return png_image_new(fname);
+	if(strcmp(ext, ".tga") == 0)
+		return tga_image_new(fname);
+	return NULL;
+}
+
+static img_t* img_load(const char* fname, fsinfo_t* info) {
+	graph_t* g = img_decode(fname);
+	if(g == NULL)
+		return NULL;
+
+	uint32_t sz = g->w * g->h * 4;
+	if(sz == 0 || sz > IMG_BUDGET) {
+		graph_free(g);
+		return NULL;
+	}
+
+	while(_bytes + sz > IMG_BUDGET)
+		img_drop(img_lru());
+
+	img_t* img = NULL;
+	int i;
+	for(i=0; i<IMG_MAX; i++) {
+		if(_imgs[i].shm_id <= 0) {
+			img = &_imgs[i];
+			break;
+		}
+	}
+	if(img == NULL) {
+		img = img_lru();
+		img_drop(img);
+	}
+
+	int id = shm_alloc(sz, SHM_PUBLIC | SHM_RDONLY);
+	void* buf = id > 0 ? shm_map(id) : NULL;
+	if(buf == NULL) {
+		graph_free(g);
+		return NULL;
+	}
+	memcpy(buf, g->buffer, sz);
+
+	strncpy(img->fname, fname, FS_FULL_NAME_MAX-1);
+	img->node = info->node;
+	img->fsize = info->size;
+	img->shm_id = id;
+	img->w = g->w;
+	img->h = g->h;
+	_bytes += sz;
+	graph_free(g);
+	return img;
+}
+
+static int img_get(proto_t* in, proto_t* out) {
+	const char* fname = proto_read_str(in);
+	fsinfo_t info;
+	if(fname == NULL || vfs_get(fname, &info) != 0)
+		return -1;
+
+	img_t* img = img_find(fname);
+	if(img != NULL && (img->node != info.node || img->fsize != info.size)) {
+		img_drop(img); //file changed
+		img = NULL;
+	}
+	if(img == NULL)
+		img = img_load(fname, &info);
+	if(img == NULL)
+		return -1;
+
+	img->used = ++_tick;
+	proto_add_int(out, img->shm_id);
+	proto_add_int(out, img->w);
+	proto_add_int(out, img->h);
+	return 0;
+}
+
+static int img_fcntl(int fd, int from_pid, fsinfo_t* info,
+		int cmd, proto_t* in, proto_t* out, void* p) {
+	(void)fd;
+	(void)from_pid;
+	(void)info;
+	(void)p;
+
+	if(cmd == IMG_CNTL_GET)
+		return img_get(in, out);
+	return -1;
+}
+
+int main(int argc, char** argv) {
+	const char* mnt_point = argc > 1 ? argv[1]: "/dev/img";
+	memset(_imgs, 0, sizeof(_imgs));
+
+	vdevice_t dev;
+	memset(&dev, 0, sizeof(vdevice_t));
+	strcpy(dev.name, "img");
+	dev.fcntl = img_fcntl;
+
+	device_run(&dev, mnt_point, FS_TYPE_CHAR);
+	return 0;
+}
@@ -7,11 +7,20 @@
 #include <sys/sd.h>
 #include <sys/vdevice.h>
 #include <sys/syscall.h>
+#include <sys/proc.h>
+#include <sys/shm.h>
+#include <fcntl.h>
 #include <ext2fs.h>
 #include <dev/device.h>
 #include <partition.h>
 #include <stdio.h>
 
+/*loop_step runs about every 1ms, write back cached metadata every ~3s*/
+#define SYNC_STEPS 3000
+
+static proc_lock_t _lock = 0;
+static int32_t _sync_steps = 0;
+
 static void add_file(fsinfo_t* node_to, const char* name, INODE* inode, int32_t ino) {
 	fsinfo_t f;
 	memset(&f, 0, sizeof(fsinfo_t));
@@ -39,44 +48,47 @@ static int add_dir(fsinfo_t* node_to, fsinfo_t* ret, const char* dn, INODE* inod
 }
 
 static int32_t add_nodes(ext2_t* ext2, INODE *ip, fsinfo_t* dinfo) {
-	int32_t i; 
+	int32_t i, num; 
 	char c, *cp;
 	DIR  *dp;
 	char buf[EXT2_BLOCK_SIZE];
 
-	for (i=0; i<12; i++){
-		if (ip->i_block[i] ){
-			ext2->read_block(ip->i_block[i], buf);
-			dp = (DIR *)buf;
-			cp = buf;
+	num = (ip->i_size + EXT2_BLOCK_SIZE - 1) / EXT2_BLOCK_SIZE;
+	for (i=0; i<num; i++){
+		//read through ext2_read so indirect dir blocks are covered too
+		if(ext2_read(ext2, ip, buf, EXT2_BLOCK_SIZE, i*EXT2_BLOCK_SIZE) != EXT2_BLOCK_SIZE)
+			continue;
+		dp = (DIR *)buf;
+		cp = buf;
 
-			if(dp->inode == 0)
+		while (cp < &buf[EXT2_BLOCK_SIZE]){
+			if(dp->rec_len == 0)
+				break;
+			if(dp->inode == 0 || dp->name_len == 0) { //deleted entry or htree index node
+				cp += dp->rec_len;
+				dp = (DIR *)cp;
 				continue;
-
-			while (cp < &buf[EXT2_BLOCK_SIZE]){
-				c = dp->name[dp->name_len];  // save last byte
-				dp->name[dp->name_len] = 0;   
-				if(dp->name_len == 0)
-					break;
-				if(strcmp(dp->name, ".") != 0 && strcmp(dp->name, "..") != 0) {
-					int32_t ino = dp->inode;
-					INODE ip_node;
-					if(ext2_node_by_ino(ext2, ino, &ip_node) == 0) {
-						if(dp->file_type == 2) {//director
-							fsinfo_t ret;
-							add_dir(dinfo, &ret, dp->name, &ip_node, ino);
-							add_nodes(ext2, &ip_node, &ret);
-						}
-						else if(dp->file_type == 1) {//file
-							add_file(dinfo, dp->name, &ip_node, ino);
-						}
+			}
+			c = dp->name[dp->name_len];  // save last byte
+			dp->name[dp->name_len] = 0;   
+			if(strcmp(dp->name, ".") != 0 && strcmp(dp->name, "..") != 0) {
+				int32_t ino = dp->inode;
+				INODE ip_node;
+				if(ext2_node_by_ino(ext2, ino, &ip_node) == 0) {
+					if(dp->file_type == 2) {//director
+						fsinfo_t ret;
+						add_dir(dinfo, &ret, dp->name, &ip_node, ino);
+						add_nodes(ext2, &ip_node, &ret);
+					}
+					else if(dp->file_type == 1) {//file
+						add_file(dinfo, dp->name, &ip_node, ino);
 					}
 				}
-				//add node
-				dp->name[dp->name_len] = c; // restore that last byte
-				cp += dp->rec_len;
-				dp = (DIR *)cp;
 			}
+			//add node
+			dp->name[dp->name_len] = c; // restore that last byte
+			cp += dp->rec_len;
+			dp = (DIR *)cp;
 		}
 	}
 	return 0;
@@ -90,7 +102,7 @@ static int sdext2_mount(fsinfo_t* info, void* p) {
 	return 0;
 }
 
-static int sdext2_create(fsinfo_t* info_to, fsinfo_t* info, void* p) {
+static int do_create(fsinfo_t* info_to, fsinfo_t* info, void* p) {
 	ext2_t* ext2 = (ext2_t*)p;
 	int32_t ino_to = (int32_t)info_to->data;
 	if(ino_to == 0) ino_to = 2;
@@ -107,13 +119,204 @@ static int sdext2_create(fsinfo_t* info_to, fsinfo_t* info, void* p) {
 	}
 	else
 		ino = ext2_create_file(ext2, &inode_to, info->name, info->owner);
-	if(ino == -1)
+	if(ino == -1 || put_node(ext2, ino_to, &inode_to) != 0)
 		return -1;
-	put_node(ext2, ino_to, &inode_to);
 	info->data = ino;
 	return 0;
 }
 
+static int sdext2_create(fsinfo_t* info_to, fsinfo_t* info, void* p) {
+	proc_lock(_lock);
+	int res = do_create(info_to, info, p);
+	proc_unlock(_lock);
+	return res;
+}
+
+/*delayed write buffer: sequential writes are collected here and handed to
+ext2_write in one go, so blocks get allocated as contiguous runs and inode
+is updated once per buffer instead of once per write*/
+#define WBUF_MAX  4
+#define WBUF_SIZE (16*EXT2_BLOCK_SIZE)
+
+typedef struct {
+	int32_t ino; /*0 for free buffer*/
+	int32_t offset;
+	int32_t size;
+	uint32_t stamp;
+	int32_t fd; /*writer, fsinfo is fetched by it at flush*/
+	int32_t pid;
+	char data[WBUF_SIZE];
+} wbuf_t;
+
+static wbuf_t _wbufs[WBUF_MAX];
+static uint32_t _wbuf_stamp = 0;
+
+static int32_t wbuf_flush(ext2_t* ext2, wbuf_t* wb) {
+	if(wb->ino == 0)
+		return 0;
+
+	int32_t res = -1;
+	INODE inode;
+	if(ext2_node_by_ino(ext2, wb->ino, &inode) == 0) {
+		res = ext2_write(ext2, &inode, wb->data, wb->size, wb->offset);
+		if(put_node(ext2, wb->ino, &inode) != 0)
+			res = -1;
+		/*size was set when buffered, only a short write changes it.
+		fetch the current fsinfo, the node may have changed since.*/
+		fsinfo_t info;
+		if(syscall3(SYS_VFS_GET_BY_FD, wb->fd, wb->pid, (int32_t)&info) != 0 &&
+				(int32_t)info.data == wb->ino && info.size != inode.i_size) {
+			info.size = inode.i_size;
+			vfs_set(&info);
+		}
+	}
+	wb->ino = 0;
+	return res;
+}
+
+static wbuf_t* wbuf_get(int32_t ino) {
+	for(int32_t i=0; i<WBUF_MAX; i++) {
+		if(_wbufs[i].ino == ino)
+			return &_wbufs[i];
+	}
+	return NULL;
+}
+
+static void wbuf_flush_ino(ext2_t* ext2, int32_t ino) {
+	wbuf_t* wb = wbuf_get(ino);
+	if(wb != NULL)
+		wbuf_flush(ext2, wb);
+}
+
+static void wbuf_flush_all(ext2_t* ext2) {
+	for(int32_t i=0; i<WBUF_MAX; i++)
+		wbuf_flush(ext2, &_wbufs[i]);
+}
+
+/*free buffer, or flush the least recently used one*/
+static wbuf_t* wbuf_new(ext2_t* ext2) {
+	wbuf_t* ret = &_wbufs[0];
+	for(int32_t i=0; i<WBUF_MAX; i++) {
+		if(_wbufs[i].ino == 0)
+			return &_wbufs[i];
+		if(_wbufs[i].stamp < ret->stamp)
+			ret = &_wbufs[i];
+	}
+	wbuf_flush(ext2, ret);
+	return ret;
+}
+
+/*read only file mappings: the whole file is read into a public shm once and
+the same shm is handed to every process mapping it. rootfsd keeps one ref of
+its own so later mmaps of a cached file cost no disk io at all.
+shm has no per process grant, so any process knowing the id can map the
+contents without the permission check of mmap, don't mmap secret files.*/
+#define FMAP_MAX    16
+#define FMAP_BUDGET (4*1024*1024)
+
+typedef struct {
+	int32_t ino; /*0 for free slot*/
+	int32_t shm_id;
+	int32_t size;
+	uint32_t stamp;
+} fmap_t;
+
+static fmap_t _fmaps[FMAP_MAX];
+static uint32_t _fmap_stamp = 0;
+static int32_t _fmap_total = 0;
+
+/*drop rootfsd's ref, processes still mapping it keep their copy*/
+static void fmap_drop(fmap_t* m) {
+	if(m->ino == 0)
+		return;
+	shm_unmap(m->shm_id);
+	_fmap_total -= m->size;
+	m->ino = 0;
+}
+
+static fmap_t* fmap_get(int32_t ino) {
+	for(int32_t i=0; i<FMAP_MAX; i++) {
+		if(_fmaps[i].ino == ino)
+			return &_fmaps[i];
+	}
+	return NULL;
+}
+
+static void fmap_drop_ino(int32_t ino) {
+	fmap_t* m = fmap_get(ino);
+	if(m != NULL)
+		fmap_drop(m);
+}
+
+/*free slot within budget, evicting least recently used mappings*/
+static fmap_t* fmap_new(int32_t size) {
+	while(true) {
+		fmap_t* free_slot = NULL;
+		fmap_t* lru = NULL;
+		for(int32_t i=0; i<FMAP_MAX; i++) {
+			fmap_t* m = &_fmaps[i];
+			if(m->ino == 0) {
+				if(free_slot == NULL)
+					free_slot = m;
+			}
+			else if(lru == NULL || m->stamp < lru->stamp)
+				lru = m;
+		}
+		if(free_slot != NULL && (_fmap_total + size <= FMAP_BUDGET || lru == NULL))
+			return free_slot;
+		fmap_drop(lru);
+	}
+}
+
+static int32_t fmap_load(ext2_t* ext2, int32_t ino, int32_t* size) {
+	fmap_t* m = fmap_get(ino);
+	if(m == NULL) {
+		INODE inode;
+		if(ext2_node_by_ino(ext2, ino, &inode) != 0 || inode.i_size == 0)
+			return -1;
+
+		int32_t id = shm_alloc(inode.i_size, SHM_PUBLIC | SHM_RDONLY);
+		if(id < 0)
+			return -1;
+		char* p = (char*)shm_map(id);
+		if(p == NULL) {
+			shm_unmap(id); //never mapped, released by the owner
+			return -1;
+		}
+		if(ext2_read(ext2, &inode, p, inode.i_size, 0) != (int32_t)inode.i_size) {
+			shm_unmap(id);
+			return -1;
+		}
+
+		m = fmap_new(inode.i_size);
+		m->ino = ino;
+		m->shm_id = id;
+		m->size = inode.i_size;
+		_fmap_total += m->size;
+	}
+	m->stamp = ++_fmap_stamp;
+	*size = m->size;
+	return m->shm_id;
+}
+
+static int sdext2_mmap(int fd, int from_pid, fsinfo_t* info, int prot, int* size, void* p) {
+	(void)fd;
+	(void)from_pid;
+	if((prot & PROT_WRITE) != 0) //read only mappings
+		return -1;
+
+	ext2_t* ext2 = (ext2_t*)p;
+	int32_t ino = (int32_t)info->data;
+	if(ino == 0 || info->type != FS_TYPE_FILE)
+		return -1;
+
+	proc_lock(_lock);
+	wbuf_flush_ino(ext2, ino);
+	int32_t id = fmap_load(ext2, ino, size);
+	proc_unlock(_lock);
+	return id;
+}
+
 static int sdext2_read(int fd, int from_pid, fsinfo_t* info, 
 		void* buf, int size, int offset, void* p) {
 	(void)fd;
@@ -123,11 +326,14 @@ static int sdext2_read(int fd, int from_pid, fsinfo_t* info,
 	int32_t ino = (int32_t)info->data;
 	if(ino == 0) ino = 2;
 	INODE inode;
+	proc_lock(_lock);
+	wbuf_flush_ino(ext2, ino);
 	if(ext2_node_by_ino(ext2, ino, &inode) != 0) {
+		proc_unlock(_lock);
 		return -1;
 	}
 
-	int rsize = info->size - offset;
+	int rsize = inode.i_size - offset;
 	if(rsize < size)
 		size = rsize;
 	if(size < 0)
@@ -135,35 +341,114 @@ static int sdext2_read(int fd, int from_pid, fsinfo_t* info,
 
 	if(size > 0) 
 		size = ext2_read(ext2, &inode, buf, size, offset);
+	proc_unlock(_lock);
 	return size;	
 }
 
-static int sdext2_write(int fd, int from_pid, fsinfo_t* info,
-		const void* buf, int size, int offset, void* p) {
-	(void)fd;
-	(void)from_pid;
+/*buffered data counts in the file size at once, lseek(SEEK_END) and stat see it*/
+static void wbuf_set_size(fsinfo_t* info, int size, int offset) {
+	if((uint32_t)(offset + size) > info->size) {
+		info->size = offset + size;
+		vfs_set(info);
+	}
+}
 
-	ext2_t* ext2 = (ext2_t*)p;
+static int do_write(ext2_t* ext2, int fd, int from_pid, fsinfo_t* info,
+		const void* buf, int size, int offset) {
 	int32_t ino = (int32_t)info->data;
 	if(ino == 0) ino = 2;
-	INODE inode;
-	if(ext2_node_by_ino(ext2, ino, &inode) != 0) {
-		return -1;
+	fmap_drop_ino(ino);
+
+	wbuf_t* wb = wbuf_get(ino);
+	if(wb != NULL) {
+		if(offset == wb->offset + wb->size && wb->size + size <= WBUF_SIZE) {
+			memcpy(wb->data + wb->size, buf, size);
+			wb->size += size;
+			wb->stamp = ++_wbuf_stamp;
+			wbuf_set_size(info, size, offset);
+			return size;
+		}
+		wbuf_flush(ext2, wb);
 	}
-	size = ext2_write(ext2, &inode, buf, size, offset);
-	if(size >= 0) {
-		inode.i_size += size;
-		info->size += size;
-		put_node(ext2, ino, &inode);
+
+	if(size >= WBUF_SIZE) { //big write, no need to buffer
+		INODE inode;
+		if(ext2_node_by_ino(ext2, ino, &inode) != 0)
+			return -1;
+		size = ext2_write(ext2, &inode, buf, size, offset);
+		if(put_node(ext2, ino, &inode) != 0)
+			return -1;
+		info->size = inode.i_size;
 		vfs_set(info);
+		return size;
 	}
+
+	wb = wbuf_new(ext2);
+	wb->ino = ino;
+	wb->offset = offset;
+	wb->size = size;
+	wb->stamp = ++_wbuf_stamp;
+	wb->fd = fd;
+	wb->pid = from_pid;
+	memcpy(wb->data, buf, size);
+	wbuf_set_size(info, size, offset);
+	return size;
+}
+
+static int sdext2_write(int fd, int from_pid, fsinfo_t* info,
+		const void* buf, int size, int offset, void* p) {
+	proc_lock(_lock);
+	size = do_write((ext2_t*)p, fd, from_pid, info, buf, size, offset);
+	proc_unlock(_lock);
 	return size;	
 }
 
 static int sdext2_unlink(fsinfo_t* info, const char* fname, void* p) {
+	ext2_t* ext2 = (ext2_t*)p;
+	proc_lock(_lock);
+	wbuf_flush_all(ext2);
+	fmap_drop_ino((int32_t)info->data);
+	int res = ext2_unlink(ext2, fname);
+	proc_unlock(_lock);
+	return res;
+}
+
+static int sdext2_sync(ext2_t* ext2) {
+	proc_lock(_lock);
+	wbuf_flush_all(ext2);
+	int res = ext2_sync(ext2);
+	_sync_steps = 0;
+	proc_unlock(_lock);
+	return res;
+}
+
+static int sdext2_flush(int fd, int from_pid, fsinfo_t* info, const void* data, int size, void* p) {
+	(void)fd;
+	(void)from_pid;
 	(void)info;
+	(void)data;
+	(void)size;
+	return sdext2_sync((ext2_t*)p);
+}
+
+static int sdext2_close(int fd, int from_pid, fsinfo_t* info, void* p) {
+	(void)fd;
+	(void)from_pid;
 	ext2_t* ext2 = (ext2_t*)p;
-	return ext2_unlink(ext2, fname);
+	int32_t ino = (int32_t)info->data;
+	if(ino == 0) ino = 2;
+
+	proc_lock(_lock);
+	wbuf_flush_ino(ext2, ino);
+	proc_unlock(_lock);
+	return 0;
+}
+
+static int sdext2_loop_step(void* p) {
+	_sync_steps++;
+	if(_sync_steps >= SYNC_STEPS)
+		sdext2_sync((ext2_t*)p);
+	return 0;
 }
 
 int main(int argc, char** argv) {
@@ -178,15 +463,23 @@ int main(int argc, char** argv) {
 	dev.write = sdext2_write;
 	dev.create = sdext2_create;
 	dev.unlink = sdext2_unlink;
+	dev.flush = sdext2_flush;
+	dev.mmap = sdext2_mmap;
+	dev.close = sdext2_close;
+	dev.loop_step = sdext2_loop_step;
 
 	sd_init();
 	ext2_t ext2;
 	ext2_init(&ext2, sd_read, sd_write);
 	sd_set_buffer(ext2.super.s_blocks_count*2);
 	
+	_lock = proc_lock_new();
+	memset(_wbufs, 0, sizeof(_wbufs));
+	memset(_fmaps, 0, sizeof(_fmaps));
 	dev.extra_data = &ext2;
 	device_run(&dev, "/", FS_TYPE_DIR);
 	ext2_quit(&ext2);
+	proc_lock_free(_lock);
 	sd_quit();
 	return 0;
 }
@@ -18,6 +18,7 @@
 #include <sys/proc.h>
 
 #define X_EVENT_MAX 16
+#define X_DAMAGE_MAX 16
 
 typedef struct st_xview_ev {
 	xevent_t event;
@@ -27,9 +28,11 @@ typedef struct st_xview_ev {
 typedef struct st_xview {
 	int ufid;
 	int from_pid;
-	graph_t* g;
+	graph_t* g; //front buffer, the one composed
+	uint32_t* bufs[2]; //front and back buffers in one shm
+	int front;
 	xinfo_t xinfo;
-	bool dirty;
+	grect_t r_frame; //content and frame drawn by xwm
 
 	struct st_xview *next;
 	struct st_xview *prev;
@@ -38,13 +41,17 @@ typedef struct st_xview {
 	int event_num;
 } xview_t;
 
+/*cursor overlay: sprite plus the saved screen under it, moving it only
+touches the old and new cursor rects*/
 typedef struct {
 	gpos_t old_pos;
 	gpos_t cpos;
 	gpos_t offset;
 	gsize_t size;
-	graph_t* g;
-	bool drop;
+	graph_t* g;      //saved background
+	graph_t* sprite;
+	bool shown;      //sprite is on screen at old_pos
+	bool moved;
 } cursor_t;
 
 typedef struct {
@@ -52,6 +59,12 @@ typedef struct {
 	gpos_t old_pos;
 } x_current_t;
 
+/*screen areas to recompose, kept as a short list of rects*/
+typedef struct {
+	grect_t rs[X_DAMAGE_MAX];
+	int32_t num;
+} x_damage_t;
+
 typedef struct {
 	bool actived;
 	int fb_fd;
@@ -60,7 +73,7 @@ typedef struct {
 	int joystick_fd;
 	int xwm_pid;
 	int shm_id;
-	bool dirty;
+	x_damage_t damage;
 	bool need_repaint;
 	bool show_cursor;
 	graph_t* g;
@@ -73,7 +86,88 @@ typedef struct {
 	proc_lock_t lock;
 } x_t;
 
-static void draw_win_frame(x_t* x, xview_t* view) {
+static inline int32_t rect_area(const grect_t* r) {
+	return r->w * r->h;
+}
+
+/*intersection of a and b, return false if empty*/
+static bool rect_insect(const grect_t* a, const grect_t* b, grect_t* ret) {
+	int32_t x1 = a->x > b->x ? a->x : b->x;
+	int32_t y1 = a->y > b->y ? a->y : b->y;
+	int32_t x2 = (a->x + a->w) < (b->x + b->w) ? (a->x + a->w) : (b->x + b->w);
+	int32_t y2 = (a->y + a->h) < (b->y + b->h) ? (a->y + a->h) : (b->y + b->h);
+	if(x2 <= x1 || y2 <= y1)
+		return false;
+	ret->x = x1;
+	ret->y = y1;
+	ret->w = x2 - x1;
+	ret->h = y2 - y1;
+	return true;
+}
+
+/*bounding box of a and b*/
+static void rect_union(const grect_t* a, const grect_t* b, grect_t* ret) {
+	int32_t x1 = a->x < b->x ? a->x : b->x;
+	int32_t y1 = a->y < b->y ? a->y : b->y;
+	int32_t x2 = (a->x + a->w) > (b->x + b->w) ? (a->x + a->w) : (b->x + b->w);
+	int32_t y2 = (a->y + a->h) > (b->y + b->h) ? (a->y + a->h) : (b->y + b->h);
+	ret->x = x1;
+	ret->y = y1;
+	ret->w = x2 - x1;
+	ret->h = y2 - y1;
+}
+
+/*a contains b*/
+static inline bool rect_contain(const grect_t* a, const grect_t* b) {
+	return b->x >= a->x && b->y >= a->y &&
+			(b->x + b->w) <= (a->x + a->w) &&
+			(b->y + b->h) <= (a->y + a->h);
+}
+
+static void damage_del(x_damage_t* d, int32_t i) {
+	d->num--;
+	if(i != d->num)
+		memcpy(&d->rs[i], &d->rs[d->num], sizeof(grect_t));
+}
+
+/*merge r into the damage list: rects are merged when their bounding box
+costs no more than both of them, when the list is full r is merged with
+the rect growing the least*/
+static void damage_add(x_damage_t* d, const grect_t* r_in, const grect_t* scr) {
+	grect_t r;
+	if(!rect_insect(r_in, scr, &r))
+		return;
+
+	while(true) {
+		int32_t i, best = -1, best_cost = 0;
+		for(i=0; i<d->num; i++) {
+			grect_t* e = &d->rs[i];
+			if(rect_contain(e, &r))
+				return;
+
+			grect_t u;
+			rect_union(e, &r, &u);
+			int32_t cost = rect_area(&u) - rect_area(e) - rect_area(&r);
+			if(cost <= 0)
+				break;
+			if(best < 0 || cost < best_cost) {
+				best = i;
+				best_cost = cost;
+			}
+		}
+
+		if(i < d->num) //cheap merge
+			best = i;
+		else if(d->num < X_DAMAGE_MAX) {
+			memcpy(&d->rs[d->num++], &r, sizeof(grect_t));
+			return;
+		}
+		rect_union(&d->rs[best], &r, &r);
+		damage_del(d, best);
+	}
+}
+
+static void draw_win_frame(x_t* x, xview_t* view, grect_t* clip) {
 	if((view->xinfo.style & X_STYLE_NO_FRAME) != 0)
 		return;
 
@@ -89,13 +183,14 @@ static void draw_win_frame(x_t* x, xview_t* view) {
 		proto_add_int(&in, 1); //top win
 	else
 		proto_add_int(&in, 0);
+	proto_add(&in, clip, sizeof(grect_t));
 
 	ipc_call(x->xwm_pid, XWM_CNTL_DRAW_FRAME, &in, &out);
 	proto_clear(&in);
 	proto_clear(&out);
 }
 
-static void draw_desktop(x_t* x) {
+static void draw_desktop(x_t* x, grect_t* clip) {
 	proto_t in, out;
 	proto_init(&in, NULL, 0);
 	proto_init(&out, NULL, 0);
@@ -103,82 +198,93 @@ static void draw_desktop(x_t* x) {
 	proto_add_int(&in, x->shm_id);
 	proto_add_int(&in, x->g->w);
 	proto_add_int(&in, x->g->h);
+	proto_add(&in, clip, sizeof(grect_t));
 
 	ipc_call(x->xwm_pid, XWM_CNTL_DRAW_DESKTOP, &in, &out);
 	proto_clear(&in);
 	proto_clear(&out);
 }
 
-static void draw_mask(graph_t* g, int x, int y, int w, int h) {
-	if(x < 0) {
-		w += x;
-		x = 0;
-	}
-	if(y < 0) {
-		h += y;
-		y = 0;
-	}
-	if((x+w) >= (int)g->w)
-		w = g->w - x - 1;
-	if((y+h) >= (int)g->h) 
-		h = g->h - y - 1;
+/*mask pattern of rect r, only the part inside clip (already inside screen)*/
+static void draw_mask(graph_t* g, grect_t* r, grect_t* clip) {
+	int step = 4;
+	int x0 = clip->x + (step - (clip->x - r->x) % step) % step;
+	int y0 = clip->y + (step - (clip->y - r->y) % step) % step;
+	int ex = clip->x + clip->w;
+	int ey = clip->y + clip->h;
 
 	int i, j;
-	int step = 4;
-	for(j=0; j<h; j+=step) {
-		for(i=0; i<w; i+=step) {
-			pixel(g, i+x, j+y, 0xff000000);
-			pixel(g, i+x+1, j+y+1, 0xffffffff);
+	for(j=y0; j<ey; j+=step) {
+		for(i=x0; i<ex; i+=step) {
+			pixel(g, i, j, 0xff000000);
+			if((i+1) < ex && (j+1) < ey)
+				pixel(g, i+1, j+1, 0xffffffff);
 		}
 	}
 }
 
-static int draw_view(x_t* xp, xview_t* view) {
-	if(!xp->dirty && !view->dirty)
+/*r fully covered by an opaque view above view, or above the desktop if view is NULL*/
+static bool x_covered(x_t* x, xview_t* view, grect_t* r) {
+	xview_t* v = (view == NULL) ? x->view_head : view->next;
+	while(v != NULL) {
+		if(v->xinfo.visible && v->g != NULL &&
+				v != x->current.view &&
+				(v->xinfo.style & X_STYLE_ALPHA) == 0 &&
+				rect_contain(&v->xinfo.r, r))
+			return true;
+		v = v->next;
+	}
+	return false;
+}
+
+/*compose view into the damaged rect clip*/
+static int draw_view(x_t* xp, xview_t* view, grect_t* clip) {
+	grect_t r, rc;
+	if(!rect_insect(&view->r_frame, clip, &r) || x_covered(xp, view, &r))
 		return 0;
 
-	if(view->g != NULL) {
+	if(view->g != NULL && rect_insect(&view->xinfo.r, &r, &rc)) {
+		int32_t sx = rc.x - view->xinfo.r.x;
+		int32_t sy = rc.y - view->xinfo.r.y;
 		if(xp->current.view != view) { //drag and moving
 			if((view->xinfo.style & X_STYLE_ALPHA) != 0) {
-				blt_alpha(view->g, 0, 0, 
-						view->xinfo.r.w,
-						view->xinfo.r.h,
-						xp->g,
-						view->xinfo.r.x,
-						view->xinfo.r.y,
-						view->xinfo.r.w,
-						view->xinfo.r.h, 0xff);
+				blt_alpha(view->g, sx, sy, rc.w, rc.h,
+						xp->g, rc.x, rc.y, rc.w, rc.h, 0xff);
 			}
 			else {
-				blt(view->g, 0, 0, 
-						view->xinfo.r.w,
-						view->xinfo.r.h,
-						xp->g,
-						view->xinfo.r.x,
-						view->xinfo.r.y,
-						view->xinfo.r.w,
-						view->xinfo.r.h);
+				blt(view->g, sx, sy, rc.w, rc.h,
+						xp->g, rc.x, rc.y, rc.w, rc.h);
 			}
 		}
 		else {
-			draw_mask(xp->g, 
-					view->xinfo.r.x,
-					view->xinfo.r.y,
-					view->xinfo.r.w,
-					view->xinfo.r.h);
+			draw_mask(xp->g, &view->xinfo.r, &rc);
 		}
 	}
 
-	draw_win_frame(xp, view);
-	view->dirty = false;
+	//frame box is drawn on the content border, skip if clip is inside it
+	grect_t inner = {view->xinfo.r.x+1, view->xinfo.r.y+1,
+			view->xinfo.r.w-2, view->xinfo.r.h-2};
+	if(!rect_contain(&inner, &r))
+		draw_win_frame(xp, view, &r);
 	return 0;
 }
 
-static inline void x_dirty(x_t* x) {
-	x->dirty = true;
+static inline void x_damage(x_t* x, grect_t* r) {
+	grect_t scr = {0, 0, x->g->w, x->g->h};
+	damage_add(&x->damage, r, &scr);
 	x->need_repaint = true;
 }
 
+static inline void x_dirty(x_t* x) {
+	grect_t scr = {0, 0, x->g->w, x->g->h};
+	x_damage(x, &scr);
+}
+
+static inline void x_damage_view(x_t* x, xview_t* view) {
+	if(view->xinfo.visible)
+		x_damage(x, &view->r_frame);
+}
+
 static void remove_view(x_t* x, xview_t* view) {
 	if(view->prev != NULL)
 		view->prev->next = view->next;
@@ -189,7 +295,9 @@ static void remove_view(x_t* x, xview_t* view) {
 	if(x->view_head == view)
 		x->view_head = view->next;
 	view->next = view->prev = NULL;
-	x_dirty(x);
+	x_damage_view(x, view);
+	if(x->view_tail != NULL) //focus changed
+		x_damage_view(x, x->view_tail);
 }
 
 static void x_push_event(xview_t* view, xview_event_t* e, uint8_t must) {
@@ -212,6 +320,7 @@ static void push_view(x_t* x, xview_t* view) {
 			e->event.type = XEVT_WIN;
 			e->event.value.window.event = XEVT_WIN_UNFOCUS;
 			x_push_event(x->view_tail, e, 1);
+			x_damage_view(x, x->view_tail);
 
 			x->view_tail->next = view;
 			view->prev = x->view_tail;
@@ -238,12 +347,15 @@ static void push_view(x_t* x, xview_t* view) {
 		}
 	}
 
-	if(view->xinfo.visible)
-		x_dirty(x);
+	x_damage_view(x, view);
 }
 
 static void x_del_view(x_t* x, xview_t* view) {
 	remove_view(x, view);
+	if(view->g != NULL) {
+		graph_free(view->g);
+		shm_unmap(view->xinfo.shm_id);
+	}
 	free(view);
 
 	if(x->view_tail != NULL) {
@@ -255,87 +367,125 @@ static void x_del_view(x_t* x, xview_t* view) {
 	}
 }
 
-static void hide_cursor(x_t* x) {
-	if(x->cursor.drop)
-		return;
+static inline void cursor_rect(x_t* x, gpos_t* pos, grect_t* r) {
+	r->x = pos->x - x->cursor.offset.x;
+	r->y = pos->y - x->cursor.offset.y;
+	r->w = x->cursor.size.w;
+	r->h = x->cursor.size.h;
+}
 
-	if(x->cursor.g == NULL) {
-		x->cursor.g = graph_new(NULL, x->cursor.size.w, x->cursor.size.h);
-		blt(x->g,
-				x->cursor.old_pos.x - x->cursor.offset.x,
-				x->cursor.old_pos.y - x->cursor.offset.y,
-				x->cursor.size.w,
-				x->cursor.size.h,
-				x->cursor.g,
-				0,
-				0, 
-				x->cursor.size.w,
-				x->cursor.size.h);
-	}
-	else  {
-		blt(x->cursor.g,
-				0,
-				0,
-				x->cursor.size.w,
-				x->cursor.size.h,
-				x->g,
-				x->cursor.old_pos.x - x->cursor.offset.x,
-				x->cursor.old_pos.y - x->cursor.offset.x,
-				x->cursor.size.w,
-				x->cursor.size.h);
-	}
-}
-
-static inline void draw_cursor(x_t* x) {
-	int32_t mx = x->cursor.cpos.x - x->cursor.offset.x;
-	int32_t my = x->cursor.cpos.y - x->cursor.offset.y;
+static void cursor_init(x_t* x) {
 	int32_t mw = x->cursor.size.w;
 	int32_t mh = x->cursor.size.h;
+	x->cursor.g = graph_new(NULL, mw, mh);
+	x->cursor.sprite = graph_new(NULL, mw, mh);
+	graph_t* g = x->cursor.sprite;
+	clear(g, 0x0);
+
+	line(g, 1, 0, mw-1, mh-2, 0xffffffff);
+	line(g, 0, 0, mw-1, mh-1, 0xff000000);
+	line(g, 0, 1, mw-2, mh-1, 0xffffffff);
+
+	line(g, 0, mh-2, mw-2, 0, 0xffffffff);
+	line(g, 0, mh-1, mw-1, 0, 0xff000000);
+	line(g, 1, mh-1, mw-1, 1, 0xffffffff);
+}
 
-	if(x->cursor.g == NULL)
+static void hide_cursor(x_t* x) {
+	if(!x->cursor.shown)
 		return;
 
-	blt(x->g, mx, my, mw, mh,
-			x->cursor.g, 0, 0, mw, mh);
-
-	line(x->g, mx+1, my, mx+mw-1, my+mh-2, 0xffffffff);
-	line(x->g, mx, my, mx+mw-1, my+mh-1, 0xff000000);
-	line(x->g, mx, my+1, mx+mw-2, my+mh-1, 0xffffffff);
+	grect_t r;
+	cursor_rect(x, &x->cursor.old_pos, &r);
+	blt(x->cursor.g, 0, 0, r.w, r.h,
+			x->g, r.x, r.y, r.w, r.h);
+	x->cursor.shown = false;
+}
 
-	line(x->g, mx, my+mh-2, mx+mw-2, my, 0xffffffff);
-	line(x->g, mx, my+mh-1, mx+mw-1, my, 0xff000000);
-	line(x->g, mx+1, my+mh-1, mx+mw-1, my+1, 0xffffffff);
+static void draw_cursor(x_t* x) {
+	grect_t r;
+	cursor_rect(x, &x->cursor.cpos, &r);
+	blt(x->g, r.x, r.y, r.w, r.h,
+			x->cursor.g, 0, 0, r.w, r.h);
+	blt_alpha(x->cursor.sprite, 0, 0, r.w, r.h,
+			x->g, r.x, r.y, r.w, r.h, 0xff);
 	x->cursor.old_pos.x = x->cursor.cpos.x;
 	x->cursor.old_pos.y = x->cursor.cpos.y;
-	x->cursor.drop = false;
+	x->cursor.shown = true;
+}
+
+/*cursor moved only, no recomposing*/
+static void x_cursor_update(x_t* x) {
+	if(!x->cursor.moved)
+		return;
+	x->cursor.moved = false;
+
+	grect_t rs[2];
+	int32_t num = 0;
+	if(x->cursor.shown) {
+		if(x->show_cursor &&
+				x->cursor.old_pos.x == x->cursor.cpos.x &&
+				x->cursor.old_pos.y == x->cursor.cpos.y)
+			return;
+		cursor_rect(x, &x->cursor.old_pos, &rs[num++]);
+		hide_cursor(x);
+	}
+
+	if(x->show_cursor) {
+		draw_cursor(x);
+		cursor_rect(x, &x->cursor.cpos, &rs[num]);
+		grect_t r;
+		if(num > 0 && rect_insect(&rs[0], &rs[num], &r)) 
+			rect_union(&rs[0], &rs[num], &rs[0]);
+		else
+			num++;
+	}
+
+	if(num > 0)
+		flush_data(x->fb_fd, rs, num * sizeof(grect_t));
 }
 
 static void x_repaint(x_t* x) {
-	if(!x->actived ||
-			(!x->need_repaint))
+	if(!x->actived)
 		return;
+	if(!x->need_repaint) {
+		x_cursor_update(x);
+		return;
+	}
 	x->need_repaint = false;
+	x->cursor.moved = false;
+
+	/*framebuffer only needs the damaged area and the old/new cursor area*/
+	grect_t scr = {0, 0, x->g->w, x->g->h};
+	x_damage_t flush_rs;
+	memcpy(&flush_rs, &x->damage, sizeof(x_damage_t));
+	grect_t rc;
+	if(x->cursor.shown) {
+		cursor_rect(x, &x->cursor.old_pos, &rc);
+		damage_add(&flush_rs, &rc, &scr);
+	}
 
 	hide_cursor(x);
-	bool undirty = false;
-	if(x->dirty) {
-		draw_desktop(x);
-		undirty = true;
+	for(int32_t i=0; i<x->damage.num; i++) {
+		grect_t* d = &x->damage.rs[i];
+		if(!x_covered(x, NULL, d))
+			draw_desktop(x, d);
+
+		xview_t* view = x->view_head;
+		while(view != NULL) {
+			if(view->xinfo.visible)
+				draw_view(x, view, d);
+			view = view->next;
+		}
 	}
+	x->damage.num = 0;
 
-	xview_t* view = x->view_head;
-	while(view != NULL) {
-		if(view->xinfo.visible)
-			draw_view(x, view);
-		view = view->next;
-	}
-	if(x->show_cursor)
+	if(x->show_cursor) {
 		draw_cursor(x);
-	flush(x->fb_fd);
-
-	if(undirty) {
-		x->dirty = false;
+		cursor_rect(x, &x->cursor.cpos, &rc);
+		damage_add(&flush_rs, &rc, &scr);
 	}
+	flush_data(x->fb_fd, flush_rs.rs, flush_rs.num * sizeof(grect_t));
 }
 
 static xview_t* x_get_view(x_t* x, int ufid, int from_pid) {
@@ -348,22 +498,56 @@ static xview_t* x_get_view(x_t* x, int ufid, int from_pid) {
 	return NULL;
 }
 
-static int x_update(int ufid, int from_pid, x_t* x) {
+static void get_frame_rect(x_t* x, xview_t* view) {
+	memcpy(&view->r_frame, &view->xinfo.r, sizeof(grect_t));
+	if((view->xinfo.style & X_STYLE_NO_FRAME) != 0)
+		return;
+
+	proto_t in, out;
+	proto_init(&in, NULL, 0);
+	proto_init(&out, NULL, 0);
+
+	proto_add(&in, &view->xinfo, sizeof(xinfo_t));
+	if(ipc_call(x->xwm_pid, XWM_CNTL_GET_FRAME, &in, &out) == 0)
+		proto_read_to(&out, &view->r_frame, sizeof(grect_t));
+	proto_clear(&in);
+	proto_clear(&out);
+}
+
+/*client committed its back buffer: latch it as the front one under lock,
+so composing never samples a half drawn frame. damaged rects (view coordinates)
+are optional, the new front index is returned.*/
+static int x_update(int ufid, int from_pid, proto_t* in, proto_t* out, x_t* x) {
 	if(ufid < 0)
 		return -1;
 	
 	xview_t* view = x_get_view(x, ufid, from_pid);
-	if(view == NULL)
+	if(view == NULL || view->g == NULL)
 		return -1;
 
-	proc_lock(x->lock);
-	view->dirty = true;
-	if(view != x->view_tail ||
-			(view->xinfo.style & X_STYLE_ALPHA) != 0) {
-		x_dirty(x);
+	view->front = (view->front == 0) ? 1 : 0;
+	view->g->buffer = view->bufs[view->front];
+	proto_add_int(out, view->front);
+	if(!view->xinfo.visible)
+		return 0;
+
+	int32_t sz = 0;
+	grect_t* rs = (grect_t*)proto_read(in, &sz);
+	int32_t num = sz / sizeof(grect_t);
+	if(rs == NULL || num == 0) {
+		x_damage(x, &view->xinfo.r);
+		return 0;
+	}
+
+	grect_t vr = {0, 0, view->xinfo.r.w, view->xinfo.r.h};
+	for(int32_t i=0; i<num; i++) {
+		grect_t r;
+		if(rect_insect(&rs[i], &vr, &r)) {
+			r.x += view->xinfo.r.x;
+			r.y += view->xinfo.r.y;
+			x_damage(x, &r);
+		}
 	}
-	x->need_repaint = true;
-	proc_unlock(x->lock);
 	return 0;
 }
 
@@ -375,9 +559,12 @@ static int x_set_visible(int ufid, int from_pid, proto_t* in, x_t* x) {
 	if(view == NULL)
 		return -1;
 
-	view->xinfo.visible = proto_read_int(in);
-	view->dirty = true;
-	x_dirty(x);
+	bool visible = proto_read_int(in);
+	if(visible == view->xinfo.visible)
+		return 0;
+	view->xinfo.visible = true;
+	x_damage_view(x, view);
+	view->xinfo.visible = visible;
 	return 0;
 }
 
@@ -398,29 +585,27 @@ static int x_update_info(int ufid, int from_pid, proto_t* in, x_t* x) {
 			view->xinfo.r.h != xinfo.r.h) {
 		if(view->g != NULL && shm_id > 0) {
 			graph_free(view->g);
+			view->g = NULL;
 			shm_unmap(shm_id);
 		}
-		shm_id = shm_alloc(xinfo.r.w * xinfo.r.h * 4, 1);
-		void* p = shm_map(shm_id);
+		uint32_t bsz = xinfo.r.w * xinfo.r.h;
+		shm_id = shm_alloc(bsz * 4 * 2, 1);
+		uint32_t* p = (uint32_t*)shm_map(shm_id);
 		if(p == NULL) 
 			return -1;
-		view->g = graph_new(p, xinfo.r.w, xinfo.r.h);
+		view->bufs[0] = p;
+		view->bufs[1] = p + bsz;
+		view->front = 0;
+		view->g = graph_new(p, xinfo.r.w, xinfo.r.h*2);
 		clear(view->g, 0xff000000);
+		view->g->h = xinfo.r.h;
 	}
-	view->dirty = true;
-	x->need_repaint = true;
 
-	if(view != x->view_tail ||
-			view->xinfo.r.x != xinfo.r.x ||
-			view->xinfo.r.y != xinfo.r.y ||
-			view->xinfo.r.w != xinfo.r.w ||
-			view->xinfo.r.h != xinfo.r.h ||
-			view->xinfo.visible != xinfo.visible ||
-			(view->xinfo.style & X_STYLE_ALPHA) != 0) {
-		x_dirty(x);
-	}
+	x_damage_view(x, view); //old place
 	memcpy(&view->xinfo, &xinfo, sizeof(xinfo_t));
 	view->xinfo.shm_id = shm_id;
+	get_frame_rect(x, view);
+	x_damage_view(x, view); //new place
 
 	return 0;
 }
@@ -447,6 +632,7 @@ static int x_get_info(int ufid, int from_pid, x_t* x, proto_t* out) {
 	if(view == NULL)
 		return -1;
 	proto_add(out, &view->xinfo, sizeof(xinfo_t));
+	proto_add_int(out, view->front); //clients map the back buffer by it
 	return 0;
 }
 
@@ -502,32 +688,34 @@ static int xserver_fcntl(int fd, int from_pid, fsinfo_t* info,
 	x_t* x = (x_t*)p;
 	uint32_t ufid = syscall3(SYS_VFS_GET_BY_FD, fd, from_pid, 0);
 
+	int res = 0;
+	proc_lock(x->lock);
 	if(cmd == X_CNTL_UPDATE) {
-		return x_update(ufid, from_pid, x);
+		res = x_update(ufid, from_pid, in, out, x);
 	}	
 	else if(cmd == X_CNTL_UPDATE_INFO) {
-		return x_update_info(ufid, from_pid, in, x);
+		res = x_update_info(ufid, from_pid, in, x);
 	}
 	else if(cmd == X_CNTL_SET_VISIBLE) {
-		return x_set_visible(ufid, from_pid, in, x);
+		res = x_set_visible(ufid, from_pid, in, x);
 	}
 	else if(cmd == X_CNTL_GET_INFO) {
-		return x_get_info(ufid, from_pid, x, out);
+		res = x_get_info(ufid, from_pid, x, out);
 	}
 	else if(cmd == X_CNTL_GET_EVT) {
-		return x_get_event(ufid, from_pid, x, out);
+		res = x_get_event(ufid, from_pid, x, out);
 	}
 	else if(cmd == X_CNTL_SCR_INFO) {
-		return x_scr_info(x, out);
+		res = x_scr_info(x, out);
 	}
 	else if(cmd == X_CNTL_WORKSPACE) {
-		return x_workspace(x, in, out);
+		res = x_workspace(x, in, out);
 	}
 	else if(cmd == X_CNTL_IS_TOP) {
-		return x_is_top(ufid, from_pid, x, out);
+		res = x_is_top(ufid, from_pid, x, out);
 	}
-
-	return 0;
+	proc_unlock(x->lock);
+	return res;
 }
 
 static int xserver_open(int fd, int from_pid, fsinfo_t* info, int oflag, void* p) {
@@ -545,7 +733,9 @@ static int xserver_open(int fd, int from_pid, fsinfo_t* info, int oflag, void* p
 	memset(view, 0, sizeof(xview_t));
 	view->ufid = ufid;
 	view->from_pid = from_pid;
+	proc_lock(x->lock);
 	push_view(x, view);
+	proc_unlock(x->lock);
 	return 0;
 }
 
@@ -554,11 +744,17 @@ static int xserver_closed(int fd, int ufid, int from_pid, fsinfo_t* info, void*
 	(void)fd;
 	x_t* x = (x_t*)p;
 	
+	proc_lock(x->lock);
 	xview_t* view = x_get_view(x, ufid, from_pid);
-	if(view == NULL)
+	if(view == NULL) {
+		proc_unlock(x->lock);
 		return -1;
+	}
 
+	if(x->current.view == view)
+		x->current.view = NULL;
 	x_del_view(x, view);	
+	proc_unlock(x->lock);
 	return 0;
 }
 
@@ -618,7 +814,7 @@ static int x_init(x_t* x) {
 	x->g = graph_new(gbuf, w, h);
 	proto_clear(&out);
 	x->shm_id = id;
-	x_dirty(x);
+	x_dirty(x); //whole screen at first
 
 	x->cursor.size.w = 15;
 	x->cursor.size.h = 15;
@@ -627,6 +823,7 @@ static int x_init(x_t* x) {
 	x->cursor.cpos.x = w/2;
 	x->cursor.cpos.y = h/2; 
 	x->show_cursor = true;
+	cursor_init(x);
 
 	x->lock = proc_lock_new();
 	return 0;
@@ -733,8 +930,8 @@ static int mouse_handle(x_t* x, int8_t state, int32_t rx, int32_t ry) {
 		if(pos == XWM_FRAME_CLOSE) { //window close
 			e->event.type = XEVT_WIN;
 			e->event.value.window.event = XEVT_WIN_CLOSE;
+			x_damage_view(x, view);
 			view->xinfo.visible = false;
-			x_dirty(x);
 		}
 		else if(pos == XWM_FRAME_MAX) {
 			e->event.type = XEVT_WIN;
@@ -745,7 +942,7 @@ static int mouse_handle(x_t* x, int8_t state, int32_t rx, int32_t ry) {
 				x->current.view = view;
 				x->current.old_pos.x = x->cursor.cpos.x;
 				x->current.old_pos.y = x->cursor.cpos.y;
-				x_dirty(x);
+				x_damage_view(x, view);
 			}
 			e->event.state = XEVT_MOUSE_DOWN;
 		}
@@ -753,7 +950,7 @@ static int mouse_handle(x_t* x, int8_t state, int32_t rx, int32_t ry) {
 	else if(state == 1) {
 		e->event.state = XEVT_MOUSE_UP;
 		if(x->current.view == view) {
-			x_dirty(x);
+			x_damage_view(x, view);
 		}
 		x->current.view = NULL;
 	}
@@ -764,9 +961,12 @@ static int mouse_handle(x_t* x, int8_t state, int32_t rx, int32_t ry) {
 		if(abs32(mrx) > 16 || abs32(mry) > 16) {
 			x->current.old_pos.x = x->cursor.cpos.x;
 			x->current.old_pos.y = x->cursor.cpos.y;
+			x_damage_view(x, view);
 			view->xinfo.r.x += mrx;
 			view->xinfo.r.y += mry;
-			x_dirty(x);
+			view->r_frame.x += mrx;
+			view->r_frame.y += mry;
+			x_damage_view(x, view);
 		}
 	}
 	if(e->event.type == XEVT_MOUSE && e->event.state == XEVT_MOUSE_MOVE)
@@ -777,6 +977,7 @@ static int mouse_handle(x_t* x, int8_t state, int32_t rx, int32_t ry) {
 }
 
 static int keyb_handle(x_t* x, int8_t v) {
+	proc_lock(x->lock);
 	xview_t* topv = get_top_view(x);
 	if(topv != NULL) {
 		xview_event_t* e = (xview_event_t*)malloc(sizeof(xview_event_t));
@@ -784,10 +985,9 @@ static int keyb_handle(x_t* x, int8_t v) {
 		e->event.type = XEVT_KEYB;
 		e->event.value.keyboard.value = v;
 
-		//proc_lock(x->lock);
 		x_push_event(topv, e, 1);
-		//proc_unlock(x->lock);
 	}
+	proc_unlock(x->lock);
 	usleep(1000);
 	return 0;
 }
@@ -867,10 +1067,10 @@ static void read_input(x_t* x) {
 	if(x->mouse_fd >= 0) {
 		int8_t mv[4];
 		if(read_nblock(x->mouse_fd, mv, 4) == 4) {
-			//proc_lock(x->lock);
+			proc_lock(x->lock);
 			mouse_handle(x, mv[0], mv[1], mv[2]);
-			x->need_repaint = true;
-			//proc_unlock(x->lock);
+			x->cursor.moved = true;
+			proc_unlock(x->lock);
 		}
 	}
 
@@ -882,11 +1082,10 @@ static void read_input(x_t* x) {
 			if(key == KEY_V_3 && !prs_down) { //switch joy mouse/keyboard mode
 				j_mouse = !j_mouse;
 				prs_down = true;
+				proc_lock(x->lock);
 				x->show_cursor = j_mouse;
-				x->need_repaint = true;
-				if(x->show_cursor) {
-					x->cursor.drop = true;
-				}
+				x->cursor.moved = true;
+				proc_unlock(x->lock);
 			}
 
 			if(j_mouse) {
@@ -897,10 +1096,10 @@ static void read_input(x_t* x) {
 					mv[0] = 1;
 				}
 				if(key != 0) {
-					//proc_lock(x->lock);
+					proc_lock(x->lock);
 					mouse_handle(x, mv[0], mv[1], mv[2]);
-					x->need_repaint = true;
-					//proc_unlock(x->lock);
+					x->cursor.moved = true;
+					proc_unlock(x->lock);
 				}
 			}
 			else {
@@ -950,6 +1149,8 @@ static void x_close(x_t* x) {
 	proc_lock_free(x->lock);
 	close(x->keyb_fd);
 	close(x->mouse_fd);
+	graph_free(x->cursor.g);
+	graph_free(x->cursor.sprite);
 	graph_free(x->g);
 	shm_unmap(x->shm_id);
 	close(x->fb_fd);
@@ -62,19 +62,56 @@ static int32_t read_config(xwm_t* xwm, const char* fname) {
 	return 0;
 }
 
+/*clip rect to redraw, whole screen if not given*/
+static void read_clip(proto_t* in, int xw, int xh, grect_t* clip) {
+	grect_t scr = {0, 0, xw, xh};
+	if(proto_read_to(in, clip, sizeof(grect_t)) != sizeof(grect_t))
+		memcpy(clip, &scr, sizeof(grect_t));
+
+	//clip to screen
+	if(clip->x < 0) {
+		clip->w += clip->x;
+		clip->x = 0;
+	}
+	if(clip->y < 0) {
+		clip->h += clip->y;
+		clip->y = 0;
+	}
+	if(clip->x + clip->w > xw)
+		clip->w = xw - clip->x;
+	if(clip->y + clip->h > xh)
+		clip->h = xh - clip->y;
+}
+
 static void draw_desktop(proto_t* in, proto_t* out) {
 	int shm_id = proto_read_int(in);
 	int xw = proto_read_int(in);
 	int xh = proto_read_int(in);
+	grect_t clip;
+	read_clip(in, xw, xh, &clip);
+	if(clip.w <= 0 || clip.h <= 0) {
+		proto_add_int(out, 0);
+		return;
+	}
 
 	void* gbuf = shm_map(shm_id);
 	if(gbuf != NULL) {
 		graph_t* g = graph_new(gbuf, xw, xh);
-		clear(g, _xwm.desk_bg_color);
-		//background pattern
+		//fill first line of clip, then copy it down
 		int32_t x, y;
-		for(y=10; y<(int32_t)g->h; y+=10) {
-			for(x=0; x<(int32_t)g->w; x+=10) {
+		uint32_t* line0 = &g->buffer[clip.y * xw + clip.x];
+		for(x=0; x<clip.w; x++)
+			line0[x] = _xwm.desk_bg_color;
+		for(y=1; y<clip.h; y++)
+			memcpy(line0 + y*xw, line0, clip.w*4);
+
+		//background pattern, aligned to the screen grid
+		int32_t sy = ((clip.y + 9) / 10) * 10;
+		if(sy < 10)
+			sy = 10;
+		int32_t sx = ((clip.x + 9) / 10) * 10;
+		for(y=sy; y<(clip.y+clip.h); y+=10) {
+			for(x=sx; x<(clip.x+clip.w); x+=10) {
 				pixel(g, x, y, _xwm.desk_fg_color);
 			}
 		}
@@ -197,10 +234,29 @@ static void draw_frame(proto_t* in, proto_t* out) {
 	int xh = proto_read_int(in);
 	proto_read_to(in, &info, sizeof(xinfo_t));
 	int top = proto_read_int(in);
+	grect_t clip;
+	read_clip(in, xw, xh, &clip);
+	if(clip.w <= 0 || clip.h <= 0) {
+		proto_add_int(out, 0);
+		return;
+	}
 
 	void* gbuf = shm_map(shm_id);
 	if(gbuf != NULL) {
-		graph_t* g = graph_new(gbuf, xw, xh);
+		graph_t* scr = graph_new(gbuf, xw, xh);
+		graph_t* g = scr;
+		grect_t r;
+		get_frame_rect(&info, &r);
+		if(clip.x > r.x || clip.y > r.y ||
+				(clip.x + clip.w) < (r.x + r.w) ||
+				(clip.y + clip.h) < (r.y + r.h)) {
+			/*frame partly in clip: draw on a clip sized copy, 
+			then put back only the clip*/
+			g = graph_new(NULL, clip.w, clip.h);
+			blt(scr, clip.x, clip.y, clip.w, clip.h, g, 0, 0, clip.w, clip.h);
+			info.r.x -= clip.x;
+			info.r.y -= clip.y;
+		}
 
 		uint32_t fg, bg;
 		if(top == 0) {
@@ -222,7 +278,11 @@ static void draw_frame(proto_t* in, proto_t* out) {
 		}
 		draw_win_frame(g, &info, fg, bg);
 
-		graph_free(g);
+		if(g != scr) {
+			blt(g, 0, 0, clip.w, clip.h, scr, clip.x, clip.y, clip.w, clip.h);
+			graph_free(g);
+		}
+		graph_free(scr);
 		shm_unmap(shm_id);
 	}
 	proto_add_int(out, 0);
@@ -254,6 +314,14 @@ static void get_pos(proto_t* in, proto_t* out) {
 	proto_add_int(out, res);
 }
 
+static void get_frame(proto_t* in, proto_t* out) {
+	xinfo_t info;
+	grect_t r;
+	proto_read_to(in, &info, sizeof(xinfo_t));
+	get_frame_rect(&info, &r);
+	proto_add(out, &r, sizeof(grect_t));
+}
+
 static void get_workspace(proto_t* in, proto_t* out) {
 	grect_t r;
 	int style = proto_read_int(in);
@@ -287,6 +355,9 @@ static void handle(int from_pid, int cmd, void* p) {
 	else if(cmd == XWM_CNTL_GET_WORKSPACE) { //get workspace
 		get_workspace(in, &out);
 	}
+	else if(cmd == XWM_CNTL_GET_FRAME) { //get frame rect
+		get_frame(in, &out);
+	}
 
 	proto_free(in);
 	ipc_set_return(&out);